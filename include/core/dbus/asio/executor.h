@@ -20,8 +20,14 @@
 
 #include <core/dbus/bus.h>
 #include <core/dbus/executor.h>
+#include <core/dbus/server.h>
+#include <core/dbus/stream_channel.h>
 #include <core/dbus/visibility.h>
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 namespace boost
 {
 namespace asio
@@ -38,6 +44,31 @@ namespace asio
 {
 ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Executor::Ptr make_executor(const Bus::Ptr& bus);
 ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Executor::Ptr make_executor(const Bus::Ptr& bus, boost::asio::io_service& io);
+ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Executor::Ptr make_executor(const Server::Ptr& server, boost::asio::io_service& io);
+
+/**
+ * @brief Consumes a stream channel on io, handing all records available per wakeup to handler.
+ *
+ * Records are consumed for as long as the returned executor is alive.
+ * Destroying it does not stop io, which typically dispatches buses, too.
+ */
+ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Executor::Ptr make_executor(
+        const RawStreamChannel::Ptr& channel,
+        boost::asio::io_service& io,
+        const RawStreamChannel::BatchHandler& handler);
+
+template<typename T>
+inline Executor::Ptr make_executor(
+        const std::shared_ptr<StreamChannel<T>>& channel,
+        boost::asio::io_service& io,
+        const typename StreamChannel<T>::BatchHandler& handler)
+{
+    return make_executor(channel->untyped(), io, [handler](const std::uint8_t* records, std::size_t count)
+    {
+        auto begin = reinterpret_cast<const T*>(records);
+        handler(std::vector<T>(begin, begin + count));
+    });
+}
 }
 }
 }
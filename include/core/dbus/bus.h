@@ -18,12 +18,18 @@
 #ifndef CORE_DBUS_BUS_H_
 #define CORE_DBUS_BUS_H_
 
+#include <core/signal.h>
+
 #include <core/dbus/error.h>
 #include <core/dbus/executor.h>
+#include <core/dbus/match_rule_index.h>
 #include <core/dbus/message.h>
 #include <core/dbus/message_factory.h>
+#include <core/dbus/message_log.h>
 #include <core/dbus/message_router.h>
+#include <core/dbus/path_namespace_router.h>
 #include <core/dbus/pending_call.h>
+#include <core/dbus/result.h>
 #include <core/dbus/visibility.h>
 #include <core/dbus/well_known_bus.h>
 
@@ -32,7 +38,9 @@
 #include <cstring>
 
 #include <chrono>
+#include <exception>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <map>
@@ -42,13 +50,17 @@
 #include <string>
 #include <thread>
 #include <tuple>
+#include <vector>
 
 namespace core
 {
 namespace dbus
 {
 class MatchRule;
+class MatchRuleIndex;
+class NameWatchRegistry;
 class Object;
+class Server;
 /**
  * @brief The Bus class constitutes a very thin wrapper and the starting
  * point to expose low-level DBus functionality for internal purposes.
@@ -150,13 +162,25 @@ public:
             {
             }
         };
+
+        /**
+         * @brief The OutgoingQueueFull exception is thrown if the outgoing queue exceeds its high-water mark.
+         */
+        struct OutgoingQueueFull : public std::runtime_error
+        {
+            inline OutgoingQueueFull()
+                : std::runtime_error(
+                      "The outgoing queue exceeds its high-water mark.")
+            {
+            }
+        };
     };
 
     /** @brief Routing of messages based on their type. */
     typedef MessageRouter<Message::Type> MessageTypeRouter;
 
-    /** @brief Routing of signals based on a tuple of interface and member name. */
-    typedef MessageRouter<types::ObjectPath> SignalRouter;
+    /** @brief Routing of raw signals based on their object path, supporting routes for entire path namespaces. */
+    typedef PathNamespaceRouter SignalRouter;
 
     /**
      * @brief The MessageHandlerResult enum summarizes possible replies of a MessageHandler.
@@ -171,6 +195,16 @@ public:
     /** @brief Function signature for handling a message. */
     typedef std::function<MessageHandlerResult(const Message::Ptr& msg)> MessageHandler;
 
+    /**
+     * @brief Function signature for handling a message addressed to an object in a subtree.
+     *
+     * The suffix is the path of the addressed object relative to the root of
+     * the subtree, without a leading slash, e.g., "42/settings" for a message
+     * addressed to /com/example/records/42/settings in a subtree registered
+     * for /com/example/records. It is empty for the root of the subtree itself.
+     */
+    typedef std::function<MessageHandlerResult(const Message::Ptr& msg, const std::string& suffix)> SubtreeHandler;
+
     /**
      * @brief Constructs an instance of Bus and connected to the bus specified by address.
      * @param address The address of the bus to connect to.
@@ -183,6 +217,68 @@ public:
      */
     explicit Bus(WellKnownBus bus);
 
+    /**
+     * @brief Tags the construction of a direct connection to a peer, without a bus daemon in between.
+     */
+    struct PeerToPeer {};
+
+    /**
+     * @brief Connects directly to a peer listening on address, refer to Server.
+     *
+     * No Hello handshake takes place and the daemon-specific operations are
+     * adjusted accordingly: names are acquired and released without any
+     * round trip, every name is considered to be owned, and match rules are
+     * only accounted for locally as the peer delivers all of its signals.
+     * With that, stubs and skeletons work unchanged on top of the connection.
+     * @param address The address the peer is listening on.
+     */
+    Bus(const std::string& address, PeerToPeer);
+
+    /**
+     * @brief Creates the executor a connection is driven by, refer to connect_asynchronously.
+     */
+    typedef std::function<Executor::Ptr(const Ptr&)> ExecutorFactory;
+
+    /**
+     * @brief Connects to the bus specified by address without blocking the caller.
+     *
+     * The connection is opened without registering on the bus, and the
+     * executor created by make_executor is installed right away. The Hello
+     * handshake is issued as a pending call that completes on that executor,
+     * such that the future only becomes ready while the executor runs. With
+     * that, a single event loop can establish any number of connections.
+     * Opening the transport is not deferred, which merely amounts to a local
+     * socket connect for unix addresses.
+     * @param address The address of the bus to connect to.
+     * @param make_executor Creates the executor for the new instance.
+     * @return A future carrying the connected instance, or the exception
+     * thrown while connecting.
+     */
+    static std::future<Ptr> connect_asynchronously(const std::string& address, const ExecutorFactory& make_executor);
+
+    /**
+     * @brief Connects to the bus specified by address on a worker thread.
+     *
+     * Lacking an executor to complete the Hello handshake on, this runs the
+     * blocking constructor on a thread of its own, one per connection.
+     * Prefer the overload taking an ExecutorFactory where an event loop is
+     * available.
+     * @param address The address of the bus to connect to.
+     * @return A future carrying the connected instance, or the exception
+     * thrown while connecting.
+     */
+    static std::future<Ptr> connect_asynchronously(const std::string& address);
+
+    /**
+     * @brief Connects to a well-known bus on a worker thread.
+     *
+     * Runs the blocking constructor on a thread of its own, one per connection.
+     * @param bus The well-known bus the instance should connect to.
+     * @return A future carrying the connected instance, or the exception
+     * thrown while connecting.
+     */
+    static std::future<Ptr> connect_asynchronously(WellKnownBus bus);
+
     // A Bus instance is not copy-able.
     Bus(const Bus&) = delete;
 
@@ -209,6 +305,39 @@ public:
             const std::string& name,
             RequestNameFlag flags);
 
+    /**
+     * @brief Function signature for handling the outcome of an asynchronous name request.
+     *
+     * The error is null if the request completed successfully, and otherwise
+     * refers to the exception request_name_on_bus would have thrown.
+     */
+    typedef std::function<void(const std::exception_ptr& error)> RequestNameHandler;
+
+    /**
+     * @brief Attempts to own the given name on the bus without waiting for the daemon.
+     *
+     * The handler is invoked once the daemon replied, which requires an
+     * executor dispatching the connection.
+     * @param name The name to acquire.
+     * @param flags Flags specifying behavior when requesting the name.
+     * @param handler The handler to invoke with the outcome of the request.
+     */
+    void request_name_on_bus_asynchronously(
+            const std::string& name,
+            RequestNameFlag flags,
+            const RequestNameHandler& handler);
+
+    /**
+     * @brief Attempts to own the given name on the bus without waiting for the daemon.
+     * @param name The name to acquire.
+     * @param flags Flags specifying behavior when requesting the name.
+     * @return A future carrying the acquired name, or the exception
+     * request_name_on_bus would have thrown.
+     */
+    std::future<Name> request_name_on_bus_asynchronously(
+            const std::string& name,
+            RequestNameFlag flags);
+
     /**
      * @brief Releases the previously owned name.
      * @param name The name to release.
@@ -223,6 +352,116 @@ public:
      */
     uint32_t send(const std::shared_ptr<Message>& msg);
 
+    /**
+     * @brief Sends a sequence of raw DBus messages over this DBus connection in order.
+     *
+     * Resources for all messages are allocated up front, such that either
+     * all of the messages are queued in order or none of them. This is no
+     * batching: libdbus takes its lock and attempts a write for every single
+     * message, and messages sent concurrently by other threads may end up in
+     * between.
+     * @param messages The messages to send, none of them must be null.
+     * Replies to calls dispatched in-process are completed right away, as
+     * with send, and never held back or handed to libdbus.
+     * @return The serials of the messages, in order. Messages held back by a Cork report a serial of 0.
+     * @throw Errors::NoMemory if the messages cannot be queued.
+     */
+    std::vector<uint32_t> send_in_order(const std::vector<std::shared_ptr<Message>>& messages);
+
+    /**
+     * @brief The OutgoingQueuePolicy enum lists how send and send_in_order react to an outgoing queue exceeding its high-water mark.
+     */
+    enum class OutgoingQueuePolicy
+    {
+        notify, ///< Queue messages anyway, crossings are only announced.
+        fail, ///< Throw Errors::OutgoingQueueFull without queueing messages.
+        block ///< Block until the queue has been written out, then queue messages.
+    };
+
+    /**
+     * @brief Limits the data libdbus buffers for a slow peer.
+     *
+     * libdbus reports the size of its outgoing queue in bytes only, the
+     * number of queued messages is not available. The state of the queue
+     * is evaluated whenever send, send_in_order or outgoing_queue_size are
+     * invoked, i.e., a queue drained by an executor is noticed on the next
+     * of these calls.
+     * @param bytes The high-water mark in bytes, 0 disables the mark.
+     * @param policy The reaction of send and send_in_order to an exceeded mark.
+     */
+    void set_outgoing_high_water_mark(
+            std::size_t bytes,
+            OutgoingQueuePolicy policy = OutgoingQueuePolicy::notify);
+
+    /**
+     * @brief Queries the high-water mark of the outgoing queue in bytes, 0 if disabled.
+     */
+    std::size_t outgoing_high_water_mark() const;
+
+    /**
+     * @brief Queries the number of bytes queued by libdbus for sending.
+     */
+    std::size_t outgoing_queue_size() const;
+
+    /**
+     * @brief Emitted with true when the outgoing queue exceeds its high-water mark, and with false once back below.
+     */
+    const core::Signal<bool>& outgoing_high_water_mark_crossed() const;
+
+    /**
+     * @brief Holds back messages handed to send and send_in_order while in scope.
+     *
+     * Messages are queued by the connection instead of being handed to
+     * libdbus, and submitted with send_in_order once the outermost Cork on
+     * the connection is released. Corks nest and apply to all threads
+     * sending on the connection. Method calls expecting a reply are never
+     * held back, sending one submits the messages queued so far first, such
+     * that messages go out in the order they were issued. Replies to calls
+     * dispatched in-process are never held back either.
+     */
+    class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Cork
+    {
+    public:
+        /**
+         * @brief Starts holding back messages sent on bus.
+         * @param bus The connection to cork, must not be null.
+         */
+        explicit Cork(const std::shared_ptr<Bus>& bus);
+
+        /**
+         * @brief Releases the cork if not released before.
+         *
+         * If submitting the queued messages fails, none of them is sent and
+         * all of them are dropped after reporting the error to stderr. Call
+         * release() explicitly to handle such failures.
+         */
+        ~Cork() noexcept;
+
+        Cork(const Cork&) = delete;
+        Cork& operator=(const Cork&) = delete;
+
+        /**
+         * @brief Releases the cork, submitting the queued messages if no outer cork remains.
+         * @return The serials of the submitted messages, in order. Empty if
+         * an outer cork is still in place or if released before.
+         * @throw Errors::NoMemory if the messages cannot be queued, in which
+         * case none of them is sent and all of them are dropped. The cork
+         * counts as released nevertheless.
+         */
+        std::vector<uint32_t> release();
+
+    private:
+        std::shared_ptr<Bus> bus;
+        bool released;
+    };
+
+    /**
+     * @brief The timeout of calls the bus issues on its own behalf, e.g., AddMatch.
+     *
+     * Mirrors the default timeout of libdbus.
+     */
+    static const std::chrono::milliseconds& default_timeout();
+
     /**
      * @brief Invokes a function and blocks for a specified amount of time waiting for a result.
      * @param msg The method call.
@@ -246,23 +485,165 @@ public:
 
     /**
      * @brief Installs a match rule to the underlying DBus connection.
+     *
+     * Match rules are reference counted per connection, only the first
+     * subscriber for a rule results in a round trip to the daemon. Other
+     * subscribers for the same rule wait for its outcome, subscribers for
+     * other rules and the thread dispatching the connection do not.
      * @param rule The match rule to be installed, has to be a valid match rule.
+     * @throw std::runtime_error if the daemon rejects the rule.
      */
     void add_match(const MatchRule& rule);
 
     /**
      * @brief Uninstalls a match rule to the underlying DBus connection.
+     *
+     * The rule is only removed from the daemon once the last subscriber is gone.
      * @param rule The match rule to be uninstalled.
+     * @throw std::runtime_error if the daemon does not know about the rule.
      */
     void remove_match(const MatchRule& rule);
 
+    /**
+     * @brief Installs a match rule without waiting for the daemon to acknowledge it.
+     *
+     * The AddMatch call is sent as an ordinary method call, such that many
+     * rules can be submitted back-to-back and their futures be awaited
+     * together. Rules are reference counted with add_match and the future
+     * is ready right away if the rule has been installed before. Subscribers
+     * arriving while the AddMatch call for the rule is in flight share its
+     * outcome. On errors, the rule is removed from the registry again. The
+     * future only becomes ready if an executor dispatches the connection.
+     * @param rule The match rule to be installed, has to be a valid match rule.
+     * @return A future that becomes ready once the daemon acknowledged the rule.
+     */
+    std::future<Result<void>> add_match_asynchronously(const MatchRule& rule);
+
+    /**
+     * @brief Installs multiple match rules without waiting for round trips in between.
+     * @param rules The match rules to be installed.
+     * @return A future that becomes ready once the daemon acknowledged all of
+     * the rules, carrying the first error if any.
+     */
+    std::future<Result<void>> add_matches_asynchronously(const std::vector<MatchRule>& rules);
+
+    /**
+     * @brief Uninstalls a match rule without waiting for the daemon to acknowledge it.
+     *
+     * Mirrors add_match_asynchronously, the RemoveMatch call is only sent
+     * once the last subscriber for the rule is gone.
+     * @param rule The match rule to be uninstalled.
+     * @return A future that becomes ready once the daemon acknowledged the removal.
+     */
+    std::future<Result<void>> remove_match_asynchronously(const MatchRule& rule);
+
+    /**
+     * @brief Summarizes the match rules installed via this connection.
+     * @return The rules installed with the daemon, mapped to their number of subscribers.
+     */
+    std::map<std::string, std::size_t> match_rules() const;
+
+    /**
+     * @brief Subscribes to the signals matching rule, installing it with both the daemon and the match rule index.
+     *
+     * Use a rule with a path namespace to subscribe to the signals of an
+     * entire subtree of objects, e.g., all devices exposed by a service,
+     * without creating an Object per path.
+     * @param rule The criteria of the signals to subscribe to, its type is set to signal.
+     * @param handler Invoked for every matching signal, on the thread dispatching the connection.
+     * @return A token to pass to unsubscribe_from_signals.
+     * @throw std::runtime_error if the daemon rejects the rule.
+     */
+    MatchRuleIndex::Token subscribe_to_signals(const MatchRule& rule, const MatchRuleIndex::Handler& handler);
+
+    /**
+     * @brief Cancels a subscription, the rule is removed from the daemon once its last subscriber is gone.
+     * @param token The token returned by subscribe_to_signals, unknown tokens are ignored.
+     */
+    void unsubscribe_from_signals(MatchRuleIndex::Token token);
+
+    /**
+     * @brief Queries the number of method calls sent via this connection that still await a reply.
+     */
+    std::size_t outstanding_calls() const;
+
     /**
      * @brief Checks if the given name is owned on this bus connection.
+     *
+     * Answered locally if the name owner cache is enabled and knows about
+     * the name, otherwise requires a blocking round trip to the daemon.
      * @param name The name to check ownership for.
      * @return true if the name is already owned, false otherwise.
      */
     bool has_owner_for_name(const std::string& name);
 
+    /**
+     * @brief Resolves the unique name of the current owner of the given name.
+     *
+     * The future is ready right away if the name owner cache is enabled and
+     * knows about the name. Otherwise, a GetNameOwner call is sent and the
+     * future only becomes ready if an executor dispatches the connection.
+     * @param name The name to resolve the owner for.
+     * @return A future carrying the unique name of the owner, or an empty
+     * string if the name is not owned. Carries an exception if the daemon
+     * reports any other error.
+     */
+    std::future<std::string> get_name_owner(const std::string& name);
+
+    /**
+     * @brief Enables caching of name owners for this connection.
+     *
+     * A single NameOwnerChanged subscription keeps the cache up to date,
+     * which is populated with the answers of has_owner_for_name and
+     * get_name_owner. Updates are only seen while an executor dispatches
+     * the connection. Enabling the cache more than once has no effect.
+     * @throw std::runtime_error if the match rule cannot be installed.
+     */
+    void enable_name_owner_cache();
+
+    /**
+     * @brief Enables dispatching method calls to objects exposed on this very connection in-process.
+     *
+     * Once enabled, a copy of a method call addressed to a name acquired on
+     * this connection and to an object registered with it is posted to the
+     * executor, which hands it to the object on its event loop, just like a
+     * call arriving from the outside. The reply sent by the object via send
+     * is routed back to the caller in the same way, with neither libdbus'
+     * transport nor the daemon being involved. Stubs and skeletons sharing
+     * the connection work unchanged, and arguments are still carried in
+     * messages. Calls to subtrees and to objects of other connections go out
+     * as before.
+     *
+     * Blocking calls time out as usual, issuing them on the thread running
+     * the executor thus always times out. Asynchronous calls dispatched
+     * in-process complete as soon as the object replies, or with
+     * DBUS_ERROR_NO_REPLY once their timeout elapsed.
+     *
+     * Calls dispatched in-process throw std::runtime_error unless the
+     * installed executor implements Scheduler.
+     */
+    void enable_loopback();
+
+    /**
+     * @brief The CaptureDirection enum lists the tags of entries recorded by capture_to.
+     */
+    enum class CaptureDirection : std::uint32_t
+    {
+        incoming = 0, ///< The message was received on this connection.
+        outgoing = 1 ///< The message was sent on this connection.
+    };
+
+    /**
+     * @brief Records messages received and sent on this connection to log.
+     *
+     * Incoming messages are recorded by a filter ahead of regular dispatching,
+     * including replies to method calls. Outgoing messages are recorded once
+     * queued. Messages carrying unix fds and messages delivered in-process
+     * are not recorded. Replay a capture with dbus-cpp-replay.
+     * @param log The log to record to, null stops capturing.
+     */
+    void capture_to(const std::shared_ptr<MessageLog::Writer>& log);
+
     /**
      * @brief Installs an executor for this bus connection, enabling signal and method call delivery.
      * @param e The executor instance, must not be null.
@@ -281,9 +662,32 @@ public:
 
     /**
      * @brief Provides mutable access to the contained signal router.
+     *
+     * Objects and signals do not route through it, the router is only
+     * consulted for incoming signals while routes are installed with it.
+     * Prefer access_match_rule_index.
      */
     SignalRouter& access_signal_router();
 
+    /**
+     * @brief Provides mutable access to the index of match rules evaluated for incoming signals.
+     *
+     * Every incoming signal is evaluated against the index exactly once,
+     * which resolves the signals of all objects and signals on this
+     * connection. Handlers installed with the index only see messages that
+     * the daemon delivers to this connection, i.e., rules need to be
+     * installed via add_match, too.
+     */
+    MatchRuleIndex& access_match_rule_index();
+
+    /**
+     * @brief Provides mutable access to the registry multiplexing watches for name owner changes.
+     *
+     * The registry is created on first access and relies on an executor
+     * dispatching the connection to deliver owner changes.
+     */
+    NameWatchRegistry& access_name_watch_registry();
+
     /**
      * @brief Provides raw, unmanaged access to the underlying DBus connection.
      */
@@ -300,6 +704,22 @@ public:
             const types::ObjectPath& path,
             const std::shared_ptr<Object>& object);
 
+    /**
+     * @brief register_subtree_for_path routes messages for path and all paths below it to handler.
+     *
+     * A single registration serves an arbitrary number of objects, i.e., no
+     * per-object state is allocated. Objects registered for a path below the
+     * subtree with register_object_for_path take precedence over the subtree.
+     * Use unregister_object_path to remove the subtree again.
+     * @throw Bus::Errors::NoMemory if not enough memory.
+     * @throw Bus::Errors::ObjectPathInUse if path is already used.
+     * @param path The root of the subtree.
+     * @param handler The handler to invoke for incoming messages.
+     */
+    void register_subtree_for_path(
+            const types::ObjectPath& path,
+            const SubtreeHandler& handler);
+
     /**
      * @brief unregister_object_path removes the object known under the given name from the bus.
      * @throw Bus::Errors::NoMemory if not enough memory.
@@ -314,6 +734,20 @@ public:
     MessageHandlerResult handle_message(const Message::Ptr& msg);
 
 private:
+    friend class Server;
+
+    // Adopts a direct connection accepted by a server, taking over the reference.
+    Bus(DBusConnection* connection, PeerToPeer);
+
+    // Opens the connection without saying Hello to the bus, refer to connect_asynchronously.
+    struct Unregistered {};
+    Bus(const std::string& address, Unregistered);
+
+    // Records the unique name the bus assigned to us in its reply to Hello.
+    void handle_hello_reply(const std::shared_ptr<Message>& reply);
+
+    void install_message_filter();
+
     struct Private;
     std::unique_ptr<Private> d;
 };
@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_BUS_POOL_H_
+#define CORE_DBUS_BUS_POOL_H_
+
+#include <core/dbus/bus.h>
+#include <core/dbus/visibility.h>
+#include <core/dbus/well_known_bus.h>
+
+#include <core/dbus/types/object_path.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace core
+{
+namespace dbus
+{
+/**
+ * @brief Spreads outgoing method calls across several private connections to the same bus.
+ *
+ * A single connection serializes all of its traffic through one socket and
+ * one connection lock. Stubs created for a pool via Service::use_service
+ * send their method calls over the connection selected by the pool's
+ * policy, while signal subscriptions, property changes and match rules stay
+ * pinned to the primary connection to preserve their ordering.
+ *
+ * Every connection of the pool needs an executor installed to receive
+ * replies to asynchronous calls.
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC BusPool
+{
+public:
+    typedef std::shared_ptr<BusPool> Ptr;
+
+    /**
+     * @brief The Policy enum lists the strategies for selecting a connection for a method call.
+     */
+    enum class Policy
+    {
+        round_robin, ///< Cycle through the connections call by call.
+        least_in_flight, ///< Pick the connection with the fewest calls awaiting a reply.
+        object_path_hash ///< Pick the connection by hashing the path of the addressed object, keeping calls to one object in order.
+    };
+
+    /**
+     * @brief Opens size private connections to the bus specified by address.
+     *
+     * The connections are established concurrently.
+     * @throw std::runtime_error if size is 0 or if any of the connections cannot be established.
+     * @param address The address of the bus to connect to.
+     * @param size The number of connections to open.
+     * @param policy The policy for spreading method calls across connections.
+     */
+    BusPool(const std::string& address, std::size_t size, Policy policy = Policy::round_robin);
+
+    /**
+     * @brief Opens size private connections to a well-known bus.
+     * @throw std::runtime_error if size is 0 or if any of the connections cannot be established.
+     * @param bus The well-known bus to connect to.
+     * @param size The number of connections to open.
+     * @param policy The policy for spreading method calls across connections.
+     */
+    BusPool(WellKnownBus bus, std::size_t size, Policy policy = Policy::round_robin);
+
+    ~BusPool();
+
+    BusPool(const BusPool&) = delete;
+    BusPool& operator=(const BusPool&) = delete;
+
+    /**
+     * @brief Provides access to all connections of the pool, the first one being the primary connection.
+     */
+    const std::vector<Bus::Ptr>& connections() const;
+
+    /**
+     * @brief Provides access to the connection carrying signal subscriptions.
+     */
+    const Bus::Ptr& primary() const;
+
+    /**
+     * @brief Queries the policy for spreading method calls across connections.
+     */
+    Policy policy() const;
+
+    /**
+     * @brief Selects the connection for a method call addressed to the object at path in a thread-safe manner.
+     * @param path The path of the addressed object.
+     */
+    const Bus::Ptr& connection_for_method_call(const types::ObjectPath& path);
+
+private:
+    struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Private;
+    std::unique_ptr<Private> d;
+};
+}
+}
+
+#endif // CORE_DBUS_BUS_POOL_H_
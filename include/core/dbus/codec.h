@@ -291,6 +291,23 @@ struct Codec<types::UnixFd>
     }
 };
 
+/**
+ * @brief Template specialization for owned unix fds.
+ */
+template<>
+struct Codec<types::UniqueFd>
+{
+    inline static void encode_argument(Message::Writer& out, const types::UniqueFd& value)
+    {
+        out.push_unix_fd(value.to_unix_fd());
+    }
+
+    inline static void decode_argument(Message::Reader& in, types::UniqueFd& value)
+    {
+        value = in.pop_unique_fd();
+    }
+};
+
 /**
  * @brief Template specialization for any argument types.
  */
@@ -0,0 +1,156 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_DECODE_PLAN_H_
+#define CORE_DBUS_DECODE_PLAN_H_
+
+#include <core/dbus/argument_type.h>
+#include <core/dbus/message.h>
+#include <core/dbus/visibility.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace core
+{
+namespace dbus
+{
+/**
+ * @brief DecodePlan is a signature compiled to a flat sequence of decoding instructions.
+ *
+ * Consumers that only learn about the layout of a message at runtime, e.g., loggers,
+ * bridges or introspection-driven proxies, can decode messages by running the
+ * plan in a single loop instead of walking the message recursively and checking
+ * every argument type dynamically. Plans are immutable and can be shared freely
+ * across threads. Use DecodePlan::for_signature to obtain a cached plan.
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC DecodePlan
+{
+public:
+    typedef std::shared_ptr<const DecodePlan> Ptr;
+
+    /**
+     * @brief Enumerates the operations a plan is made of.
+     */
+    enum class OpCode
+    {
+        decode_basic, ///< Decodes a single value of basic type.
+        enter_array, ///< Enters an array, jumps past the element instructions if the array is empty.
+        next_element, ///< Jumps back to the first element instruction if the array has more elements.
+        leave_array, ///< Leaves an array.
+        enter_structure, ///< Enters a structure.
+        leave_structure, ///< Leaves a structure.
+        enter_dict_entry, ///< Enters a dictionary entry.
+        leave_dict_entry, ///< Leaves a dictionary entry.
+        decode_variant ///< Decodes a variant with the plan for its contained signature.
+    };
+
+    /**
+     * @brief A single step of a plan.
+     */
+    struct Instruction
+    {
+        /** The operation to execute. */
+        OpCode op;
+        /** The argument type expected by the operation. */
+        ArgumentType type;
+        /** Target instruction index for enter_array and next_element, 0 otherwise. */
+        std::size_t jump;
+        /** Signature of the contained values for enter_* instructions, empty otherwise. */
+        std::string signature;
+    };
+
+    /**
+     * @brief Receives the values decoded by a plan.
+     */
+    class Visitor
+    {
+    public:
+        virtual ~Visitor() = default;
+
+        /**
+         * @brief Invoked for every value of basic type.
+         *
+         * For ArgumentType::unix_fd, value.fd carries a duplicated descriptor
+         * and the visitor takes ownership of it.
+         * @param type The type of the value.
+         * @param value The value, valid for the duration of the call only.
+         */
+        virtual void on_basic(ArgumentType type, const DBusBasicValue& value) = 0;
+
+        /**
+         * @brief Invoked when entering a container.
+         * @param type The type of the container.
+         * @param signature The signature of the contained values, i.e., the element
+         * signature for arrays and the signature of the members for structures,
+         * dictionary entries and variants.
+         */
+        virtual void on_enter(ArgumentType type, const char* signature);
+
+        /**
+         * @brief Invoked when leaving a container.
+         * @param type The type of the container.
+         */
+        virtual void on_leave(ArgumentType type);
+    };
+
+    /**
+     * @brief Compiles a plan for the given signature, bypassing the cache.
+     * @throw std::runtime_error if the signature is invalid.
+     */
+    static Ptr compile(const std::string& signature);
+
+    /**
+     * @brief Returns the cached plan for the given signature, compiling it on first use.
+     *
+     * Meant for signatures known to the process. The cache holds a bounded
+     * number of plans, signatures beyond it are compiled on every call.
+     * @throw std::runtime_error if the signature is invalid.
+     */
+    static Ptr for_signature(const std::string& signature);
+
+    DecodePlan(const DecodePlan&) = delete;
+    DecodePlan& operator=(const DecodePlan&) = delete;
+
+    /**
+     * @brief The signature this plan has been compiled from.
+     */
+    const std::string& signature() const;
+
+    /**
+     * @brief The flat instruction sequence of this plan.
+     */
+    const std::vector<Instruction>& instructions() const;
+
+    /**
+     * @brief Decodes the values described by this plan from the reader and hands them to the visitor.
+     *
+     * The reader is advanced past all decoded values.
+     * @throw std::runtime_error if the message does not match the plan.
+     */
+    void execute(Message::Reader& reader, Visitor& visitor) const;
+
+private:
+    DecodePlan(const std::string& signature);
+
+    std::string signature_;
+    std::vector<Instruction> instructions_;
+    std::size_t max_depth_;
+};
+}
+}
+
+#endif // CORE_DBUS_DECODE_PLAN_H_
@@ -20,6 +20,8 @@
 
 #include <core/dbus/visibility.h>
 
+#include <chrono>
+#include <functional>
 #include <memory>
 
 namespace core
@@ -38,6 +40,7 @@ public:
 
 protected:
     friend class Bus;
+    friend class Server;
 
     Executor() = default;
     Executor(const Executor&) = delete;
@@ -53,6 +56,41 @@ protected:
      */
     virtual void stop() = 0;
 };
+
+/**
+ * @brief Implemented by executors that can run handlers on their event loop.
+ *
+ * Kept apart from Executor to leave its layout untouched. Bus requires it
+ * for dispatching calls in-process, refer to Bus::enable_loopback.
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Scheduler
+{
+public:
+    /**
+     * @brief Function signature for cancelling a scheduled handler.
+     */
+    typedef std::function<void()> Cancellation;
+
+    virtual ~Scheduler() = default;
+
+protected:
+    friend class Bus;
+
+    Scheduler() = default;
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    /**
+     * @brief Queues handler for invocation on the event loop.
+     */
+    virtual void post(const std::function<void()>& handler) = 0;
+
+    /**
+     * @brief Schedules handler for invocation on the event loop once timeout elapsed.
+     * @return A function cancelling the invocation.
+     */
+    virtual Cancellation schedule(const std::chrono::milliseconds& timeout, const std::function<void()>& handler) = 0;
+};
 }
 }
 
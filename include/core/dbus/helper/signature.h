@@ -36,15 +36,16 @@ inline std::string atomic_signature()
 
 inline std::string signature()
 {
-    static const std::string s;
-    return s;
+    return StaticSignature<>::value;
 }
 
 template<typename Arg, typename... Args>
-inline std::string signature(const Arg&, const Args& ... remainder)
+inline std::string signature(const Arg&, const Args& ...)
 {
-    static const std::string s = atomic_signature<Arg>() + signature(remainder...);
-    return s;
+    return ConcatenateStaticSignatures<
+            typename TypeMapper<Arg>::StaticSignatureType,
+            typename TypeMapper<Args>::StaticSignatureType...
+    >::Type::value;
 }
 }
 }
@@ -23,8 +23,10 @@
 #include <core/dbus/types/any.h>
 #include <core/dbus/types/object_path.h>
 #include <core/dbus/types/signature.h>
+#include <core/dbus/types/unique_fd.h>
 #include <core/dbus/types/unix_fd.h>
 
+#include <cstddef>
 #include <cstdint>
 
 #include <list>
@@ -43,6 +45,53 @@ class Variant;
 }
 namespace helper
 {
+/**
+ * @brief Models a DBus type signature that is known at compile time.
+ *
+ * The signature is available as a null-terminated character array that can
+ * be handed to libdbus directly, without any runtime allocation.
+ *
+ * @tparam Chars The characters making up the signature.
+ */
+template<char... Chars>
+struct StaticSignature
+{
+    /** @brief The number of characters in the signature, excluding the terminating null. */
+    static constexpr std::size_t size = sizeof...(Chars);
+    /** @brief The null-terminated signature. */
+    static constexpr char value[sizeof...(Chars) + 1] = {Chars..., '\0'};
+};
+
+template<char... Chars>
+constexpr std::size_t StaticSignature<Chars...>::size;
+
+template<char... Chars>
+constexpr char StaticSignature<Chars...>::value[sizeof...(Chars) + 1];
+
+/**
+ * @brief Concatenates an arbitrary number of StaticSignature instances at compile time.
+ * @tparam Signatures Instances of StaticSignature.
+ */
+template<typename... Signatures>
+struct ConcatenateStaticSignatures;
+
+template<>
+struct ConcatenateStaticSignatures<>
+{
+    typedef StaticSignature<> Type;
+};
+
+template<char... Chars>
+struct ConcatenateStaticSignatures<StaticSignature<Chars...>>
+{
+    typedef StaticSignature<Chars...> Type;
+};
+
+template<char... Lhs, char... Rhs, typename... Tail>
+struct ConcatenateStaticSignatures<StaticSignature<Lhs...>, StaticSignature<Rhs...>, Tail...>
+{
+    typedef typename ConcatenateStaticSignatures<StaticSignature<Lhs..., Rhs...>, Tail...>::Type Type;
+};
 
 template<ArgumentType Type>
 struct DBusTypeMapper
@@ -103,6 +152,16 @@ struct DBusTypeMapper<ArgumentType::floating_point>
     typedef double Type;
 };
 
+/**
+ * @brief Maps a C++ type to its DBus representation.
+ *
+ * Specializations provide a typedef StaticSignatureType, an instance of
+ * StaticSignature describing the DBus signature of T. Composite types
+ * derive their signature from the ones of their elements at compile time,
+ * such that using a type without a DBus representation is a compile-time error.
+ *
+ * @tparam T The C++ type to map.
+ */
 template<typename T>
 struct TypeMapper
 {
@@ -116,6 +175,8 @@ struct TypeMapper
 template<>
 struct TypeMapper<bool>
 {
+    typedef StaticSignature<DBUS_TYPE_BOOLEAN> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::boolean;
@@ -138,6 +199,8 @@ struct TypeMapper<bool>
 template<>
 struct TypeMapper<std::int8_t>
 {
+    typedef StaticSignature<DBUS_TYPE_BYTE> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::byte;
@@ -160,6 +223,8 @@ struct TypeMapper<std::int8_t>
 template<>
 struct TypeMapper<std::int16_t>
 {
+    typedef StaticSignature<DBUS_TYPE_INT16> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::int16;
@@ -182,6 +247,8 @@ struct TypeMapper<std::int16_t>
 template<>
 struct TypeMapper<std::uint16_t>
 {
+    typedef StaticSignature<DBUS_TYPE_UINT16> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::uint16;
@@ -204,6 +271,8 @@ struct TypeMapper<std::uint16_t>
 template<>
 struct TypeMapper<std::int32_t>
 {
+    typedef StaticSignature<DBUS_TYPE_INT32> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::int32;
@@ -226,6 +295,8 @@ struct TypeMapper<std::int32_t>
 template<>
 struct TypeMapper<std::uint32_t>
 {
+    typedef StaticSignature<DBUS_TYPE_UINT32> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::uint32;
@@ -248,6 +319,8 @@ struct TypeMapper<std::uint32_t>
 template<>
 struct TypeMapper<std::int64_t>
 {
+    typedef StaticSignature<DBUS_TYPE_INT64> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::int64;
@@ -270,6 +343,8 @@ struct TypeMapper<std::int64_t>
 template<>
 struct TypeMapper<std::uint64_t>
 {
+    typedef StaticSignature<DBUS_TYPE_UINT64> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::uint64;
@@ -292,6 +367,8 @@ struct TypeMapper<std::uint64_t>
 template<>
 struct TypeMapper<float>
 {
+    typedef StaticSignature<DBUS_TYPE_DOUBLE> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::floating_point;
@@ -314,6 +391,8 @@ struct TypeMapper<float>
 template<>
 struct TypeMapper<double>
 {
+    typedef StaticSignature<DBUS_TYPE_DOUBLE> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::floating_point;
@@ -336,6 +415,8 @@ struct TypeMapper<double>
 template<>
 struct TypeMapper<types::ObjectPath>
 {
+    typedef StaticSignature<DBUS_TYPE_OBJECT_PATH> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::object_path;
@@ -358,6 +439,8 @@ struct TypeMapper<types::ObjectPath>
 template<>
 struct TypeMapper<types::Signature>
 {
+    typedef StaticSignature<DBUS_TYPE_SIGNATURE> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::signature;
@@ -380,6 +463,32 @@ struct TypeMapper<types::Signature>
 template<>
 struct TypeMapper<types::UnixFd>
 {
+    typedef StaticSignature<DBUS_TYPE_UNIX_FD> StaticSignatureType;
+
+    constexpr inline static ArgumentType type_value()
+    {
+        return ArgumentType::unix_fd;
+    }
+    constexpr inline static bool is_basic_type()
+    {
+        return true;
+    }
+    constexpr inline static bool requires_signature()
+    {
+        return true;
+    }
+
+    inline static std::string signature()
+    {
+        return DBUS_TYPE_UNIX_FD_AS_STRING;
+    }
+};
+
+template<>
+struct TypeMapper<types::UniqueFd>
+{
+    typedef StaticSignature<DBUS_TYPE_UNIX_FD> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::unix_fd;
@@ -402,6 +511,8 @@ struct TypeMapper<types::UnixFd>
 template<>
 struct TypeMapper<types::Variant>
 {
+    typedef StaticSignature<DBUS_TYPE_VARIANT> StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::variant;
@@ -420,6 +531,17 @@ struct TypeMapper<types::Variant>
         return DBUS_TYPE_VARIANT_AS_STRING;
     }
 };
+
+/**
+ * @brief Provides the DBus signature of T as a compile-time constant.
+ * @tparam T The type to query the signature for.
+ * @return A null-terminated string with static storage duration.
+ */
+template<typename T>
+constexpr inline const char* static_signature()
+{
+    return TypeMapper<T>::StaticSignatureType::value;
+}
 }
 }
 }
@@ -77,7 +77,7 @@ inline Result<ResultType> Object::invoke_method_synchronously(const Args& ... ar
     auto writer = msg->writer();
     encode_message(writer, args...);
 
-    auto reply = parent->get_connection()->send_with_reply_and_block_for_at_most(
+    auto reply = parent->connection_for_method_call(object_path)->send_with_reply_and_block_for_at_most(
                 msg,
                 Method::default_timeout());
 
@@ -107,7 +107,7 @@ inline std::future<Result<ResultType>> Object::invoke_method_asynchronously(cons
     encode_message(writer, args...);
 
     auto pending_call =
-            parent->get_connection()->send_with_reply_and_timeout(
+            parent->connection_for_method_call(object_path)->send_with_reply_and_timeout(
                 msg, Method::default_timeout());
     
     auto promise = std::make_shared<std::promise<Result<ResultType>>>();
@@ -140,7 +140,7 @@ inline void Object::invoke_method_asynchronously_with_callback(
     encode_message(writer, args...);
 
     auto pending_call =
-            parent->get_connection()->send_with_reply_and_timeout(
+            parent->connection_for_method_call(object_path)->send_with_reply_and_timeout(
                 msg, Method::default_timeout());
 
     pending_call->then([cb](const Message::Ptr& reply)
@@ -194,10 +194,10 @@ Object::get_property()
 
         // [1.2.2] Enable dispatching of changes.
         std::weak_ptr<PropertyType> wp{property};
-        property_changed_vtable[std::make_tuple(itf, name)] = [wp](const types::Variant& arg)
+        property_changed_vtable[std::make_tuple(itf, name)] = [wp](Message::Reader& reader)
         {
             if (auto sp = wp.lock())
-                sp->handle_changed(arg);
+                sp->handle_changed(reader);
         };
 
         return property;
@@ -277,13 +277,7 @@ inline Object::Object(
     const types::ObjectPath& path)
         : parent(parent),
           object_path(path),
-          signal_router
-          {
-              [](const Message::Ptr& msg)
-              {
-                  return SignalKey {msg->interface(), msg->member()};
-              }
-          },
+          properties_changed_route(0),
           method_router
           {
               [](const Message::Ptr& msg)
@@ -310,12 +304,6 @@ inline Object::Object(
               }
           }
 {
-    parent->get_connection()->access_signal_router().install_route(
-        object_path,
-        std::bind(&MessageRouter<SignalKey>::operator(),
-                  std::ref(signal_router),
-                  std::placeholders::_1));
-
     if (!parent->is_stub())
     {
         install_method_handler<interfaces::Properties::Get>(
@@ -333,25 +321,24 @@ inline Object::Object(
     {
         // We centrally route org.freedesktop.DBus.Properties.PropertiesChanged
         // through the object, which in turn routes via a custom Property cache.
-        signal_router.install_route(
-            SignalKey{
-                traits::Service<interfaces::Properties>::interface_name(), 
-                interfaces::Properties::Signals::PropertiesChanged::name()
-            },
-            // Passing 'this' is fine as the lifetime of the signal_router is upper limited
-            // by the lifetime of 'this'.
+        properties_changed_route = route_signals(
+            MatchRule()
+                .type(Message::Type::signal)
+                .interface(traits::Service<interfaces::Properties>::interface_name())
+                .member(interfaces::Properties::Signals::PropertiesChanged::name()),
+            // Passing 'this' is fine as the route is uninstalled when destroying 'this'.
             [this](const Message::Ptr& msg)
             {
-                interfaces::Properties::Signals::PropertiesChanged::ArgumentType arg;
-                msg->reader() >> arg;
-                on_properties_changed(arg);
+                auto reader = msg->reader();
+                on_properties_changed(reader);
             });
     }
 }
 
 inline Object::~Object()
 {
-    parent->get_connection()->access_signal_router().uninstall_route(object_path);
+    if (parent->is_stub())
+        unroute_signals(properties_changed_route);
     parent->get_connection()->unregister_object_path(object_path);
 
     auto mr = MatchRule()
@@ -379,18 +366,30 @@ inline void Object::remove_match(const MatchRule& rule)
     parent->remove_match(rule.path(object_path));
 }
 
-inline void Object::on_properties_changed(
-        const interfaces::Properties::Signals::PropertiesChanged::ArgumentType& arg)
+inline MatchRuleIndex::Token Object::route_signals(const MatchRule& rule, const MatchRuleIndex::Handler& handler)
+{
+    return parent->get_connection()->access_match_rule_index().install(rule.path(object_path), handler);
+}
+
+inline void Object::unroute_signals(MatchRuleIndex::Token token)
+{
+    parent->get_connection()->access_match_rule_index().uninstall(token);
+}
+
+inline void Object::on_properties_changed(Message::Reader& reader)
 {
-    const auto& interface = std::get<0>(arg);
-    const auto& changed_values = std::get<1>(arg);
+    // We walk the (s a{sv} as) argument in place and only decode the values
+    // of properties that we have handlers for. Invalidated properties are ignored.
+    const std::string interface{reader.pop_string()};
+    auto changed_values = reader.pop_array();
 
-    for (const auto& value : changed_values)
+    while (changed_values.type() != ArgumentType::invalid)
     {
-        auto it = property_changed_vtable.find(std::make_tuple(interface, value.first));
+        auto entry = changed_values.pop_dict_entry();
+        auto it = property_changed_vtable.find(std::make_tuple(interface, std::string{entry.pop_string()}));
         if (it != property_changed_vtable.end())
         {
-            it->second(value.second);
+            it->second(entry);
         }
     }
 }
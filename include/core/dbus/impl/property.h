@@ -177,11 +177,13 @@ Property<PropertyType>::handle_set(const Message::Ptr& msg)
 
 template<typename PropertyType>
 void
-Property<PropertyType>::handle_changed(const types::Variant& arg)
+Property<PropertyType>::handle_changed(Message::Reader& reader)
 {
     try
     {
-        auto value = arg.as<typename PropertyType::ValueType>();
+        typename PropertyType::ValueType value;
+        auto variant = types::Variant::decode(value);
+        Codec<types::Variant>::decode_argument(reader, variant);
         Super::set(value);
     }
     catch (const std::exception &e){
@@ -31,7 +31,7 @@ inline Signal<SignalDescription, Argument>::~Signal() noexcept
 {
     signal_about_to_be_destroyed();
 
-    parent->signal_router.uninstall_route(Object::SignalKey{interface, name});
+    parent->unroute_signals(route);
     try
     {
         parent->remove_match(rule);
@@ -56,7 +56,9 @@ inline typename Signal<SignalDescription, Argument>::SubscriptionToken
 Signal<SignalDescription, Argument>::connect(const Handler& h)
 {
     std::lock_guard<std::mutex> lg(handlers_guard);
-    return handlers.insert(handlers.end(), h);
+    auto token = handlers.insert(handlers.end(), h);
+    publish_snapshot();
+    return token;
 }
 
 template<typename SignalDescription, typename Argument>
@@ -66,6 +68,17 @@ Signal<SignalDescription, Argument>::disconnect(
 {
     std::lock_guard<std::mutex> lg(handlers_guard);
     handlers.erase(token);
+    publish_snapshot();
+}
+
+template<typename SignalDescription, typename Argument>
+inline void
+Signal<SignalDescription, Argument>::publish_snapshot()
+{
+    std::atomic_store(
+        &snapshot,
+        std::shared_ptr<const std::vector<Handler>>{
+            new std::vector<Handler>(handlers.begin(), handlers.end())});
 }
 
 template<typename SignalDescription, typename Argument>
@@ -115,13 +128,13 @@ inline Signal<SignalDescription, Argument>::Signal(
                                interface(interface),
                                name(name)
 {
-    parent->signal_router.install_route(
-        Object::SignalKey {interface, name},
+    rule = rule.type(Message::Type::signal).interface(interface).member(name);
+    route = parent->route_signals(
+        rule,
         std::bind(
             &Signal<SignalDescription>::operator(),
             this,
             std::placeholders::_1));
-    rule = rule.type(Message::Type::signal).interface(interface).member(name);
     parent->add_match(rule);
 }
 
@@ -129,8 +142,11 @@ template<typename SignalDescription, typename Argument>
 inline void
 Signal<SignalDescription, Argument>::operator()(const Message::Ptr&)
 {
-    std::lock_guard<std::mutex> lg(handlers_guard);
-    for (auto handler : handlers)
+    auto handlers = std::atomic_load(&snapshot);
+    if (!handlers)
+        return;
+
+    for (const Handler& handler : *handlers)
         handler();
 }
 
@@ -144,8 +160,7 @@ inline Signal<
 {
     d->signal_about_to_be_destroyed();
 
-    d->parent->signal_router.uninstall_route(
-        Object::SignalKey{d->interface, d->name});
+    d->parent->unroute_signals(d->route);
 
     // Iterate through the unique keys in the map
     for (auto it = d->handlers.begin(); it != d->handlers.end();
@@ -215,6 +230,7 @@ Signal<
     bool new_entry = (d->handlers.find(match_args) == d->handlers.cend());
 
     SubscriptionToken token = d->handlers.insert(std::make_pair(match_args, h));
+    publish_snapshot();
 
     if (new_entry)
         d->parent->add_match(d->rule.args(match_args));
@@ -236,6 +252,8 @@ Signal<
 
     MatchRule::MatchArgs match_args(token->first);
     d->handlers.erase(token);
+    publish_snapshot();
+
     if (d->handlers.count(match_args) == 0)
     {
         d->parent->remove_match(d->rule.args(match_args));
@@ -303,14 +321,13 @@ inline Signal<
               const std::string& name)
         : d{new Shared{parent, interface, name}}
 {
-    d->parent->signal_router.install_route(
-        Object::SignalKey {interface, name},
+    d->rule = d->rule.type(Message::Type::signal).interface(interface).member(name);
+    d->route = d->parent->route_signals(
+        d->rule,
         std::bind(
             &Signal<SignalDescription, typename SignalDescription::ArgumentType>::operator(),
             this,
             std::placeholders::_1));
-
-    d->rule = d->rule.type(Message::Type::signal).interface(interface).member(name);
 }
 
 template<typename SignalDescription>
@@ -324,42 +341,63 @@ Signal<
 {
     try
     {
+        // Handlers are invoked without holding handlers_guard, such that they
+        // are free to connect and disconnect. The snapshot keeps the handlers
+        // alive until dispatch finishes.
+        auto snapshot = std::atomic_load(&d->snapshot);
+        if (!snapshot)
+            return;
+
         typename SignalDescription::ArgumentType value;
         msg->reader() >> value;
-        std::lock_guard<std::mutex> lg(d->handlers_guard);
-        for (auto it : d->handlers)
+
+        // Handlers without match args are invoked for every signal.
+        for (const Handler& handler : snapshot->unconditional)
+            handler(value);
+
+        if (snapshot->by_match_arg.empty())
+            return;
+
+        // Extract all string arguments referenced by any match arg in a single pass.
+        std::vector<const char*> args(*snapshot->referenced_args.rbegin() + 1, nullptr);
+        auto reader = msg->reader();
+        for (std::size_t i = 0; i < args.size() && reader.type() != dbus::ArgumentType::invalid; ++i)
         {
-            const MatchRule::MatchArgs& match_args(it.first);
-            const Handler &handler(it.second);
+            if (reader.type() == dbus::ArgumentType::string && snapshot->referenced_args.count(i) > 0)
+                args[i] = reader.pop_string();
+            else
+                reader.pop();
+        }
 
-            if (!match_args.empty())
-            {
-                bool matched = true;
-                for(const MatchRule::MatchArg& arg: match_args)
-                {
-                    std::size_t index = arg.first;
-                    const std::string& value = arg.second;
+        // Every handler is indexed by its first match arg, so we only visit
+        // handlers that match at least one of the extracted arguments.
+        for (std::size_t index : snapshot->referenced_args)
+        {
+            const char* arg = args[index];
+            if (!arg)
+                continue;
 
-                    // FIXME This code is probably bad, it starts reading the arguments
-                    // from the beginning each time
-                    auto reader = msg->reader();
+            auto candidates = snapshot->by_match_arg.equal_range(
+                        std::make_pair(index, std::string{arg}));
 
-                    // Wind the reader forward until we get to the desired point
-                    for (std::size_t i(0); i < index && reader.type() != dbus::ArgumentType::invalid; ++i)
-                        reader.pop();
+            for (auto it = candidates.first; it != candidates.second; ++it)
+            {
+                const MatchRule::MatchArgs& match_args(it->second.first);
 
-                    if (value != reader.pop_string())
+                bool matched = true;
+                for (const MatchRule::MatchArg& match_arg : match_args)
+                {
+                    const char* candidate = args[match_arg.first];
+                    if (!candidate || match_arg.second != candidate)
                     {
                         matched = false;
-                        continue;
+                        break;
                     }
                 }
 
-                if (!matched)
-                    continue;
+                if (matched)
+                    it->second.second(value);
             }
-
-            handler(value);
         }
     }
     catch (const std::runtime_error& e)
@@ -368,6 +406,35 @@ Signal<
     }
 }
 
+template<typename SignalDescription>
+inline void
+Signal<
+    SignalDescription,
+    typename std::enable_if<
+        is_not_void<typename SignalDescription::ArgumentType>::value,
+        typename SignalDescription::ArgumentType>::type
+    >::publish_snapshot()
+{
+    std::shared_ptr<Snapshot> snapshot{new Snapshot()};
+
+    for (const auto& pair : d->handlers)
+    {
+        const MatchRule::MatchArgs& match_args(pair.first);
+
+        if (match_args.empty())
+        {
+            snapshot->unconditional.push_back(pair.second);
+            continue;
+        }
+
+        snapshot->by_match_arg.insert(std::make_pair(match_args.front(), pair));
+        for (const MatchRule::MatchArg& arg : match_args)
+            snapshot->referenced_args.insert(arg.first);
+    }
+
+    std::atomic_store(&d->snapshot, std::shared_ptr<const Snapshot>{snapshot});
+}
+
 template<typename SignalDescription>
 inline Signal<
     SignalDescription,
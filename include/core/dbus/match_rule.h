@@ -31,6 +31,8 @@ namespace core
 {
 namespace dbus
 {
+class MatchRuleIndex;
+
 /**
  * @brief Wraps a DBus match rule.
  */
@@ -77,6 +79,20 @@ public:
      */
     MatchRule sender(const std::string& s) const;
 
+    /**
+     * @brief Adjusts the destination that this rule applies to.
+     * @param d The new destination, i.e., the unique name of a connection.
+     * @return The match rule instance.
+     */
+    MatchRule& destination(const std::string& d);
+
+    /**
+     * @brief Adjusts the destination that this rule applies to.
+     * @param d The new destination, i.e., the unique name of a connection.
+     * @return A new match rule instance.
+     */
+    MatchRule destination(const std::string& d) const;
+
     /**
      * @brief Adjusts the interface that this rule applies to.
      * @param i The new interface.
@@ -119,6 +135,24 @@ public:
      */
     MatchRule path(const types::ObjectPath& p) const;
 
+    /**
+     * @brief Adjusts the path namespace that this rule applies to.
+     *
+     * A rule with a path namespace matches messages sent from the given path
+     * and from all paths below it. The path namespace takes precedence over
+     * a path set with MatchRule::path.
+     * @param p The root of the new path namespace.
+     * @return The match rule instance.
+     */
+    MatchRule& path_namespace(const types::ObjectPath& p);
+
+    /**
+     * @brief Adjusts the path namespace that this rule applies to.
+     * @param p The root of the new path namespace.
+     * @return A new match rule instance.
+     */
+    MatchRule path_namespace(const types::ObjectPath& p) const;
+
     /**
      * @brief Adjusts the string method arguments that this rule applies to.
      * @param p The new method arguments.
@@ -133,6 +167,54 @@ public:
      */
     MatchRule& args(const MatchArgs& p) const;
 
+    /**
+     * @brief Adjusts the object path method arguments that this rule applies to.
+     *
+     * An argument matches if it is equal to the given path, or if either one
+     * is a namespace of the other, i.e., ends with '/' and is a prefix of it.
+     * @param p The new method arguments.
+     * @return The match rule instance.
+     */
+    MatchRule& arg_paths(const MatchArgs& p);
+
+    /**
+     * @brief Adjusts the object path method arguments that this rule applies to.
+     * @param p The new method arguments.
+     * @return A new match rule instance.
+     */
+    MatchRule arg_paths(const MatchArgs& p) const;
+
+    /**
+     * @brief Adjusts the bus or interface name namespace that the first argument has to be in.
+     *
+     * For example, "com.example" matches "com.example" and "com.example.Foo",
+     * but not "com.examples".
+     * @param n The new namespace.
+     * @return The match rule instance.
+     */
+    MatchRule& arg0_namespace(const std::string& n);
+
+    /**
+     * @brief Adjusts the bus or interface name namespace that the first argument has to be in.
+     * @param n The new namespace.
+     * @return A new match rule instance.
+     */
+    MatchRule arg0_namespace(const std::string& n) const;
+
+    /**
+     * @brief Adjusts whether this rule should match messages not addressed to this connection.
+     * @param e true to eavesdrop, false otherwise.
+     * @return The match rule instance.
+     */
+    MatchRule& eavesdrop(bool e);
+
+    /**
+     * @brief Adjusts whether this rule should match messages not addressed to this connection.
+     * @param e true to eavesdrop, false otherwise.
+     * @return A new match rule instance.
+     */
+    MatchRule eavesdrop(bool e) const;
+
     /**
      * @brief Constructs a valid match rule string from this instance.
      * @return A string formatted according to DBus match rule rules.
@@ -140,6 +222,8 @@ public:
     std::string as_string() const;
 
 private:
+    friend class MatchRuleIndex;
+
     struct Private;
     std::unique_ptr<Private> d;
 };
@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_MATCH_RULE_INDEX_H_
+#define CORE_DBUS_MATCH_RULE_INDEX_H_
+
+#include <core/dbus/match_rule.h>
+#include <core/dbus/message.h>
+#include <core/dbus/visibility.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace core
+{
+namespace dbus
+{
+/**
+ * @brief Evaluates incoming messages against a set of match rules in-process.
+ *
+ * Rules are indexed by interface, member and path, such that a message is
+ * only evaluated against the rules that can possibly match it, independent
+ * of the total number of installed rules. Rules for a path namespace are
+ * evaluated for every message of their interface and member. The remaining criteria, including
+ * string, path and namespace argument matches, are checked in a single
+ * pass over the message arguments.
+ *
+ * The index mirrors the evaluation done by the daemon, with one exception:
+ * a rule for a well-known sender name matches messages from any sender, as
+ * resolving the owner of a name requires a round trip to the daemon. Use
+ * the index together with the same rules installed via Bus::add_match to
+ * have the daemon filter by sender.
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC MatchRuleIndex
+{
+public:
+    /**
+     * @brief Handler is a function type that handles raw DBus messages.
+     */
+    typedef std::function<void(const Message::Ptr&)> Handler;
+
+    /**
+     * @brief Token refers to a rule installed with the index.
+     */
+    typedef std::uint64_t Token;
+
+    MatchRuleIndex();
+    ~MatchRuleIndex();
+
+    MatchRuleIndex(const MatchRuleIndex&) = delete;
+    MatchRuleIndex& operator=(const MatchRuleIndex&) = delete;
+
+    /**
+     * @brief Installs a handler for messages matching the given rule in a thread-safe manner.
+     * @param rule The rule a message has to match for the handler to be invoked.
+     * @param handler The handler to install, must not be empty.
+     * @return A token referring to the installed rule.
+     */
+    Token install(const MatchRule& rule, const Handler& handler);
+
+    /**
+     * @brief Uninstalls a previously installed rule in a thread-safe manner.
+     * @param token The token returned when installing the rule.
+     */
+    void uninstall(Token token);
+
+    /**
+     * @brief Queries the number of installed rules.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Evaluates a message against the installed rules and invokes all matching handlers.
+     *
+     * Handlers are invoked in the order of installation, without holding
+     * any lock, i.e., they are free to modify the index.
+     * @param msg The message to evaluate, must not be null.
+     * @return true if at least one handler has been invoked, false otherwise.
+     */
+    bool operator()(const Message::Ptr& msg);
+
+private:
+    struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Private;
+    std::unique_ptr<Private> d;
+};
+}
+}
+
+#endif // CORE_DBUS_MATCH_RULE_INDEX_H_
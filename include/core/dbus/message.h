@@ -23,20 +23,26 @@
 
 #include <core/dbus/types/object_path.h>
 #include <core/dbus/types/signature.h>
+#include <core/dbus/types/unique_fd.h>
 #include <core/dbus/types/unix_fd.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <map>
 #include <memory>
 #include <ostream>
 #include <stdexcept>
+#include <vector>
 
 namespace core
 {
 namespace dbus
 {
 template<typename T> struct Codec;
+class DecodePlan;
 class Error;
+class MatchRuleIndex;
 
 /**
  * @brief The Message class wraps a raw DBus message
@@ -146,9 +152,15 @@ public:
 
         /**
          * @brief Reads a unix fd from the underlying message.
+         * @return A duplicate of the fd carried by the message, to be closed by the caller.
          */
         types::UnixFd pop_unix_fd();
 
+        /**
+         * @brief Reads a unix fd from the underlying message, taking ownership of the duplicate.
+         */
+        types::UniqueFd pop_unique_fd();
+
         /**
          * @brief Prepares reading of an array from the underlying message.
          * @return A reader pointing to the array.
@@ -167,6 +179,16 @@ public:
          */
         Reader pop_variant();
 
+        /**
+         * @brief Reads a variant containing a single value of basic type in place.
+         *
+         * In contrast to pop_variant, no nested reader is created. Variants containing
+         * values of compound type or unix fds are left untouched.
+         * @param [out] value Receives the contained value. Strings point into the underlying message.
+         * @return The type of the contained value, or ArgumentType::invalid if the reader has not been advanced.
+         */
+        ArgumentType pop_basic_variant(DBusBasicValue& value);
+
         /**
          * @brief Prepares reading of a dict entry from the underlying message.
          * @return A reader pointing to the array.
@@ -175,6 +197,7 @@ public:
 
     private:
         friend class Message;
+        friend class DecodePlan;
         explicit Reader(const std::shared_ptr<Message>& msg);
 
         const std::shared_ptr<Message>& access_message();
@@ -258,15 +281,30 @@ public:
 
         /**
          * @brief Writes a unix fd to the underlying message.
+         *
+         * The message carries a duplicate of the fd, value stays owned by the caller.
          */
         void push_unix_fd(const types::UnixFd& value);
 
+        /**
+         * @brief Writes a unix fd to the underlying message, handing over ownership.
+         *
+         * The fd is closed right away, the message carrying the only remaining copy.
+         */
+        void push_unique_fd(types::UniqueFd value);
+
         /**
          * @brief Prepares writing of an array to the underlying message.
          * @param [in] signature The signature of the contained data type.
          */
         Writer open_array(const types::Signature& signature);
 
+        /**
+         * @brief Prepares writing of an array to the underlying message.
+         * @param [in] signature The null-terminated signature of the contained data type.
+         */
+        Writer open_array(const char* signature);
+
         /**
          * @brief Finalizes writing of an array to the underlying message.
          */
@@ -288,11 +326,26 @@ public:
          */
         Writer open_variant(const types::Signature& signature);
 
+        /**
+         * @brief Prepares writing of a variant to the underlying message.
+         * @param [in] signature The null-terminated signature of the contained data type.
+         */
+        Writer open_variant(const char* signature);
+
         /**
          * @brief Finalizes writing of a variant to the underlying message.
          */
         void close_variant(Writer writer);
 
+        /**
+         * @brief Writes a variant containing a single value of basic type in place.
+         *
+         * In contrast to open_variant, no nested writer is created.
+         * @param [in] type The basic type of the value.
+         * @param [in] value The value, strings are referenced by value.str.
+         */
+        void push_basic_variant(ArgumentType type, const DBusBasicValue& value);
+
         /**
          * @brief Prepares writing of a dict entry to the underlying message.
          */
@@ -364,6 +417,14 @@ public:
      */
     static std::shared_ptr<Message> from_raw_message(DBusMessage* msg);
 
+    /**
+     * @brief deserialize creates an instance of message from its wire form.
+     * @param data Points to size bytes as produced by serialize().
+     * @return An instance of Message with a type corresponding to the serialized message.
+     * @throw std::runtime_error if the bytes do not form a valid message.
+     */
+    static std::shared_ptr<Message> deserialize(const void* data, std::size_t size);
+
     ~Message();
 
     /**
@@ -422,6 +483,22 @@ public:
      */
     Writer writer();
 
+    /**
+     * @brief Produces the wire form of the message, to be restored with deserialize().
+     *
+     * A message that has not been sent yet carries no serial, it is serialized
+     * with a placeholder serial of 1 instead.
+     * @throw std::runtime_error if the message carries unix fds, which cannot outlive the process.
+     */
+    std::vector<std::uint8_t> serialize() const;
+
+    /**
+     * @brief Creates a deep copy of the message that can be modified and sent again.
+     *
+     * The copy carries no serial, is not locked and keeps all other header fields and arguments.
+     */
+    std::shared_ptr<Message> clone();
+
     /**
      * @brief Meant for testing purposes only.
      */
@@ -429,8 +506,7 @@ public:
 
 private:
     friend class Bus;
-
-    std::shared_ptr<Message> clone();
+    friend class MatchRuleIndex;
 
     struct Private;
     std::unique_ptr<Private> d;
@@ -0,0 +1,160 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_MESSAGE_LOG_H_
+#define CORE_DBUS_MESSAGE_LOG_H_
+
+#include <core/dbus/message.h>
+#include <core/dbus/visibility.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace core
+{
+namespace dbus
+{
+/**
+ * @brief The MessageLog class describes an append-only file of serialized messages.
+ *
+ * A log starts with a 16 byte header: the magic "DBUSCPPL", followed by
+ * the format version as uint32 and a reserved uint32. Every entry consists
+ * of its timestamp in nanoseconds as uint64, a caller-defined tag as uint32,
+ * the size of the message as uint32 and finally the message in wire form,
+ * refer to Message::serialize(). Integers are stored in host byte order,
+ * messages carry their own.
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC MessageLog
+{
+public:
+    /** @brief The version of the format written by this implementation. */
+    static constexpr std::uint32_t version = 1;
+
+    /**
+     * @brief The Errors struct summarizes all exceptions thrown by
+     * methods of class MessageLog.
+     */
+    struct Errors
+    {
+        Errors() = delete;
+
+        /**
+         * @brief The NotAMessageLog exception is thrown if a file does not start with a valid log header.
+         */
+        struct NotAMessageLog : public std::runtime_error
+        {
+            inline NotAMessageLog()
+                : std::runtime_error(
+                      "The file does not start with a header of a supported message log.")
+            {
+            }
+        };
+    };
+
+    /**
+     * @brief The Entry struct models an individual message in the log.
+     */
+    struct Entry
+    {
+        /** @brief Time of recording, nanoseconds since the epoch by default. */
+        std::chrono::nanoseconds timestamp;
+        /** @brief Caller-defined tag, e.g., the direction of the message. */
+        std::uint32_t tag;
+        /** @brief The recorded message. */
+        Message::Ptr message;
+    };
+
+    /**
+     * @brief The Writer class appends messages to a log. Appending is thread-safe.
+     */
+    class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Writer
+    {
+    public:
+        /**
+         * @brief Opens the log at path for appending, creating it if it does not exist yet.
+         *
+         * An incomplete entry at the end of an existing log, e.g., left behind
+         * by a process that died while appending, is dropped.
+         * @throw std::runtime_error if the file cannot be opened or repaired.
+         * @throw Errors::NotAMessageLog if the existing file is not a log.
+         */
+        explicit Writer(const std::string& path);
+        ~Writer();
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        /**
+         * @brief Appends msg, timestamped with the current time.
+         * @throw std::runtime_error if the message cannot be serialized or written.
+         */
+        void append(const Message::Ptr& msg, std::uint32_t tag = 0);
+
+        /**
+         * @brief Appends msg with an explicit timestamp.
+         * @throw std::runtime_error if the message cannot be serialized or written.
+         */
+        void append(const Message::Ptr& msg, const std::chrono::nanoseconds& timestamp, std::uint32_t tag);
+
+        /**
+         * @brief Flushes all appended entries to the file.
+         */
+        void flush();
+
+    private:
+        struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Private;
+        std::unique_ptr<Private> d;
+    };
+
+    /**
+     * @brief The Reader class iterates over the entries of a log, in the order they were appended.
+     */
+    class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Reader
+    {
+    public:
+        /**
+         * @brief Opens the log at path for reading.
+         * @throw std::runtime_error if the file cannot be opened.
+         * @throw Errors::NotAMessageLog if the file is not a log.
+         */
+        explicit Reader(const std::string& path);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        /**
+         * @brief Reads the next entry.
+         *
+         * An entry cut short, e.g., by the writer crashing, is treated like the end of the log.
+         * @return false if the end of the log has been reached.
+         * @throw std::runtime_error if an entry does not contain a valid message.
+         */
+        bool next(Entry& entry);
+
+    private:
+        struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Private;
+        std::unique_ptr<Private> d;
+    };
+
+    MessageLog() = delete;
+};
+}
+}
+
+#endif // CORE_DBUS_MESSAGE_LOG_H_
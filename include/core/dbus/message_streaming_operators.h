@@ -20,6 +20,8 @@
 
 #include <core/dbus/codec.h>
 
+#include <utility>
+
 namespace core
 {
 namespace dbus
@@ -37,6 +39,15 @@ Message::Writer operator<<(Message::Writer writer, const T& out)
     encode_argument(writer, out);
     return writer;
 }
+
+/**
+ * @brief Hands ownership of value over to the message, instead of having it duplicated.
+ */
+inline Message::Writer operator<<(Message::Writer writer, types::UniqueFd&& value)
+{
+    writer.push_unique_fd(std::move(value));
+    return writer;
+}
 }
 }
 
@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_NAME_WATCH_REGISTRY_H_
+#define CORE_DBUS_NAME_WATCH_REGISTRY_H_
+
+#include <core/dbus/visibility.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace core
+{
+namespace dbus
+{
+class Bus;
+
+/**
+ * @brief Multiplexes watches for bus name owner changes over a single subscription.
+ *
+ * The registry installs a single NameOwnerChanged match rule with the daemon
+ * for as long as at least one watch is installed, independent of the number
+ * of watched names. Incoming signals are dispatched to the watches for the
+ * affected name through a hash lookup. In turn, the connection receives the
+ * owner changes for all names on the bus.
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC NameWatchRegistry
+{
+public:
+    /**
+     * @brief Handler is invoked with the old and the new owner of a watched name.
+     */
+    typedef std::function<void(const std::string& old_owner, const std::string& new_owner)> Handler;
+
+    /**
+     * @brief Token refers to a watch installed with the registry.
+     */
+    typedef std::uint64_t Token;
+
+    /**
+     * @brief Creates a registry for the given bus, which has to outlive the registry.
+     */
+    explicit NameWatchRegistry(Bus& bus);
+    ~NameWatchRegistry();
+
+    NameWatchRegistry(const NameWatchRegistry&) = delete;
+    NameWatchRegistry& operator=(const NameWatchRegistry&) = delete;
+
+    /**
+     * @brief Installs a watch for owner changes of the given name in a thread-safe manner.
+     * @throw std::runtime_error if the match rule cannot be installed with the daemon.
+     * @param name The name to watch.
+     * @param handler The handler to invoke on owner changes, must not be empty.
+     * @return A token referring to the installed watch.
+     */
+    Token watch(const std::string& name, const Handler& handler);
+
+    /**
+     * @brief Uninstalls a previously installed watch in a thread-safe manner.
+     * @param token The token returned when installing the watch.
+     */
+    void unwatch(Token token);
+
+    /**
+     * @brief Queries the number of installed watches.
+     */
+    std::size_t size() const;
+
+private:
+    struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Private;
+    std::shared_ptr<Private> d;
+};
+}
+}
+
+#endif // CORE_DBUS_NAME_WATCH_REGISTRY_H_
@@ -20,6 +20,7 @@
 
 #include <core/dbus/bus.h>
 #include <core/dbus/lifetime_constrained_cache.h>
+#include <core/dbus/match_rule_index.h>
 #include <core/dbus/service.h>
 
 #include <functional>
@@ -224,19 +225,22 @@ class Object : public std::enable_shared_from_this<Object>
 
     void add_match(const MatchRule& rule);
     void remove_match(const MatchRule& rule);
-    void on_properties_changed(
-            const interfaces::Properties::Signals::PropertiesChanged::ArgumentType&);
+    // Routes signals of this object that match rule to handler, via the match rule index of the bus.
+    MatchRuleIndex::Token route_signals(const MatchRule& rule, const MatchRuleIndex::Handler& handler);
+    void unroute_signals(MatchRuleIndex::Token token);
+    void on_properties_changed(Message::Reader& reader);
 
     std::shared_ptr<Service> parent;
     types::ObjectPath object_path;
-    MessageRouter<SignalKey> signal_router;
+    // Only valid for stubs.
+    MatchRuleIndex::Token properties_changed_route;
     MessageRouter<MethodKey> method_router;
     MessageRouter<PropertyKey> get_property_router;
     MessageRouter<PropertyKey> set_property_router;
     std::once_flag add_match_once;
     std::map<
         std::tuple<std::string, std::string>,
-        std::function<void(const types::Variant&)>
+        std::function<void(Message::Reader&)>
     > property_changed_vtable;
 };
 }
@@ -0,0 +1,246 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_PATH_NAMESPACE_ROUTER_H_
+#define CORE_DBUS_PATH_NAMESPACE_ROUTER_H_
+
+#include <core/dbus/message.h>
+#include <core/dbus/types/object_path.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace core
+{
+namespace dbus
+{
+/**
+ * @brief Routes messages to handlers based on their object path.
+ *
+ * Routes are kept in a trie of path components and are either installed for
+ * a single path or for a path namespace, i.e., a path and all the paths below
+ * it. A namespace route is the local counterpart of a path_namespace match
+ * rule installed with the daemon. Each message is resolved with a single walk
+ * over the components of its path, independent of the number of routes.
+ *
+ * To subscribe to the signals of a subtree of objects on a bus, use
+ * Bus::subscribe_to_signals with a path namespace rule, which installs
+ * both the local route and the rule with the daemon.
+ */
+class PathNamespaceRouter
+{
+public:
+    /**
+     * @brief Handler is a function type that handles raw DBus messages.
+     */
+    typedef std::function<void(const Message::Ptr&)> Handler;
+
+    inline PathNamespaceRouter() : root(new Node())
+    {
+    }
+
+    PathNamespaceRouter(const PathNamespaceRouter&) = delete;
+    PathNamespaceRouter& operator=(const PathNamespaceRouter&) = delete;
+
+    /**
+     * @brief Installs a route for a single path in a thread-safe manner, replacing any previously installed route.
+     * @param path The path to install the route for.
+     * @param handler The handler to install, must not be empty.
+     */
+    inline void install_route(const types::ObjectPath& path, Handler handler)
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        node_for_path(path.as_string()).exact = std::make_shared<const Handler>(handler);
+        has_routes.store(!root->empty());
+    }
+
+    /**
+     * @brief Uninstalls the route for a single path in a thread-safe manner.
+     * @param path The path to uninstall the route for.
+     */
+    inline void uninstall_route(const types::ObjectPath& path)
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        uninstall(path.as_string(), &Node::exact);
+        has_routes.store(!root->empty());
+    }
+
+    /**
+     * @brief Installs a route for a path and all paths below it in a thread-safe manner, replacing any previously installed route.
+     * @param path The root of the namespace to install the route for.
+     * @param handler The handler to install, must not be empty.
+     */
+    inline void install_namespace_route(const types::ObjectPath& path, Handler handler)
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        node_for_path(path.as_string()).namespaced = std::make_shared<const Handler>(handler);
+        has_routes.store(!root->empty());
+    }
+
+    /**
+     * @brief Uninstalls the route for a path namespace in a thread-safe manner.
+     * @param path The root of the namespace to uninstall the route for.
+     */
+    inline void uninstall_namespace_route(const types::ObjectPath& path)
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        uninstall(path.as_string(), &Node::namespaced);
+        has_routes.store(!root->empty());
+    }
+
+    /**
+     * @brief Queries whether no routes are installed, without taking a lock.
+     */
+    inline bool empty() const
+    {
+        return !has_routes.load();
+    }
+
+    /**
+     * @brief Routes a raw DBus message in a thread-safe manner.
+     *
+     * The route installed for the exact path of the message is invoked first,
+     * followed by the namespace routes covering the path, from the most
+     * specific namespace to the least specific one.
+     * @param msg The message to route, must not be null.
+     * @return true if the message has been routed to at least one handler, false otherwise.
+     */
+    inline bool operator()(const Message::Ptr& msg)
+    {
+        const std::string path = msg->path().as_string();
+
+        // Handlers are shared with the trie, dispatching does not copy them.
+        std::shared_ptr<const Handler> exact;
+        std::vector<std::shared_ptr<const Handler>> namespaces;
+
+        {
+            std::unique_lock<std::mutex> ul(guard);
+
+            Node* node = root.get();
+            if (node->namespaced)
+                namespaces.push_back(node->namespaced);
+
+            std::string component;
+            std::string::size_type begin = 1;
+            while (node && begin < path.size())
+            {
+                auto end = path.find('/', begin);
+                if (end == std::string::npos)
+                    end = path.size();
+
+                component.assign(path, begin, end - begin);
+                auto it = node->children.find(component);
+                node = it == node->children.end() ? nullptr : it->second.get();
+
+                if (node && node->namespaced)
+                    namespaces.push_back(node->namespaced);
+
+                begin = end + 1;
+            }
+
+            if (node)
+                exact = node->exact;
+        }
+
+        // Handlers are invoked without holding the lock so that they can
+        // modify the router.
+        if (exact)
+            (*exact)(msg);
+
+        for (auto it = namespaces.rbegin(); it != namespaces.rend(); ++it)
+            (**it)(msg);
+
+        return exact || !namespaces.empty();
+    }
+
+private:
+    struct Node
+    {
+        std::shared_ptr<const Handler> exact;
+        std::shared_ptr<const Handler> namespaced;
+        std::map<std::string, std::unique_ptr<Node>> children;
+
+        inline bool empty() const
+        {
+            return !exact && !namespaced && children.empty();
+        }
+    };
+
+    // Splits a path into its components, the root path "/" has none.
+    static inline std::vector<std::string> components_of(const std::string& path)
+    {
+        std::vector<std::string> result;
+        std::string::size_type begin = 1;
+        while (begin < path.size())
+        {
+            auto end = path.find('/', begin);
+            if (end == std::string::npos)
+                end = path.size();
+            result.push_back(path.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        return result;
+    }
+
+    inline Node& node_for_path(const std::string& path)
+    {
+        Node* node = root.get();
+        for (const std::string& component : components_of(path))
+        {
+            std::unique_ptr<Node>& child = node->children[component];
+            if (!child)
+                child.reset(new Node());
+            node = child.get();
+        }
+        return *node;
+    }
+
+    inline void uninstall(const std::string& path, std::shared_ptr<const Handler> Node::*which)
+    {
+        auto components = components_of(path);
+
+        std::vector<Node*> nodes{root.get()};
+        for (const std::string& component : components)
+        {
+            auto it = nodes.back()->children.find(component);
+            if (it == nodes.back()->children.end())
+                return;
+            nodes.push_back(it->second.get());
+        }
+
+        (nodes.back()->*which).reset();
+
+        // Prune nodes that do not carry any routes anymore.
+        while (nodes.size() > 1 && nodes.back()->empty())
+        {
+            nodes.pop_back();
+            nodes.back()->children.erase(components[nodes.size() - 1]);
+        }
+    }
+
+    std::mutex guard;
+    std::unique_ptr<Node> root;
+    // Mirrors !root->empty(), allows for skipping messages without taking the lock.
+    std::atomic<bool> has_routes{false};
+};
+}
+}
+
+#endif // CORE_DBUS_PATH_NAMESPACE_ROUTER_H_
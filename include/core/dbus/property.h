@@ -83,7 +83,7 @@ private:
 
     inline void handle_get(const Message::Ptr& msg);
     inline void handle_set(const Message::Ptr& msg);
-    inline void handle_changed(const types::Variant& msg);
+    inline void handle_changed(Message::Reader& reader);
 
     std::shared_ptr<Object> parent;
     std::string interface;
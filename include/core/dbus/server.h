@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_SERVER_H_
+#define CORE_DBUS_SERVER_H_
+
+#include <core/dbus/bus.h>
+#include <core/dbus/executor.h>
+#include <core/dbus/visibility.h>
+
+#include <dbus/dbus.h>
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace core
+{
+namespace dbus
+{
+/**
+ * @brief Listens for direct connections from peers, bypassing the bus daemon.
+ *
+ * Every accepted connection is handed out as a Bus instance in peer-to-peer
+ * mode, refer to Bus::PeerToPeer. Peers connect to the address reported by
+ * address() using Bus(address, Bus::PeerToPeer{}).
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Server
+{
+public:
+    typedef std::shared_ptr<Server> Ptr;
+
+    /**
+     * @brief Function signature for handling a newly accepted connection.
+     *
+     * The connection is closed again unless the handler keeps a reference
+     * to it. Handlers usually install an executor on the connection and
+     * expose services on it.
+     */
+    typedef std::function<void(const Bus::Ptr& connection)> NewConnectionHandler;
+
+    /**
+     * @brief Function signature for handling an exception thrown by the NewConnectionHandler.
+     *
+     * The exception cannot propagate as the handler is invoked from within
+     * libdbus. The connection is closed again unless the handler kept a
+     * reference to it before throwing.
+     */
+    typedef std::function<void(std::exception_ptr error)> ErrorHandler;
+
+    /**
+     * @brief Starts listening on the given address.
+     * @throw std::runtime_error if listening on the address fails.
+     * @param address The address to listen on, e.g., unix:tmpdir=/tmp.
+     * @param handler The handler to invoke for every accepted connection.
+     */
+    Server(const std::string& address, const NewConnectionHandler& handler);
+
+    /**
+     * @brief Stops listening, connections accepted before stay intact.
+     */
+    ~Server() noexcept;
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+    bool operator==(const Server&) const = delete;
+
+    /**
+     * @brief Queries the address peers can connect to, including any server-chosen details.
+     */
+    std::string address() const;
+
+    /**
+     * @brief Installs an executor for this server, enabling the acceptance of connections.
+     * @param e The executor instance, must not be null.
+     */
+    void install_executor(const Executor::Ptr& e);
+
+    /**
+     * @brief Installs a handler for exceptions thrown while handling new connections.
+     *
+     * Exceptions are dropped if no handler is installed. Has to be called before run().
+     * @param handler The handler to install.
+     */
+    void install_error_handler(const ErrorHandler& handler);
+
+    /**
+     * @brief Stops accepting connections, i.e., stops the underlying executor if any.
+     */
+    void stop();
+
+    /**
+     * @brief Starts accepting connections, i.e., starts the underlying executor if any.
+     */
+    void run();
+
+    /**
+     * @brief Provides raw, unmanaged access to the underlying DBus server.
+     */
+    DBusServer* raw() const;
+
+private:
+    Bus::Ptr adopt(DBusConnection* connection);
+
+    struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Private;
+    std::unique_ptr<Private> d;
+};
+}
+}
+
+#endif // CORE_DBUS_SERVER_H_
@@ -45,6 +45,7 @@ namespace core
 {
 namespace dbus
 {
+class BusPool;
 class Object;
 
 /**
@@ -82,6 +83,25 @@ public:
         return instance;
     }
 
+    /**
+     * @brief Exposes a service on the bus without waiting for the name to be acquired.
+     *
+     * Name requests for several services, possibly on several connections,
+     * proceed concurrently. The future only becomes ready if an executor
+     * dispatches the connection.
+     * @param [in] connection Bus to expose the service upon.
+     * @param [in] name The name to acquire for this service.
+     * @param [in] flags Flags specifying behavior when requesting a name on the bus.
+     * @return A future carrying the service once the name has been acquired, or
+     * the exception add_service would have thrown.
+     */
+    static std::future<Ptr> add_service_asynchronously(
+        const Bus::Ptr& connection,
+        const std::string& name,
+        const Bus::RequestNameFlag& flags =
+            Bus::RequestNameFlag::do_not_queue |
+            Bus::RequestNameFlag::replace_existing);
+
     /**
      * @brief Exposes a service on the bus.
      * @returns An instance of Service or nullptr in case of errors.
@@ -135,6 +155,29 @@ public:
      */
     static Ptr use_service_or_throw_if_not_available(const Bus::Ptr& connection, const std::string& name);
 
+    /**
+     * @brief Provides access to a service on the bus via a proxy object, spreading method calls across a pool of connections.
+     * @returns An instance of Service.
+     * @tparam Interface Needs to be a model of concept Service.
+     * @param [in] pool The pool of connections to access the service upon.
+     */
+    template<typename Interface>
+    inline static Ptr use_service(const std::shared_ptr<BusPool>& pool)
+    {
+        return use_service(pool, traits::Service<Interface>::interface_name());
+    }
+
+    /**
+     * @brief Provides access to a service on the bus via a proxy object, spreading method calls across a pool of connections.
+     *
+     * Signal subscriptions and property changes are handled on the primary
+     * connection of the pool, refer to BusPool.
+     * @returns An instance of Service.
+     * @param [in] pool The pool of connections to access the service upon.
+     * @param [in] name Well-known name of the service on the bus.
+     */
+    static Ptr use_service(const std::shared_ptr<BusPool>& pool, const std::string& name);
+
     /**
      * @brief Provides access to the root object of this service instance.
      */
@@ -154,6 +197,25 @@ public:
      */
     std::shared_ptr<Object> add_object_for_path(const types::ObjectPath& path);
 
+    /**
+     * @brief Serves all objects on and below the specified path with a single handler.
+     *
+     * Prefer this over add_object_for_path when exposing large numbers of
+     * objects that share the same interfaces, e.g., one object per record of
+     * a database. The handler receives the path of the addressed object
+     * relative to path and is responsible for replying to method calls.
+     * @throw Bus::Errors::ObjectPathInUse if path is already used.
+     * @param [in] path The root of the subtree.
+     * @param [in] handler The handler to invoke for incoming messages.
+     */
+    void add_subtree_for_path(const types::ObjectPath& path, const Bus::SubtreeHandler& handler);
+
+    /**
+     * @brief Removes a subtree previously added with add_subtree_for_path.
+     * @param [in] path The root of the subtree.
+     */
+    void remove_subtree_for_path(const types::ObjectPath& path);
+
     /**
      * @brief Non-mutable access to the name of the service.
      */
@@ -166,16 +228,23 @@ protected:
 
     Service(const Bus::Ptr& connection, const std::string& name);
     Service(const Bus::Ptr& connection, const std::string& name, const Bus::RequestNameFlag& flags);
+    // Tags the construction of a service for a name that has already been acquired.
+    struct NameAcquired {};
+    Service(const Bus::Ptr& connection, const std::string& name, NameAcquired);
 
     bool is_stub() const;
 
     const Bus::Ptr& get_connection() const;
+    // Selects the connection for a method call to the object at path, which
+    // is the one returned by get_connection() unless the stub uses a pool.
+    const Bus::Ptr& connection_for_method_call(const types::ObjectPath& path) const;
 
     void add_match(const MatchRule& rule);
     void remove_match(const MatchRule& rule);
 
 private:
     Bus::Ptr connection;
+    std::shared_ptr<BusPool> pool;
     std::string name;
     std::shared_ptr<Object> root;
     bool stub;
@@ -29,10 +29,13 @@ namespace core
 {
 namespace dbus
 {
-class Object;
+class Bus;
 
 /**
  * @brief Allows watching for bus name owner changes.
+ *
+ * All watchers for a bus share a single NameOwnerChanged subscription,
+ * refer to Bus::access_name_watch_registry.
  */
 class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC ServiceWatcher
 {
@@ -63,7 +66,7 @@ public:
     const core::Signal<void>& service_unregistered() const;
 
 private:
-    ServiceWatcher(std::shared_ptr<Object> object, const std::string& name,
+    ServiceWatcher(std::shared_ptr<Bus> bus, const std::string& name,
                 DBus::WatchMode watch_mode = DBus::WatchMode::owner_change);
 
     struct Private;
@@ -21,14 +21,18 @@
 #include <core/signal.h>
 
 #include <core/dbus/match_rule.h>
+#include <core/dbus/match_rule_index.h>
 #include <core/dbus/message.h>
 #include <core/dbus/visibility.h>
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <list>
+#include <vector>
 
 namespace core
 {
@@ -85,6 +89,9 @@ public:
 
     /**
      * @brief disconnect releases a signal-slot connection
+     *
+     * Can safely be called from within a handler. A dispatch that is already
+     * in flight on another thread might still invoke the handler once.
      * @param token Refers to the signal-slot connection that should be released.
      */
     inline void disconnect(const SubscriptionToken& token);
@@ -107,12 +114,19 @@ private:
 
     void operator()(const Message::Ptr&);
 
+    // Rebuilds and publishes the snapshot, requires handlers_guard to be held.
+    inline void publish_snapshot();
+
     std::shared_ptr<Object> parent;
     std::string interface;
     std::string name;
     MatchRule rule;
+    MatchRuleIndex::Token route;
     std::mutex handlers_guard;
     std::list<Handler> handlers;
+    // Immutable copy of handlers, republished on every change and
+    // iterated without holding handlers_guard.
+    std::shared_ptr<const std::vector<Handler>> snapshot;
     core::Signal<void> signal_about_to_be_destroyed;
 };
 
@@ -161,6 +175,9 @@ public:
 
     /**
      * @brief disconnect releases a signal-slot connection
+     *
+     * Can safely be called from within a handler. A dispatch that is already
+     * in flight on another thread might still invoke the handler once.
      * @param token Refers to the signal-slot connection that should be released.
      */
     inline void disconnect(const SubscriptionToken& token);
@@ -183,6 +200,21 @@ private:
 
     inline void operator()(const Message::Ptr&) noexcept;
 
+    // Immutable view of the connected handlers that is iterated during
+    // dispatch without holding handlers_guard.
+    struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Snapshot
+    {
+        // Handlers without match args.
+        std::vector<Handler> unconditional;
+        // Handlers with match args, indexed by their first match arg.
+        std::multimap<MatchRule::MatchArg, std::pair<MatchRule::MatchArgs, Handler>> by_match_arg;
+        // Argument indices referenced by any match arg.
+        std::set<std::size_t> referenced_args;
+    };
+
+    // Rebuilds and publishes the snapshot, requires handlers_guard to be held.
+    inline void publish_snapshot();
+
     struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Shared
     {
         Shared(
@@ -200,7 +232,9 @@ private:
         MatchRule rule;
         std::mutex handlers_guard;
         std::multimap<MatchRule::MatchArgs, Handler> handlers;
+        std::shared_ptr<const Snapshot> snapshot;
         core::Signal<void> signal_about_to_be_destroyed;
+        MatchRuleIndex::Token route;
     };
     std::shared_ptr<Shared> d;
 };
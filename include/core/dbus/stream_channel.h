@@ -0,0 +1,234 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_STREAM_CHANNEL_H_
+#define CORE_DBUS_STREAM_CHANNEL_H_
+
+#include <core/dbus/visibility.h>
+
+#include <core/dbus/types/unix_fd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace core
+{
+namespace dbus
+{
+/**
+ * @brief The RawStreamChannel class streams fixed-size records through a ring buffer in shared memory.
+ *
+ * The ring lives in a memfd, and an eventfd wakes up the consumer. Both fds
+ * are handed to the consumer over a regular method call, refer to memory()
+ * and event(). From then on, records bypass the bus entirely. The channel
+ * supports a single producer and a single consumer, and pushing never
+ * blocks or takes a lock. The consumer is only woken up if it might be
+ * waiting, and drains all available records per wakeup.
+ *
+ * Use asio::make_executor to consume a channel on the event loop that
+ * dispatches the bus.
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC RawStreamChannel
+{
+public:
+    typedef std::shared_ptr<RawStreamChannel> Ptr;
+
+    /**
+     * @brief Function signature for handling a batch of contiguous records residing in shared memory.
+     */
+    typedef std::function<void(const std::uint8_t* records, std::size_t count)> BatchHandler;
+
+    /**
+     * @brief The Errors struct summarizes all exceptions thrown by
+     * methods of class RawStreamChannel.
+     */
+    struct Errors
+    {
+        Errors() = delete;
+
+        /**
+         * @brief The IncompatibleLayout exception is thrown if a memfd does not carry a ring for the expected records.
+         */
+        struct IncompatibleLayout : public std::runtime_error
+        {
+            inline IncompatibleLayout()
+                : std::runtime_error(
+                      "The shared memory does not carry a ring buffer for the expected records.")
+            {
+            }
+        };
+
+        /**
+         * @brief The NotSealed exception is thrown if a memfd could still be resized by the producer.
+         */
+        struct NotSealed : public std::runtime_error
+        {
+            inline NotSealed()
+                : std::runtime_error(
+                      "The file descriptor does not refer to a memfd sealed against resizing.")
+            {
+            }
+        };
+    };
+
+    /**
+     * @brief Creates the ring for the producer side.
+     * @throw std::system_error if the shared memory or the eventfd cannot be set up.
+     * @param record_size The size of a single record in bytes, must be > 0.
+     * @param capacity The minimum number of records the ring holds, rounded up to a power of 2.
+     */
+    static Ptr create(std::size_t record_size, std::size_t capacity);
+
+    /**
+     * @brief Attaches to a ring created by the producer, taking ownership of the fds.
+     * @throw Errors::NotSealed if memory is not sealed against growing and shrinking.
+     * @throw Errors::IncompatibleLayout if memory does not carry a ring for records of record_size.
+     * @throw std::system_error if the shared memory cannot be mapped.
+     */
+    static Ptr attach(const types::UnixFd& memory, const types::UnixFd& event, std::size_t record_size);
+
+    ~RawStreamChannel();
+
+    RawStreamChannel(const RawStreamChannel&) = delete;
+    RawStreamChannel& operator=(const RawStreamChannel&) = delete;
+
+    /**
+     * @brief Queries the size of a single record in bytes.
+     */
+    std::size_t record_size() const;
+
+    /**
+     * @brief Queries the number of records the ring holds.
+     */
+    std::size_t capacity() const;
+
+    /**
+     * @brief Provides access to the memfd carrying the ring, owned by the channel.
+     */
+    types::UnixFd memory() const;
+
+    /**
+     * @brief Provides access to the eventfd waking up the consumer, owned by the channel.
+     */
+    types::UnixFd event() const;
+
+    /**
+     * @brief Appends a record to the ring, producer side only.
+     * @param record Points to record_size bytes.
+     * @return false if the ring is full, the record is dropped in that case.
+     */
+    bool try_push(const void* record);
+
+    /**
+     * @brief Consumes all available records, consumer side only.
+     *
+     * The handler is invoked with at most two batches per pass, the ring
+     * wrapping around in between. Records stay in place until the handler returns.
+     * @return The number of records consumed.
+     */
+    std::size_t drain(const BatchHandler& handler);
+
+private:
+    RawStreamChannel();
+
+    struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Private;
+    std::unique_ptr<Private> d;
+};
+
+/**
+ * @brief The StreamChannel class streams records of trivially copyable type T through a RawStreamChannel.
+ */
+template<typename T>
+class StreamChannel
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Records have to be trivially copyable.");
+
+public:
+    typedef std::shared_ptr<StreamChannel<T>> Ptr;
+
+    /**
+     * @brief Function signature for handling a batch of records.
+     */
+    typedef std::function<void(const std::vector<T>& records)> BatchHandler;
+
+    /**
+     * @brief Creates the ring for the producer side, holding at least capacity records.
+     */
+    inline static Ptr create(std::size_t capacity)
+    {
+        return Ptr(new StreamChannel<T>(RawStreamChannel::create(sizeof(T), capacity)));
+    }
+
+    /**
+     * @brief Attaches to a ring created by the producer, taking ownership of the fds.
+     */
+    inline static Ptr attach(const types::UnixFd& memory, const types::UnixFd& event)
+    {
+        return Ptr(new StreamChannel<T>(RawStreamChannel::attach(memory, event, sizeof(T))));
+    }
+
+    /**
+     * @brief Appends a record to the ring, returning false if the ring is full.
+     */
+    inline bool try_push(const T& record)
+    {
+        return raw->try_push(std::addressof(record));
+    }
+
+    /**
+     * @brief Consumes all available records.
+     */
+    inline std::vector<T> drain()
+    {
+        std::vector<T> result;
+        raw->drain([&result](const std::uint8_t* records, std::size_t count)
+        {
+            auto begin = reinterpret_cast<const T*>(records);
+            result.insert(result.end(), begin, begin + count);
+        });
+        return result;
+    }
+
+    inline types::UnixFd memory() const
+    {
+        return raw->memory();
+    }
+
+    inline types::UnixFd event() const
+    {
+        return raw->event();
+    }
+
+    inline const RawStreamChannel::Ptr& untyped() const
+    {
+        return raw;
+    }
+
+private:
+    inline explicit StreamChannel(const RawStreamChannel::Ptr& raw) : raw(raw)
+    {
+    }
+
+    RawStreamChannel::Ptr raw;
+};
+}
+}
+
+#endif // CORE_DBUS_STREAM_CHANNEL_H_
@@ -0,0 +1,175 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_TYPES_SHARED_BUFFER_H_
+#define CORE_DBUS_TYPES_SHARED_BUFFER_H_
+
+#include <core/dbus/codec.h>
+#include <core/dbus/visibility.h>
+
+#include <core/dbus/helper/type_mapper.h>
+#include <core/dbus/types/unix_fd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+namespace core
+{
+namespace dbus
+{
+namespace types
+{
+/**
+ * @brief The SharedBuffer class passes bulk payloads as a sealed memfd instead of marshalling them.
+ *
+ * Only the file descriptor travels with the message. The memory is sealed
+ * against any modification before it is handed out, and mapped read-only by
+ * receivers, which access the payload in place. Copies of a SharedBuffer
+ * share the same mapping. Requires a transport that supports passing file
+ * descriptors, i.e., a unix domain socket.
+ */
+class ORG_FREEDESKTOP_DBUS_DLL_PUBLIC SharedBuffer
+{
+public:
+    /** @brief Function signature for filling a buffer in place before it is sealed. */
+    typedef std::function<void(std::uint8_t* data, std::size_t size)> Filler;
+
+    /**
+     * @brief The Errors struct summarizes all exceptions thrown by
+     * methods of class SharedBuffer.
+     */
+    struct Errors
+    {
+        Errors() = delete;
+
+        /**
+         * @brief The NotSealed exception is thrown if a received fd could still be modified by its sender.
+         */
+        struct NotSealed : public std::runtime_error
+        {
+            inline NotSealed()
+                : std::runtime_error(
+                      "The file descriptor does not refer to a sealed memfd.")
+            {
+            }
+        };
+    };
+
+    /**
+     * @brief Allocates a sealed buffer of size bytes.
+     * @throw std::system_error if the memory cannot be allocated or sealed.
+     * @param size The size of the buffer in bytes.
+     * @param fill Writes the payload in place, before the buffer is sealed. Can be empty, leaving the buffer zeroed.
+     */
+    static SharedBuffer create(std::size_t size, const Filler& fill);
+
+    /**
+     * @brief Allocates a sealed buffer holding a copy of size bytes starting at data.
+     * @throw std::system_error if the memory cannot be allocated or sealed.
+     */
+    static SharedBuffer copy_of(const void* data, std::size_t size);
+
+    /**
+     * @brief Maps the memfd referred to by fd read-only, taking ownership of the fd.
+     * @throw Errors::NotSealed if the memfd is not sealed against writing, growing and shrinking.
+     * @throw std::system_error if the fd cannot be mapped.
+     */
+    static SharedBuffer map(const UnixFd& fd);
+
+    /**
+     * @brief Constructs an empty buffer without any memory attached.
+     */
+    SharedBuffer();
+
+    /**
+     * @brief Provides read-only access to the payload, nullptr if empty.
+     */
+    const std::uint8_t* data() const;
+
+    /**
+     * @brief Queries the size of the payload in bytes.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Checks if the buffer is empty.
+     */
+    bool empty() const;
+
+    const std::uint8_t* begin() const;
+    const std::uint8_t* end() const;
+
+    /**
+     * @brief Provides access to the fd of the memfd, -1 for a default-constructed buffer. The fd stays owned by the buffer.
+     */
+    UnixFd fd() const;
+
+private:
+    struct ORG_FREEDESKTOP_DBUS_DLL_LOCAL Private;
+    std::shared_ptr<Private> d;
+};
+}
+
+namespace helper
+{
+template<>
+struct TypeMapper<types::SharedBuffer>
+{
+    typedef StaticSignature<DBUS_TYPE_UNIX_FD> StaticSignatureType;
+
+    constexpr inline static ArgumentType type_value()
+    {
+        return ArgumentType::unix_fd;
+    }
+    constexpr inline static bool is_basic_type()
+    {
+        return true;
+    }
+    constexpr inline static bool requires_signature()
+    {
+        return true;
+    }
+
+    inline static std::string signature()
+    {
+        return DBUS_TYPE_UNIX_FD_AS_STRING;
+    }
+};
+}
+
+/**
+ * @brief Template specialization for shared buffers, transferred as a unix fd.
+ */
+template<>
+struct Codec<types::SharedBuffer>
+{
+    inline static void encode_argument(Message::Writer& out, const types::SharedBuffer& value)
+    {
+        // Receivers expect a memfd even for an empty buffer.
+        out.push_unix_fd(value.fd().to_int() < 0 ? types::SharedBuffer::create(0, {}).fd() : value.fd());
+    }
+
+    inline static void decode_argument(Message::Reader& in, types::SharedBuffer& value)
+    {
+        value = types::SharedBuffer::map(in.pop_unix_fd());
+    }
+};
+}
+}
+
+#endif // CORE_DBUS_TYPES_SHARED_BUFFER_H_
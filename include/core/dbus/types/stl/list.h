@@ -32,6 +32,11 @@ namespace helper
 template<typename T>
 struct TypeMapper<std::list<T>>
 {
+    typedef typename ConcatenateStaticSignatures<
+        StaticSignature<DBUS_TYPE_ARRAY>,
+        typename TypeMapper<typename std::decay<T>::type>::StaticSignatureType
+    >::Type StaticSignatureType;
+
     constexpr static ArgumentType type_value()
     {
         return ArgumentType::array;
@@ -47,8 +52,7 @@ struct TypeMapper<std::list<T>>
 
     static std::string signature()
     {
-        static const std::string s = DBUS_TYPE_ARRAY_AS_STRING + TypeMapper<typename std::decay<T>::type>::signature();
-        return s;
+        return StaticSignatureType::value;
     }
 };
 }
@@ -61,7 +65,7 @@ struct Codec<std::list<T>>
         if (!dbus_message_iter_open_container(
                     out,
                     DBUS_TYPE_ARRAY,
-                    helper::TypeMapper<T>::requires_signature() ? helper::signature<T>(T()).c_str() : NULL,
+                    helper::TypeMapper<T>::requires_signature() ? helper::static_signature<T>() : NULL,
                     std::addressof(sub)))
             throw std::runtime_error("Problem opening container");
 
@@ -32,6 +32,13 @@ namespace helper
 template<typename T, typename U>
 struct TypeMapper<std::pair<T, U>>
 {
+    typedef typename ConcatenateStaticSignatures<
+        StaticSignature<DBUS_DICT_ENTRY_BEGIN_CHAR>,
+        typename TypeMapper<typename std::decay<T>::type>::StaticSignatureType,
+        typename TypeMapper<typename std::decay<U>::type>::StaticSignatureType,
+        StaticSignature<DBUS_DICT_ENTRY_END_CHAR>
+    >::Type StaticSignatureType;
+
     constexpr static ArgumentType type_value()
     {
         return ArgumentType::dictionary_entry;
@@ -47,14 +54,18 @@ struct TypeMapper<std::pair<T, U>>
 
     static std::string signature()
     {
-        static const std::string s = DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING + TypeMapper<typename std::decay<T>::type>::signature() + TypeMapper<typename std::decay<U>::type>::signature() + DBUS_DICT_ENTRY_END_CHAR_AS_STRING;
-        return s;
+        return StaticSignatureType::value;
     }
 };
 
 template<typename T, typename U>
 struct TypeMapper<std::map<T, U>>
 {
+    typedef typename ConcatenateStaticSignatures<
+        StaticSignature<DBUS_TYPE_ARRAY>,
+        typename TypeMapper<std::pair<T, U>>::StaticSignatureType
+    >::Type StaticSignatureType;
+
     constexpr static ArgumentType type_value()
     {
         return ArgumentType::array;
@@ -70,8 +81,7 @@ struct TypeMapper<std::map<T, U>>
 
     static std::string signature()
     {
-        static const std::string s = DBUS_TYPE_ARRAY_AS_STRING + TypeMapper<std::pair<T,U>>::signature();
-        return s;
+        return StaticSignatureType::value;
     }
 };
 }
@@ -112,9 +122,7 @@ struct Codec<std::map<T, U>>
 {
     static void encode_argument(Message::Writer& out, const std::map<T, U>& arg)
     {
-        auto aw = out.open_array(
-                    types::Signature(
-                        helper::TypeMapper<typename std::map<T, U>::value_type>::signature()));
+        auto aw = out.open_array(helper::static_signature<typename std::map<T, U>::value_type>());
         {
             for (const auto& element : arg)
             {
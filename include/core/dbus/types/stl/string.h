@@ -32,6 +32,8 @@ namespace helper
 template<>
 struct TypeMapper<std::string>
 {
+    typedef StaticSignature<DBUS_TYPE_STRING> StaticSignatureType;
+
     constexpr static inline ArgumentType type_value()
     {
         return ArgumentType::string;
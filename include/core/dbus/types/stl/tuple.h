@@ -29,35 +29,13 @@ namespace dbus
 {
 namespace helper
 {
-namespace detail
-{
-template<typename Tuple, size_t n, size_t size>
-struct StaticRecursiveSignature
-{
-    static std::string signature()
-    {
-        Tuple t;
-        typedef decltype(std::get<size-n-1>(t)) ElementType;
-        static const std::string s = TypeMapper<typename std::decay<ElementType>::type>::signature() + StaticRecursiveSignature<Tuple, n-1, size>::signature();
-        return s;
-    }
-};
-
-template<typename Tuple, size_t size>
-struct StaticRecursiveSignature<Tuple, 0, size>
-{
-    static std::string signature()
-    {
-        Tuple t;
-        typedef decltype(std::get<size-1>(t)) ElementType;
-        static const std::string s = TypeMapper<typename std::decay<ElementType>::type>::signature();
-        return s;
-    }
-};
-}
 template<typename... Args>
 struct TypeMapper<std::tuple<Args...>>
 {
+    typedef typename ConcatenateStaticSignatures<
+        typename TypeMapper<typename std::decay<Args>::type>::StaticSignatureType...
+    >::Type StaticSignatureType;
+
     constexpr static ArgumentType type_value()
     {
         return ArgumentType::structure;
@@ -73,9 +51,7 @@ struct TypeMapper<std::tuple<Args...>>
 
     static std::string signature()
     {
-        static const std::string s =
-            detail::StaticRecursiveSignature<std::tuple<Args...>, sizeof...(Args)-1, sizeof...(Args)>::signature();
-        return s;
+        return StaticSignatureType::value;
     }
 };
 }
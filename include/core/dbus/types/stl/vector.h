@@ -33,6 +33,11 @@ namespace helper
 template<typename T>
 struct TypeMapper<std::vector<T>>
 {
+    typedef typename ConcatenateStaticSignatures<
+        StaticSignature<DBUS_TYPE_ARRAY>,
+        typename TypeMapper<typename std::decay<T>::type>::StaticSignatureType
+    >::Type StaticSignatureType;
+
     constexpr static ArgumentType type_value()
     {
         return ArgumentType::array;
@@ -48,8 +53,7 @@ struct TypeMapper<std::vector<T>>
 
     static std::string signature()
     {
-        static const std::string s = DBUS_TYPE_ARRAY_AS_STRING + TypeMapper<typename std::decay<T>::type>::signature();
-        return s;
+        return StaticSignatureType::value;
     }
 };
 }
@@ -58,9 +62,7 @@ struct Codec<std::vector<T>>
 {
     static void encode_argument(Message::Writer& out, const std::vector<T>& arg)
     {
-        auto aw = out.open_array(
-                    types::Signature(
-                        helper::TypeMapper<T>::signature()));
+        auto aw = out.open_array(helper::static_signature<T>());
         {
             for(auto element : arg)
                 core::dbus::encode_argument(aw, element);
@@ -42,6 +42,12 @@ namespace helper
 template<typename T>
 struct TypeMapper<core::dbus::types::Struct<T>>
 {
+    typedef typename ConcatenateStaticSignatures<
+        StaticSignature<DBUS_STRUCT_BEGIN_CHAR>,
+        typename TypeMapper<T>::StaticSignatureType,
+        StaticSignature<DBUS_STRUCT_END_CHAR>
+    >::Type StaticSignatureType;
+
     constexpr inline static ArgumentType type_value()
     {
         return ArgumentType::structure;
@@ -59,11 +65,7 @@ struct TypeMapper<core::dbus::types::Struct<T>>
 
     inline static std::string signature()
     {
-        static const std::string s =
-            DBUS_STRUCT_BEGIN_CHAR_AS_STRING +
-            TypeMapper<T>::signature() +
-            DBUS_STRUCT_END_CHAR_AS_STRING;
-        return s;
+        return StaticSignatureType::value;
     }
 };
 }
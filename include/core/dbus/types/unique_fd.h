@@ -0,0 +1,120 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_TYPES_UNIQUE_FD_H_
+#define CORE_DBUS_TYPES_UNIQUE_FD_H_
+
+#include <core/dbus/types/unix_fd.h>
+
+#include <unistd.h>
+
+namespace core
+{
+namespace dbus
+{
+namespace types
+{
+/**
+ * @brief The UniqueFd class owns a file descriptor and closes it on destruction.
+ *
+ * In contrast to UnixFd, a UniqueFd is move-only. Decoding a UniqueFd
+ * takes ownership of the duplicate handed out by libdbus, and
+ * Message::Writer::push_unique_fd hands ownership over to the message.
+ */
+class UniqueFd
+{
+public:
+    UniqueFd() noexcept : fd(-1)
+    {
+    }
+
+    /**
+     * @brief Takes ownership of fd.
+     */
+    explicit UniqueFd(int fd) noexcept : fd(fd)
+    {
+    }
+
+    UniqueFd(UniqueFd&& rhs) noexcept : fd(rhs.release())
+    {
+    }
+
+    UniqueFd& operator=(UniqueFd&& rhs) noexcept
+    {
+        if (this != &rhs)
+            reset(rhs.release());
+        return *this;
+    }
+
+    UniqueFd(const UniqueFd&) = delete;
+    UniqueFd& operator=(const UniqueFd&) = delete;
+
+    ~UniqueFd() noexcept
+    {
+        reset();
+    }
+
+    /**
+     * @brief Checks if a file descriptor is owned.
+     */
+    explicit operator bool() const noexcept
+    {
+        return fd >= 0;
+    }
+
+    /**
+     * @brief Accesses the owned file descriptor, -1 if none is owned.
+     */
+    int to_int() const noexcept
+    {
+        return fd;
+    }
+
+    /**
+     * @brief Provides a non-owning view on the file descriptor.
+     */
+    UnixFd to_unix_fd() const noexcept
+    {
+        return UnixFd{fd};
+    }
+
+    /**
+     * @brief Gives up ownership without closing the file descriptor.
+     */
+    int release() noexcept
+    {
+        int result = fd;
+        fd = -1;
+        return result;
+    }
+
+    /**
+     * @brief Closes the owned file descriptor, if any, and takes ownership of fd.
+     */
+    void reset(int fd = -1) noexcept
+    {
+        if (this->fd >= 0)
+            ::close(this->fd);
+        this->fd = fd;
+    }
+
+private:
+    int fd;
+};
+}
+}
+}
+
+#endif // CORE_DBUS_TYPES_UNIQUE_FD_H_
@@ -22,112 +22,271 @@
 #include <core/dbus/message.h>
 #include <core/dbus/helper/type_mapper.h>
 #include <core/dbus/types/any.h>
+#include <core/dbus/types/object_path.h>
 #include <core/dbus/types/signature.h>
 
 #include <cstring>
 
-#include <functional>
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 
 namespace core
 {
 namespace dbus
 {
+template<>
+struct Codec<types::Variant>;
+
 namespace types
 {
-class Variant
+namespace detail
 {
-protected:
-    typedef std::function<void(dbus::Message::Writer&)> Encoder;
-    typedef std::function<void(dbus::Message::Reader&)> Decoder;
+/**
+ * @brief Immutable, type-erased value of compound type held by a Variant.
+ */
+struct VariantValue
+{
+    virtual ~VariantValue() = default;
+    virtual void encode(Message::Writer& writer) const = 0;
+};
 
-    inline Variant(const Encoder& encoder, const types::Signature& signature)
-        : encoder(encoder),
-          decoder(),
-          signature_(signature)
+template<typename T>
+struct TypedVariantValue : public VariantValue
+{
+    explicit TypedVariantValue(const T& value) : value(value)
     {
     }
 
-    inline Variant(const Decoder& decoder, const types::Signature& signature)
-        : encoder(),
-          decoder(decoder),
-          signature_(signature)
+    void encode(Message::Writer& writer) const override
     {
+        Codec<T>::encode_argument(writer, value);
     }
+
+    T value;
+};
+
+/**
+ * @brief Describes how values of type T are kept in the inline storage of a Variant.
+ *
+ * Types without a specialization are not stored inline but as a shared, immutable VariantValue.
+ */
+template<typename T>
+struct VariantStorage
+{
+    static constexpr bool is_inline = false;
+};
+
+template<typename T, ArgumentType Type, typename Member, Member DBusBasicValue::*member>
+struct NumericVariantStorage
+{
+    static constexpr bool is_inline = true;
+    static constexpr ArgumentType type = Type;
+
+    inline static void store(const T& value, DBusBasicValue& basic, std::string&)
+    {
+        basic.*member = static_cast<Member>(value);
+    }
+
+    inline static T load(const DBusBasicValue& basic, const std::string&)
+    {
+        return static_cast<T>(basic.*member);
+    }
+};
+
+template<typename T, ArgumentType Type>
+struct StringVariantStorage
+{
+    static constexpr bool is_inline = true;
+    static constexpr ArgumentType type = Type;
+
+    inline static void store(const T& value, DBusBasicValue&, std::string& string)
+    {
+        string = value.as_string();
+    }
+
+    inline static T load(const DBusBasicValue&, const std::string& string)
+    {
+        return T{string};
+    }
+};
+
+template<>
+struct VariantStorage<bool>
+        : public NumericVariantStorage<bool, ArgumentType::boolean, dbus_bool_t, &DBusBasicValue::bool_val> {};
+template<>
+struct VariantStorage<std::int8_t>
+        : public NumericVariantStorage<std::int8_t, ArgumentType::byte, unsigned char, &DBusBasicValue::byt> {};
+template<>
+struct VariantStorage<std::int16_t>
+        : public NumericVariantStorage<std::int16_t, ArgumentType::int16, dbus_int16_t, &DBusBasicValue::i16> {};
+template<>
+struct VariantStorage<std::uint16_t>
+        : public NumericVariantStorage<std::uint16_t, ArgumentType::uint16, dbus_uint16_t, &DBusBasicValue::u16> {};
+template<>
+struct VariantStorage<std::int32_t>
+        : public NumericVariantStorage<std::int32_t, ArgumentType::int32, dbus_int32_t, &DBusBasicValue::i32> {};
+template<>
+struct VariantStorage<std::uint32_t>
+        : public NumericVariantStorage<std::uint32_t, ArgumentType::uint32, dbus_uint32_t, &DBusBasicValue::u32> {};
+template<>
+struct VariantStorage<std::int64_t>
+        : public NumericVariantStorage<std::int64_t, ArgumentType::int64, dbus_int64_t, &DBusBasicValue::i64> {};
+template<>
+struct VariantStorage<std::uint64_t>
+        : public NumericVariantStorage<std::uint64_t, ArgumentType::uint64, dbus_uint64_t, &DBusBasicValue::u64> {};
+template<>
+struct VariantStorage<float>
+        : public NumericVariantStorage<float, ArgumentType::floating_point, double, &DBusBasicValue::dbl> {};
+template<>
+struct VariantStorage<double>
+        : public NumericVariantStorage<double, ArgumentType::floating_point, double, &DBusBasicValue::dbl> {};
+template<>
+struct VariantStorage<types::ObjectPath>
+        : public StringVariantStorage<types::ObjectPath, ArgumentType::object_path> {};
+template<>
+struct VariantStorage<types::Signature>
+        : public StringVariantStorage<types::Signature, ArgumentType::signature> {};
+
+template<>
+struct VariantStorage<std::string>
+{
+    static constexpr bool is_inline = true;
+    static constexpr ArgumentType type = ArgumentType::string;
+
+    inline static void store(const std::string& value, DBusBasicValue&, std::string& string)
+    {
+        string = value;
+    }
+
+    inline static std::string load(const DBusBasicValue&, const std::string& string)
+    {
+        return string;
+    }
+};
+}
+
+/**
+ * @brief Variant is a value-semantic container for a value of arbitrary D-Bus type.
+ *
+ * Values of basic type, including strings, object paths and signatures, are kept in
+ * inline storage and are encoded and decoded without additional allocations. Values
+ * of compound type are kept as shared, immutable values when encoding and as a
+ * reader over the original message when decoding. Instances can be copied and moved freely.
+ */
+class Variant
+{
 public:
+    /**
+     * @brief Creates a variant holding a copy of t, ready for encoding.
+     */
     template<typename T>
     static inline Variant encode(T t)
     {
-        Encoder encoder = [t](dbus::Message::Writer& writer)
-        {
-            Codec<T>::encode_argument(writer, t);
-        };
-
-        return Variant(
-                encoder,
-                types::Signature(
-                        core::dbus::helper::TypeMapper<T>::signature()));
+        Variant result;
+        result.assign(t);
+        return result;
     }
 
+    /**
+     * @brief Creates a variant that decodes its content into t.
+     *
+     * The caller has to make sure that t outlives the returned instance and all of its copies.
+     */
     template<typename T>
     static inline Variant decode(T& t)
     {
-        Decoder decoder = [&t](dbus::Message::Reader& reader)
+        Variant result;
+        result.target = std::addressof(t);
+        result.target_decoder = [](dbus::Message::Reader& reader, void* target)
         {
-            Codec<T>::decode_argument(reader, t);
+            Codec<T>::decode_argument(reader, *static_cast<T*>(target));
         };
+        result.signature_ = types::Signature(core::dbus::helper::TypeMapper<T>::signature());
 
-        return Variant(
-                decoder,
-                types::Signature(
-                        core::dbus::helper::TypeMapper<T>::signature()));
+        return result;
     }
 
+    /**
+     * @brief Constructs an empty variant that accepts values of any type on decoding.
+     */
     inline Variant()
+        : type_(ArgumentType::invalid),
+          basic(),
+          target(nullptr),
+          target_decoder(nullptr)
     {
-        decoder = [this](dbus::Message::Reader& reader)
-        {
-            core::dbus::Codec<types::Any>::decode_argument(reader, any);
-        };
     }
 
     inline Variant(const Variant&) = default;
-
-    inline Variant(Variant&& rhs)
-        : encoder(std::move(rhs.encoder)),
-          decoder(std::move(rhs.decoder)),
-          any(std::move(rhs.any)),
-          signature_(std::move(rhs.signature_))
-    {
-    }
+    inline Variant(Variant&&) = default;
 
     virtual ~Variant() = default;
 
-    inline Variant& operator=(Variant&& rhs)
-    {
-        encoder = std::move(rhs.encoder);
-        decoder = std::move(rhs.decoder);
-        signature_ = std::move(rhs.signature_);
-        any = std::move(rhs.any);
-
-        return *this;
-    }
+    inline Variant& operator=(const Variant&) = default;
+    inline Variant& operator=(Variant&&) = default;
 
+    /**
+     * @brief Decodes the content of the variant from a reader pointing into the variant.
+     */
     virtual void decode(Message::Reader& reader)
     {
-        if (!decoder)
-            throw std::runtime_error("Variant::decode: Missing a decoder specification.");
+        if (target)
+        {
+            target_decoder(reader, target);
+            return;
+        }
 
-        decoder(reader);
+        switch (reader.type())
+        {
+        case ArgumentType::byte: assign(reader.pop_byte()); break;
+        case ArgumentType::boolean: assign(reader.pop_boolean()); break;
+        case ArgumentType::int16: assign(reader.pop_int16()); break;
+        case ArgumentType::uint16: assign(reader.pop_uint16()); break;
+        case ArgumentType::int32: assign(reader.pop_int32()); break;
+        case ArgumentType::uint32: assign(reader.pop_uint32()); break;
+        case ArgumentType::int64: assign(reader.pop_int64()); break;
+        case ArgumentType::uint64: assign(reader.pop_uint64()); break;
+        case ArgumentType::floating_point: assign(reader.pop_floating_point()); break;
+        case ArgumentType::string: assign(std::string{reader.pop_string()}); break;
+        case ArgumentType::object_path: assign(reader.pop_object_path()); break;
+        case ArgumentType::signature: assign(reader.pop_signature()); break;
+        default:
+            reset();
+            Codec<types::Any>::decode_argument(reader, any);
+            break;
+        }
     }
 
+    /**
+     * @brief Encodes the content of the variant to a writer pointing into the variant.
+     */
     virtual void encode(Message::Writer& writer) const
     {
-        if (!encoder)
-            throw std::runtime_error("Variant::encode: Missing an encoder specification.");
+        if (value)
+        {
+            value->encode(writer);
+            return;
+        }
 
-        encoder(writer);
+        switch (type_)
+        {
+        case ArgumentType::byte: writer.push_byte(load<std::int8_t>()); break;
+        case ArgumentType::boolean: writer.push_boolean(load<bool>()); break;
+        case ArgumentType::int16: writer.push_int16(load<std::int16_t>()); break;
+        case ArgumentType::uint16: writer.push_uint16(load<std::uint16_t>()); break;
+        case ArgumentType::int32: writer.push_int32(load<std::int32_t>()); break;
+        case ArgumentType::uint32: writer.push_uint32(load<std::uint32_t>()); break;
+        case ArgumentType::int64: writer.push_int64(load<std::int64_t>()); break;
+        case ArgumentType::uint64: writer.push_uint64(load<std::uint64_t>()); break;
+        case ArgumentType::floating_point: writer.push_floating_point(load<double>()); break;
+        case ArgumentType::string: writer.push_stringn(string.c_str(), string.size()); break;
+        case ArgumentType::object_path: writer.push_object_path(load<types::ObjectPath>()); break;
+        case ArgumentType::signature: writer.push_signature(load<types::Signature>()); break;
+        default:
+            throw std::runtime_error("Variant::encode: Missing an encoder specification.");
+        }
     }
 
     virtual const types::Signature& signature() const
@@ -135,35 +294,144 @@ public:
         return signature_;
     }
 
+    /**
+     * @brief Returns the type of the value held in inline storage, or ArgumentType::invalid.
+     */
+    inline ArgumentType type() const
+    {
+        return type_;
+    }
+
+    /**
+     * @brief Extracts the contained value as an instance of T.
+     * @throw std::runtime_error if the contained value is not of type T.
+     */
     template<typename T>
     T as() const
     {
-        T result;
-        any.reader() >> result;
+        return as(std::integral_constant<bool, detail::VariantStorage<T>::is_inline>{}, static_cast<T*>(nullptr));
+    }
+
+protected:
+    /**
+     * @brief Returns true if the variant accepts values of any type on decoding.
+     *
+     * Codec<Variant> reads basic values in place, bypassing decode(), for instances returning true.
+     */
+    virtual bool is_dynamic() const
+    {
+        return target == nullptr;
+    }
 
+    /**
+     * @brief Replaces the content of the variant with a copy of t.
+     */
+    template<typename T>
+    inline void assign(const T& t)
+    {
+        assign(t, std::integral_constant<bool, detail::VariantStorage<T>::is_inline>{});
+    }
+
+private:
+    friend struct core::dbus::Codec<Variant>;
+
+    template<typename T>
+    inline void assign(const T& t, std::true_type)
+    {
+        reset();
+        type_ = detail::VariantStorage<T>::type;
+        detail::VariantStorage<T>::store(t, basic, string);
+        signature_ = types::Signature(std::string(1, static_cast<char>(type_)));
+    }
+
+    template<typename T>
+    inline void assign(const T& t, std::false_type)
+    {
+        reset();
+        value = std::make_shared<detail::TypedVariantValue<T>>(t);
+        signature_ = types::Signature(core::dbus::helper::TypeMapper<T>::signature());
+    }
+
+    // Accepts a basic value that has been read in place from an enclosing variant.
+    inline void assign(ArgumentType t, const DBusBasicValue& v)
+    {
+        reset();
+        type_ = t;
+        switch (t)
+        {
+        case ArgumentType::string:
+        case ArgumentType::object_path:
+        case ArgumentType::signature:
+            string = v.str;
+            break;
+        default:
+            basic = v;
+            break;
+        }
+        signature_ = types::Signature(std::string(1, static_cast<char>(type_)));
+    }
+
+    // Prepares the value held in inline storage for writing it in place.
+    inline DBusBasicValue basic_value() const
+    {
+        DBusBasicValue result = basic;
+        if (type_ == ArgumentType::string || type_ == ArgumentType::object_path || type_ == ArgumentType::signature)
+            result.str = const_cast<char*>(string.c_str());
         return result;
     }
 
-protected:
-    inline void set_encoder(const Encoder& encoder)
+    template<typename T>
+    inline T load() const
+    {
+        return detail::VariantStorage<T>::load(basic, string);
+    }
+
+    template<typename T>
+    inline T as(std::true_type, T*) const
     {
-        this->encoder = encoder;
+        if (type_ == detail::VariantStorage<T>::type)
+            return load<T>();
+
+        if (type_ != ArgumentType::invalid || value)
+            throw std::runtime_error("Variant::as: Mismatch between requested and contained type.");
+
+        T result;
+        any.reader() >> result;
+        return result;
     }
 
-    inline void set_decoder(const Decoder& decoder)
+    template<typename T>
+    inline T as(std::false_type, T*) const
     {
-        this->decoder = decoder;
+        if (value)
+        {
+            if (auto typed_value = dynamic_cast<const detail::TypedVariantValue<T>*>(value.get()))
+                return typed_value->value;
+        }
+
+        if (type_ != ArgumentType::invalid || value)
+            throw std::runtime_error("Variant::as: Mismatch between requested and contained type.");
+
+        T result;
+        any.reader() >> result;
+        return result;
     }
 
-    inline void set_signature(const types::Signature& signature)
+    inline void reset()
     {
-        this->signature_ = signature;
+        type_ = ArgumentType::invalid;
+        value.reset();
+        any = types::Any{};
+        signature_ = types::Signature{};
     }
 
-private:
-    Encoder encoder;
-    Decoder decoder;
+    ArgumentType type_;
+    DBusBasicValue basic;
+    std::string string;
+    std::shared_ptr<const detail::VariantValue> value;
     types::Any any;
+    void* target;
+    void (*target_decoder)(Message::Reader&, void*);
     types::Signature signature_;
 };
 
@@ -173,19 +441,7 @@ class TypedVariant : public Variant
 public:
     explicit TypedVariant(const T& t = T()) : value(t)
     {
-        auto decoder = [this](dbus::Message::Reader& reader)
-        {
-            Codec<T>::decode_argument(reader, value);
-        };
-
-        auto encoder = [this](dbus::Message::Writer& writer)
-        {
-            Codec<T>::encode_argument(writer, value);
-        };
-
-        set_decoder(decoder);
-        set_encoder(encoder);
-        set_signature(types::Signature{helper::TypeMapper<T>::signature()});
+        assign(value);
     }
 
     inline const T& get() const
@@ -196,6 +452,19 @@ public:
     inline void set(const T& t)
     {
         value = t;
+        assign(value);
+    }
+
+    void decode(Message::Reader& reader) override
+    {
+        Codec<T>::decode_argument(reader, value);
+        assign(value);
+    }
+
+protected:
+    bool is_dynamic() const override
+    {
+        return false;
     }
 
 private:
@@ -204,12 +473,21 @@ private:
 }
 /**
  * @brief Template specialization for variant argument types.
+ *
+ * Basic values held in inline storage are written and read in place, without
+ * creating nested readers or writers.
  */
 template<>
 struct Codec<types::Variant>
 {
     inline static void encode_argument(Message::Writer& out, const types::Variant& variant)
     {
+        if (variant.type_ != ArgumentType::invalid && !variant.value)
+        {
+            out.push_basic_variant(variant.type_, variant.basic_value());
+            return;
+        }
+
         auto vw = out.open_variant(variant.signature());
         {
             variant.encode(vw);
@@ -219,6 +497,17 @@ struct Codec<types::Variant>
 
     inline static void decode_argument(Message::Reader& in, types::Variant& variant)
     {
+        if (variant.is_dynamic())
+        {
+            DBusBasicValue value;
+            auto type = in.pop_basic_variant(value);
+            if (type != ArgumentType::invalid)
+            {
+                variant.assign(type, value);
+                return;
+            }
+        }
+
         auto vr = in.pop_variant();
         variant.decode(vr);
     }
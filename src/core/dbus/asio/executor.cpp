@@ -18,6 +18,8 @@
 
 #include <core/dbus/bus.h>
 #include <core/dbus/executor.h>
+#include <core/dbus/server.h>
+#include <core/dbus/stream_channel.h>
 #include <core/dbus/traits/timeout.h>
 #include <core/dbus/traits/watch.h>
 
@@ -25,13 +27,17 @@
 #include <boost/asio/io_service.hpp>
 
 #include <stdexcept>
+#include <system_error>
 
+#include <cerrno>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <future>
 #include <thread>
 
+#include <unistd.h>
+
 namespace core
 {
 namespace dbus
@@ -95,7 +101,20 @@ struct Watch<DBusWatch>
 }
 namespace asio
 {
-class Executor : public core::dbus::Executor
+namespace
+{
+// Duplicates fd for handing it to a stream descriptor, which closes it on destruction.
+int duplicate(int fd)
+{
+    int result = ::dup(fd);
+    if (result == -1)
+        throw std::system_error(errno, std::system_category(), "Could not duplicate fd for watching it");
+    return result;
+}
+}
+
+class Executor : public core::dbus::Executor,
+                 public core::dbus::Scheduler
 {
 public:
     template<typename UnderlyingTimeoutType = DBusTimeout>
@@ -178,18 +197,25 @@ public:
 
         ~Watch() noexcept
         {
-            stream_descriptor.cancel();
-            stream_descriptor.release();
+            boost::system::error_code ec;
+            stream_descriptor.cancel(ec);
         }
 
         void start()
         {
-            stream_descriptor.assign(traits::Watch<UnderlyingWatchType>::get_watch_unix_fd(watch));
+            // libdbus hands out separate watches for reading and writing on
+            // the same fd, every watch monitors a duplicate of its own.
+            if (!stream_descriptor.is_open())
+                stream_descriptor.assign(duplicate(traits::Watch<UnderlyingWatchType>::get_watch_unix_fd(watch)));
             restart();
         }
 
         void restart()
         {
+            // Handling an event might have disabled the watch.
+            if (!traits::Watch<UnderlyingWatchType>::is_watch_enabled(watch))
+                return;
+
             // We do not keep ourselves alive to prevent from races during destruction.
             std::weak_ptr<Watch<UnderlyingWatchType>> wp{this->shared_from_this()};
 
@@ -275,21 +301,35 @@ public:
         T value;
     };
 
-    static dbus_bool_t on_dbus_add_watch(DBusWatch* watch, void* data)
+    static dbus_bool_t add_watch(boost::asio::io_service& io_service, DBusWatch* watch)
     {
-        if (dbus_watch_get_enabled(watch) == FALSE)
-            return TRUE;
-
-        auto thiz = static_cast<Executor*>(data);
-        auto w = std::shared_ptr<Watch<>>(new Watch<>(thiz->io_service, watch));
+        auto w = std::shared_ptr<Watch<>>(new Watch<>(io_service, watch));
         auto holder = new Holder<std::shared_ptr<Watch<>>>(w);
         dbus_watch_set_data(watch, holder, Holder<std::shared_ptr<Watch<>>>::ptr_delete);
 
-        w->start();
+        // Disabled watches are started once toggled.
+        if (dbus_watch_get_enabled(watch) == TRUE)
+        {
+            try
+            {
+                w->start();
+            }
+            catch (const std::system_error&)
+            {
+                // libdbus treats the watch as not added.
+                return FALSE;
+            }
+        }
 
         return TRUE;
     }
 
+    static dbus_bool_t on_dbus_add_watch(DBusWatch* watch, void* data)
+    {
+        auto thiz = static_cast<Executor*>(data);
+        return add_watch(thiz->io_service, watch);
+    }
+
     static void on_dbus_remove_watch(DBusWatch* watch, void*)
     {
         auto w = static_cast<Holder<std::shared_ptr<Watch<>>>*>(dbus_watch_get_data(watch));
@@ -303,7 +343,7 @@ public:
         auto holder = static_cast<Holder<std::shared_ptr<Watch<>>>*>(dbus_watch_get_data(watch));
         if (!holder)
             return;
-        dbus_watch_get_enabled(watch) == TRUE ? holder->value->restart() : holder->value->cancel();
+        dbus_watch_get_enabled(watch) == TRUE ? holder->value->start() : holder->value->cancel();
     }
 
     static dbus_bool_t on_dbus_add_timeout(DBusTimeout* timeout, void* data)
@@ -391,12 +431,185 @@ public:
         io_service.stop();
     }
 
+    void post(const std::function<void()>& handler)
+    {
+        io_service.post(handler);
+    }
+
+    Cancellation schedule(const std::chrono::milliseconds& timeout, const std::function<void()>& handler)
+    {
+        auto timer = std::make_shared<boost::asio::deadline_timer>(io_service);
+        timer->expires_from_now(boost::posix_time::milliseconds(timeout.count()));
+        timer->async_wait([timer, handler](const boost::system::error_code& ec)
+        {
+            if (!ec)
+                handler();
+        });
+
+        // The handler releases the timer, and everything captured by it, once cancelled.
+        return [timer]()
+        {
+            boost::system::error_code ec;
+            timer->cancel(ec);
+        };
+    }
+
 private:
     Bus::Ptr bus;
     boost::asio::io_service& io_service;
     boost::asio::io_service::work work;
 };
 
+// Drives the listening socket of a server, reusing the watch and timeout
+// machinery of the connection executor.
+class ServerExecutor : public core::dbus::Executor
+{
+    static dbus_bool_t on_dbus_add_watch(DBusWatch* watch, void* data)
+    {
+        auto thiz = static_cast<ServerExecutor*>(data);
+        return asio::Executor::add_watch(thiz->io_service, watch);
+    }
+
+    static dbus_bool_t on_dbus_add_timeout(DBusTimeout* timeout, void* data)
+    {
+        auto thiz = static_cast<ServerExecutor*>(data);
+        auto t = std::shared_ptr<asio::Executor::Timeout<>>(new asio::Executor::Timeout<>(thiz->io_service, timeout));
+        auto holder = new asio::Executor::Holder<std::shared_ptr<asio::Executor::Timeout<>>>(t);
+        dbus_timeout_set_data(
+                    timeout,
+                    holder,
+                    asio::Executor::Holder<std::shared_ptr<asio::Executor::Timeout<>>>::ptr_delete);
+
+        t->start();
+        return TRUE;
+    }
+
+public:
+    ServerExecutor(const Server::Ptr& server, boost::asio::io_service& io) : io_service(io), work(io_service)
+    {
+        if (!server)
+            throw std::runtime_error("Precondition violated, cannot construct executor for null server.");
+
+        // The server owns its executor, we do not keep it alive in turn.
+        if (!dbus_server_set_watch_functions(
+                    server->raw(),
+                    on_dbus_add_watch,
+                    asio::Executor::on_dbus_remove_watch,
+                    asio::Executor::on_dbus_watch_toggled,
+                    this,
+                    nullptr))
+            throw std::runtime_error("Problem installing watch functions.");
+
+        if (!dbus_server_set_timeout_functions(
+                    server->raw(),
+                    on_dbus_add_timeout,
+                    asio::Executor::on_dbus_remove_timeout,
+                    asio::Executor::on_dbus_timeout_toggled,
+                    this,
+                    nullptr))
+            throw std::runtime_error("Problem installing timeout functions.");
+    }
+
+    ~ServerExecutor() noexcept
+    {
+        stop();
+    }
+
+    void run()
+    {
+        io_service.run();
+    }
+
+    void stop()
+    {
+        io_service.stop();
+    }
+
+private:
+    boost::asio::io_service& io_service;
+    boost::asio::io_service::work work;
+};
+
+class StreamChannelExecutor : public core::dbus::Executor,
+                              public std::enable_shared_from_this<StreamChannelExecutor>
+{
+public:
+    StreamChannelExecutor(
+            const RawStreamChannel::Ptr& channel,
+            boost::asio::io_service& io,
+            const RawStreamChannel::BatchHandler& handler)
+        : io_service(io),
+          stream_descriptor(io_service),
+          channel(channel),
+          handler(handler)
+    {
+        if (!channel)
+            throw std::runtime_error("Precondition violated, cannot construct executor for null channel.");
+
+        stream_descriptor.assign(duplicate(channel->event().to_int()));
+    }
+
+    ~StreamChannelExecutor() noexcept
+    {
+        // The io_service is shared with other executors, we only stop watching.
+        boost::system::error_code ec;
+        stream_descriptor.cancel(ec);
+    }
+
+    void start()
+    {
+        std::weak_ptr<StreamChannelExecutor> wp{shared_from_this()};
+
+        // Records pushed before we started watching did not necessarily signal the eventfd.
+        io_service.post([wp]()
+        {
+            auto sp = wp.lock();
+
+            if (sp)
+                sp->on_readable();
+        });
+    }
+
+    void run()
+    {
+        io_service.run();
+    }
+
+    void stop()
+    {
+        io_service.stop();
+    }
+
+private:
+    void restart()
+    {
+        // We do not keep ourselves alive to prevent from races during destruction.
+        std::weak_ptr<StreamChannelExecutor> wp{shared_from_this()};
+
+        stream_descriptor.async_read_some(boost::asio::null_buffers(), [wp](boost::system::error_code ec, std::size_t)
+        {
+            if (ec)
+                return;
+
+            auto sp = wp.lock();
+
+            if (sp)
+                sp->on_readable();
+        });
+    }
+
+    void on_readable()
+    {
+        channel->drain(handler);
+        restart();
+    }
+
+    boost::asio::io_service& io_service;
+    boost::asio::posix::stream_descriptor stream_descriptor;
+    RawStreamChannel::Ptr channel;
+    RawStreamChannel::BatchHandler handler;
+};
+
 ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Executor::Ptr make_executor(const Bus::Ptr& bus)
 {
     static boost::asio::io_service io;
@@ -408,7 +621,21 @@ ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Executor::Ptr make_executor(const Bus::Ptr& bus,
     return std::make_shared<core::dbus::asio::Executor>(bus, io);
 }
 
+ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Executor::Ptr make_executor(const Server::Ptr& server, boost::asio::io_service& io)
+{
+    return std::make_shared<core::dbus::asio::ServerExecutor>(server, io);
 }
-}
+
+ORG_FREEDESKTOP_DBUS_DLL_PUBLIC Executor::Ptr make_executor(
+        const RawStreamChannel::Ptr& channel,
+        boost::asio::io_service& io,
+        const RawStreamChannel::BatchHandler& handler)
+{
+    auto executor = std::make_shared<core::dbus::asio::StreamChannelExecutor>(channel, io, handler);
+    executor->start();
+    return executor;
 }
 
+}
+}
+}
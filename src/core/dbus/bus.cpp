@@ -19,6 +19,8 @@
 #include <core/dbus/bus.h>
 #include <core/dbus/dbus.h>
 #include <core/dbus/match_rule.h>
+#include <core/dbus/match_rule_index.h>
+#include <core/dbus/name_watch_registry.h>
 #include <core/dbus/object.h>
 
 #include <core/dbus/traits/timeout.h>
@@ -26,10 +28,17 @@
 
 #include <core/posix/this_process.h>
 
+#include "loopback.h"
 #include "message_p.h"
 #include "message_factory_impl.h"
+#include "name_owner_changed.h"
 #include "pending_call_impl.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <set>
+#include <unordered_map>
+
 namespace
 {
 struct VTable
@@ -62,6 +71,265 @@ struct VTable
     std::weak_ptr<core::dbus::Object> object;
 };
 
+struct SubtreeVTable
+{
+    static void unregister_subtree(DBusConnection*, void* data)
+    {
+        delete static_cast<SubtreeVTable*>(data);
+    }
+
+    static DBusHandlerResult on_new_message(
+            DBusConnection*,
+            DBusMessage* message,
+            void* data)
+    {
+        auto thiz = static_cast<SubtreeVTable*>(data);
+
+        // libdbus only dispatches messages addressed to the root of the
+        // subtree or to paths below it, so we can just skip the prefix.
+        const char* suffix = dbus_message_get_path(message);
+        if (not suffix)
+            return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+        suffix += thiz->prefix_length;
+        if (*suffix == '/')
+            ++suffix;
+
+        try
+        {
+            return static_cast<DBusHandlerResult>(
+                        thiz->handler(
+                            core::dbus::Message::from_raw_message(message),
+                            suffix));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error handling message for " << dbus_message_get_path(message)
+                      << ": " << e.what() << std::endl;
+        }
+
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    std::size_t prefix_length;
+    core::dbus::Bus::SubtreeHandler handler;
+};
+
+// Reference counts of the match rules installed with the daemon, keyed
+// by their string representation. Shared with outstanding asynchronous
+// AddMatch calls that settle the rule once the daemon replied.
+struct MatchRules
+{
+    // Subscribers waiting for the outcome of an asynchronous AddMatch call.
+    struct Pending
+    {
+        std::vector<core::dbus::PendingCall::Notification> waiters;
+        // Set if a blocking add_match installed the rule in the meantime.
+        bool confirmed = false;
+    };
+
+    std::mutex guard;
+    std::map<std::string, std::size_t> counts;
+    std::map<std::string, Pending> pending;
+    // Rules a blocking add_match is currently installing with the daemon,
+    // other blocking subscribers wait for its outcome on changed.
+    std::set<std::string> adding;
+    std::condition_variable changed;
+    // Set for direct connections to a peer, which delivers all of its
+    // signals anyway, i.e., rules are only accounted for locally.
+    bool local_only = false;
+};
+
+core::dbus::Message::Ptr a_match_rule_call(const std::string& member, const std::string& rule)
+{
+    auto msg = core::dbus::Message::make_method_call(
+                core::dbus::DBus::name(),
+                core::dbus::DBus::path(),
+                core::dbus::DBus::interface(),
+                member);
+    msg->writer().push_stringn(rule.c_str(), rule.size());
+    return msg;
+}
+
+// Drops one of the copies of a rule installed with the daemon, without waiting for a reply.
+void remove_duplicate_match(const std::weak_ptr<DBusConnection>& wp, const std::string& rule)
+{
+    auto connection = wp.lock();
+    if (!connection)
+        return;
+
+    auto msg = dbus_message_new_method_call(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, "RemoveMatch");
+    if (!msg)
+        return;
+
+    const char* s = rule.c_str();
+    if (dbus_message_append_args(msg, DBUS_TYPE_STRING, &s, DBUS_TYPE_INVALID))
+    {
+        dbus_message_set_no_reply(msg, TRUE);
+        dbus_connection_send(connection.get(), msg, nullptr);
+    }
+
+    dbus_message_unref(msg);
+}
+
+// Notifies with a null reply if the rule has been installed before.
+void add_match_asynchronously_with_notification(
+        core::dbus::Bus& bus,
+        const std::weak_ptr<DBusConnection>& connection,
+        const std::shared_ptr<MatchRules>& match_rules,
+        const std::string& rule,
+        const core::dbus::PendingCall::Notification& notification)
+{
+    bool installed_before = false;
+
+    {
+        // We account for the rule right away, such that subscribers
+        // submitted back-to-back only result in a single AddMatch call.
+        // Subscribers arriving while that call is in flight share its outcome.
+        std::lock_guard<std::mutex> lg(match_rules->guard);
+
+        auto it = match_rules->pending.find(rule);
+        if (it != match_rules->pending.end())
+        {
+            match_rules->counts[rule]++;
+            it->second.waiters.push_back(notification);
+            return;
+        }
+
+        installed_before = ++match_rules->counts[rule] > 1 || match_rules->local_only;
+        if (!installed_before)
+            match_rules->pending[rule].waiters.push_back(notification);
+    }
+
+    if (installed_before)
+    {
+        notification(core::dbus::Message::Ptr{});
+        return;
+    }
+
+    core::dbus::PendingCall::Ptr pending_call;
+    try
+    {
+        pending_call = bus.send_with_reply_and_timeout(
+                    a_match_rule_call("AddMatch", rule),
+                    core::dbus::Bus::default_timeout());
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lg(match_rules->guard);
+        match_rules->pending.erase(rule);
+        match_rules->counts.erase(rule);
+        throw;
+    }
+
+    pending_call->then([connection, match_rules, rule](const core::dbus::Message::Ptr& reply)
+    {
+        MatchRules::Pending pending;
+        bool failed = reply->type() == core::dbus::Message::Type::error;
+
+        {
+            std::lock_guard<std::mutex> lg(match_rules->guard);
+
+            auto it = match_rules->pending.find(rule);
+            pending = std::move(it->second);
+            match_rules->pending.erase(it);
+
+            // None of the subscribers is served, they all learn about the error.
+            if (failed && !pending.confirmed)
+                match_rules->counts.erase(rule);
+        }
+
+        // A blocking add_match installed the rule, too.
+        if (pending.confirmed && !failed)
+            remove_duplicate_match(connection, rule);
+
+        for (const auto& waiter : pending.waiters)
+            waiter(pending.confirmed ? core::dbus::Message::Ptr{} : reply);
+    });
+}
+
+core::dbus::Result<void> result_for(const core::dbus::Message::Ptr& reply)
+{
+    return reply ? core::dbus::Result<void>::from_message(reply) : core::dbus::Result<void>{};
+}
+
+core::dbus::Message::Ptr a_get_name_owner_call(const std::string& name)
+{
+    auto msg = core::dbus::Message::make_method_call(
+                core::dbus::DBus::name(),
+                core::dbus::DBus::path(),
+                core::dbus::DBus::interface(),
+                "GetNameOwner");
+    msg->writer().push_stringn(name.c_str(), name.size());
+    return msg;
+}
+
+// Caches the owners of bus names, an empty owner denoting a name that is
+// known not to be owned. Entries are updated from NameOwnerChanged and
+// populated with the results of GetNameOwner calls. As the signal is
+// authoritative, results of calls never replace existing entries: a
+// signal handled while a call is in flight is newer than its result.
+struct NameOwners
+{
+    bool lookup(const std::string& name, std::string& owner)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+
+        auto it = owners.find(name);
+        if (it == owners.end())
+            return false;
+
+        owner = it->second;
+        return true;
+    }
+
+    void begin_query(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        in_flight[name]++;
+    }
+
+    void end_query(const std::string& name, const std::string& owner)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+
+        owners.insert(std::make_pair(name, owner));
+
+        auto it = in_flight.find(name);
+        if (it != in_flight.end() && --it->second == 0)
+            in_flight.erase(it);
+    }
+
+    void abort_query(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+
+        auto it = in_flight.find(name);
+        if (it != in_flight.end() && --it->second == 0)
+            in_flight.erase(it);
+    }
+
+    void on_name_owner_changed(const core::dbus::Message::Ptr& msg)
+    {
+        core::dbus::impl::NameOwnerChanged args;
+        if (!args.unpack(msg))
+            return;
+
+        std::lock_guard<std::mutex> lg(guard);
+
+        // Unique names are never reused, we drop them once they vanish
+        // unless a call for them is in flight and could resurrect them.
+        if (args.new_owner.empty() && args.name[0] == ':' && in_flight.count(args.name) == 0)
+            owners.erase(args.name);
+        else
+            owners[args.name] = args.new_owner;
+    }
+
+    std::mutex guard;
+    std::unordered_map<std::string, std::string> owners;
+    std::unordered_map<std::string, std::size_t> in_flight;
+};
+
 DBusHandlerResult static_handle_message(
         DBusConnection* connection,
         DBusMessage* message,
@@ -122,16 +390,344 @@ struct Bus::Private
         : connection(nullptr),
           message_factory_impl(new impl::MessageFactory()),
           message_type_router([](const Message::Ptr& msg) { return msg->type(); }),
-          signal_router([](const Message::Ptr& msg){ return msg->path(); })
+          match_rules(std::make_shared<MatchRules>()),
+          outstanding_calls(std::make_shared<std::atomic<std::size_t>>(0)),
+          local_calls(std::make_shared<impl::LocalCalls>())
     {
         init_libdbus_thread_support_and_install_shutdown_handler();
     }
 
+    // Hands a method call to an object registered with this connection if
+    // the call is addressed to a name acquired on this connection. Returns
+    // the copy handed to the object, or null if the call has to go out.
+    Message::Ptr dispatch_locally(
+            const Message::Ptr& msg,
+            const impl::LocalCalls::Completion& completion)
+    {
+        if (!local_calls->enabled || msg->type() != Message::Type::method_call)
+            return Message::Ptr{};
+
+        auto raw = msg->d->dbus_message.get();
+
+        std::weak_ptr<Object> object;
+        {
+            std::lock_guard<std::mutex> lg(local_calls->guard);
+
+            auto destination = dbus_message_get_destination(raw);
+            if (!destination || local_calls->names.count(destination) == 0)
+                return Message::Ptr{};
+
+            auto it = local_calls->objects.find(dbus_message_get_path(raw));
+            if (it == local_calls->objects.end() || it->second.expired())
+                return Message::Ptr{};
+
+            object = it->second;
+        }
+
+        // The object is invoked on the event loop, just like for calls
+        // arriving from the outside, never on the thread of the caller.
+        auto scheduler = std::dynamic_pointer_cast<Scheduler>(executor);
+        if (!scheduler)
+            throw std::runtime_error(
+                    "Dispatching calls in-process requires an executor implementing Scheduler, refer to Bus::enable_loopback.");
+
+        // The caller keeps its message untouched, the object receives a
+        // copy. Replies are routed back to us by the mark they inherit from
+        // the copy, and by serial. Local serials overlap with the ones of libdbus.
+        auto call = msg->clone();
+        auto call_raw = call->d->dbus_message.get();
+        if (!dbus_message_set_data(call_raw, Message::Private::local_call_slot(), local_calls.get(), nullptr))
+            throw Bus::Errors::NoMemory{};
+
+        std::uint32_t serial = 0;
+        {
+            std::lock_guard<std::mutex> lg(local_calls->guard);
+            serial = local_calls->next_serial_locked();
+            local_calls->pending[serial] = completion;
+        }
+
+        auto unique_name = dbus_bus_get_unique_name(connection.get());
+        dbus_message_set_serial(call_raw, serial);
+        dbus_message_set_sender(call_raw, unique_name ? unique_name : loopback_sender());
+
+        std::weak_ptr<impl::LocalCalls> calls{local_calls};
+        scheduler->post([calls, object, call, serial]()
+        {
+            bool handled = false;
+            std::string error_name{DBUS_ERROR_UNKNOWN_METHOD};
+            std::string error_message{"No handler installed for " + call->interface() + "." + call->member()};
+
+            try
+            {
+                if (auto sp = object.lock())
+                    handled = sp->on_new_message(call);
+            }
+            catch (const std::exception& e)
+            {
+                error_name = DBUS_ERROR_FAILED;
+                error_message = e.what();
+            }
+
+            if (handled)
+                return;
+
+            auto sp = calls.lock();
+            if (!sp)
+                return;
+
+            auto completion = sp->take(serial);
+            if (!completion)
+                return;
+
+            auto error = Message::make_error(call, error_name, error_message);
+            {
+                std::lock_guard<std::mutex> lg(sp->guard);
+                dbus_message_set_serial(error->d->dbus_message.get(), sp->next_serial_locked());
+            }
+
+            completion(error);
+        });
+
+        return call;
+    }
+
+    // Completes a call dispatched by dispatch_locally with the given reply,
+    // returning false if the reply is not meant for a local call.
+    bool complete_locally(const Message::Ptr& reply)
+    {
+        auto raw = reply->d->dbus_message.get();
+
+        if (dbus_message_get_data(raw, Message::Private::local_call_slot()) != local_calls.get())
+            return false;
+
+        impl::LocalCalls::Completion completion;
+        {
+            std::lock_guard<std::mutex> lg(local_calls->guard);
+
+            auto it = local_calls->pending.find(dbus_message_get_reply_serial(raw));
+            if (it == local_calls->pending.end())
+                return false;
+
+            dbus_message_set_serial(raw, local_calls->next_serial_locked());
+            completion = std::move(it->second);
+            local_calls->pending.erase(it);
+        }
+
+        completion(reply);
+        return true;
+    }
+
+    // Times out a call dispatched by dispatch_locally with DBUS_ERROR_NO_REPLY,
+    // like libdbus does for calls that go out. Handled by the executor, just
+    // like the timeouts of pending calls that go out.
+    void arm_local_timeout(
+            const std::shared_ptr<impl::LocalPendingCall>& local_call,
+            const Message::Ptr& call,
+            const std::chrono::milliseconds& timeout)
+    {
+        if (local_call->completed || timeout >= PendingCall::inifinite_timeout())
+            return;
+
+        // dispatch_locally made sure that the executor is a scheduler.
+        auto scheduler = std::dynamic_pointer_cast<Scheduler>(executor);
+
+        std::weak_ptr<impl::LocalPendingCall> wp{local_call};
+        auto cancellation = scheduler->schedule(
+                    timeout.count() < 0 ? Bus::default_timeout() : timeout,
+                    [wp, call]()
+                    {
+                        if (auto sp = wp.lock())
+                            sp->time_out(Message::make_error(
+                                             call,
+                                             DBUS_ERROR_NO_REPLY,
+                                             "Did not receive a reply in time."));
+                    });
+
+        local_call->arm(cancellation);
+    }
+
+    // Announces crossings of the high-water mark, returning the size of the outgoing queue.
+    std::size_t update_outgoing_queue_state()
+    {
+        std::size_t size = dbus_connection_get_outgoing_size(connection.get());
+        auto high_water_mark = outgoing.high_water_mark.load();
+
+        bool above = high_water_mark > 0 && size > high_water_mark;
+        if (outgoing.above.exchange(above) != above)
+            outgoing.crossed(above);
+
+        return size;
+    }
+
+    // Throws or blocks according to the policy if the outgoing queue exceeds its high-water mark.
+    void apply_outgoing_queue_policy()
+    {
+        auto size = update_outgoing_queue_state();
+        auto high_water_mark = outgoing.high_water_mark.load();
+
+        if (high_water_mark == 0 || size <= high_water_mark)
+            return;
+
+        switch (outgoing.policy.load())
+        {
+        case OutgoingQueuePolicy::notify:
+            break;
+        case OutgoingQueuePolicy::fail:
+            throw Errors::OutgoingQueueFull{};
+        case OutgoingQueuePolicy::block:
+            dbus_connection_flush(connection.get());
+            update_outgoing_queue_state();
+            break;
+        }
+    }
+
+    // Hands messages to libdbus one after the other, allocating for all of
+    // them up front such that either all of them are queued or none.
+    std::vector<uint32_t> send_in_order(const std::vector<Message::Ptr>& messages)
+    {
+        std::vector<uint32_t> serials(messages.size(), 0);
+
+        apply_outgoing_queue_policy();
+
+        std::vector<DBusPreallocatedSend*> preallocated;
+        preallocated.reserve(messages.size());
+
+        for (std::size_t i = 0; i < messages.size(); i++)
+        {
+            auto p = dbus_connection_preallocate_send(connection.get());
+            if (!p)
+            {
+                for (auto q : preallocated)
+                    dbus_connection_free_preallocated_send(connection.get(), q);
+                throw Bus::Errors::NoMemory{};
+            }
+            preallocated.push_back(p);
+        }
+
+        for (std::size_t i = 0; i < messages.size(); i++)
+        {
+            dbus_connection_send_preallocated(
+                        connection.get(),
+                        preallocated[i],
+                        messages[i]->d->dbus_message.get(),
+                        std::addressof(serials[i]));
+        }
+
+        for (const auto& msg : messages)
+            record(msg, CaptureDirection::outgoing);
+
+        update_outgoing_queue_state();
+
+        return serials;
+    }
+
+    // Submits the messages held back by corks ahead of a method call that
+    // bypasses them, keeping messages in the order they were issued.
+    void submit_corked_messages()
+    {
+        std::vector<Message::Ptr> queue;
+        {
+            std::lock_guard<std::mutex> lg(cork.guard);
+            queue.swap(cork.queue);
+        }
+
+        if (!queue.empty())
+            send_in_order(queue);
+    }
+
+    // Records msg to the capture log, if any.
+    void record(
+            const Message::Ptr& msg,
+            CaptureDirection direction,
+            const std::chrono::nanoseconds& timestamp = now())
+    {
+        if (!captured.enabled)
+            return;
+
+        auto log = std::atomic_load(&captured.log);
+        if (!log)
+            return;
+
+        // Capturing must never interfere with the traffic itself, we
+        // silently skip messages that cannot be recorded, e.g., due to
+        // carrying unix fds.
+        try
+        {
+            log->append(msg, timestamp, static_cast<std::uint32_t>(direction));
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+
+    static std::chrono::nanoseconds now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch());
+    }
+
+    // Installed ahead of static_handle_message, records incoming messages.
+    static DBusHandlerResult static_capture_message(
+            DBusConnection*,
+            DBusMessage* message,
+            void* user_data)
+    {
+        auto thiz = static_cast<Private*>(user_data);
+
+        if (thiz->captured.enabled)
+            thiz->record(Message::from_raw_message(message), CaptureDirection::incoming);
+
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    // Stands in for the unique name of connections that did not say Hello.
+    static const char* loopback_sender()
+    {
+        return ":loopback.0";
+    }
+
     std::shared_ptr<DBusConnection> connection;
     std::shared_ptr<MessageFactory> message_factory_impl;
     Executor::Ptr executor;
     MessageTypeRouter message_type_router;
     SignalRouter signal_router;
+    MatchRuleIndex match_rule_index;
+    // Rules of subscribe_to_signals, by the token of their route.
+    std::mutex subscriptions_guard;
+    std::map<MatchRuleIndex::Token, MatchRule> subscriptions;
+    std::shared_ptr<MatchRules> match_rules;
+    // Serializes enable_name_owner_cache, name_owners is null until then.
+    std::mutex name_owners_guard;
+    std::shared_ptr<NameOwners> name_owners;
+    std::once_flag name_watch_registry_once;
+    std::unique_ptr<NameWatchRegistry> name_watch_registry;
+    // Shared with pending calls, which might outlive the connection.
+    std::shared_ptr<std::atomic<std::size_t>> outstanding_calls;
+    // Direct connections to a peer lack a daemon to talk to.
+    bool peer_to_peer = false;
+    // Shared with pending local calls, which might outlive the connection.
+    std::shared_ptr<impl::LocalCalls> local_calls;
+    // Messages held back by corks on the connection.
+    struct
+    {
+        std::mutex guard;
+        std::size_t depth = 0;
+        std::vector<Message::Ptr> queue;
+    } cork;
+    // High-water mark of libdbus' outgoing queue.
+    struct
+    {
+        std::atomic<std::size_t> high_water_mark{0};
+        std::atomic<OutgoingQueuePolicy> policy{OutgoingQueuePolicy::notify};
+        std::atomic<bool> above{false};
+        core::Signal<bool> crossed;
+    } outgoing;
+    // Log that messages are captured to, refer to capture_to.
+    struct
+    {
+        std::atomic<bool> enabled{false};
+        std::shared_ptr<MessageLog::Writer> log;
+    } captured;
 };
 
 Bus::MessageHandlerResult Bus::handle_message(const Message::Ptr& message)
@@ -141,6 +737,18 @@ Bus::MessageHandlerResult Bus::handle_message(const Message::Ptr& message)
 }
 
 Bus::Bus(const std::string& address)
+    : Bus(address, Unregistered{})
+{
+    auto message = dbus::Message::make_method_call(
+                DBus::name(),
+                DBus::path(),
+                DBus::interface(),
+                "Hello");
+
+    handle_hello_reply(send_with_reply_and_block_for_at_most(message, std::chrono::seconds(1)));
+}
+
+Bus::Bus(const std::string& address, Unregistered)
     : d(new Private())
 {
     Error se;
@@ -152,31 +760,19 @@ Bus::Bus(const std::string& address)
     if (!d->connection)
         throw std::runtime_error(se.print());
 
-    d->message_type_router.install_route(
-                Message::Type::signal,
-                std::bind(
-                    &Bus::SignalRouter::operator(),
-                    std::ref(d->signal_router),
-                    std::placeholders::_1));
-
-    dbus_connection_add_filter(
-                d->connection.get(),
-                static_handle_message,
-                this,
-                nullptr);
-
-    auto message = dbus::Message::make_method_call(
-                DBus::name(),
-                DBus::path(),
-                DBus::interface(),
-                "Hello");
+    install_message_filter();
 
-    auto reply = send_with_reply_and_block_for_at_most(message, std::chrono::seconds(1));
+    dbus_connection_set_exit_on_disconnect(d->connection.get(), FALSE);
+}
 
+void Bus::handle_hello_reply(const Message::Ptr& reply)
+{
     if (reply->type() == Message::Type::error)
         throw std::runtime_error(reply->error().print());
 
-    dbus_connection_set_exit_on_disconnect(d->connection.get(), FALSE);
+    // Registering by hand, libdbus only learns about the name from us.
+    const char* name = reply->reader().pop_string();
+    dbus_bus_set_unique_name(d->connection.get(), name);
 }
 
 Bus::Bus(WellKnownBus bus)
@@ -191,70 +787,302 @@ Bus::Bus(WellKnownBus bus)
     if (!d->connection)
         throw std::runtime_error(se.print());
 
-    d->message_type_router.install_route(
-                Message::Type::signal,
-                std::bind(
-                    &Bus::SignalRouter::operator(),
-                    std::ref(d->signal_router),
-                    std::placeholders::_1));
-
-    dbus_connection_add_filter(
-                d->connection.get(),
-                static_handle_message,
-                this,
-                nullptr);
+    install_message_filter();
 
     dbus_connection_set_exit_on_disconnect(d->connection.get(), FALSE);
 }
 
-Bus::~Bus() noexcept
+Bus::Bus(const std::string& address, PeerToPeer)
+    : d(new Private())
 {
-    dbus_connection_remove_filter(d->connection.get(), static_handle_message, this);
-    dbus_connection_close(d->connection.get());
-    dbus_connection_unref(d->connection.get());
-}
+    Error se;
+    d->connection.reset(
+                dbus_connection_open_private(address.c_str(), std::addressof(se.raw())),
+                [](DBusConnection*){}
+    );
 
-const std::shared_ptr<MessageFactory> Bus::message_factory()
-{
-    return d->message_factory_impl;
+    if (!d->connection)
+        throw std::runtime_error(se.print());
+
+    d->peer_to_peer = true;
+    d->match_rules->local_only = true;
+
+    install_message_filter();
+
+    dbus_connection_set_exit_on_disconnect(d->connection.get(), FALSE);
 }
 
-Bus::Name Bus::request_name_on_bus(
-        const std::string& name,
-        Bus::RequestNameFlag flags)
+Bus::Bus(DBusConnection* connection, PeerToPeer)
+    : d(new Private())
 {
-    Error error;
-    auto rc = dbus_bus_request_name(
-                d->connection.get(),
-                name.c_str(),
-                static_cast<unsigned int>(flags),
-                std::addressof(error.raw()));
+    // We take over the reference handed to us.
+    d->connection.reset(connection, [](DBusConnection*){});
 
-    Bus::Name result{name};
+    d->peer_to_peer = true;
+    d->match_rules->local_only = true;
 
-    switch (rc)
-    {
-    case DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER: return result;
-    case DBUS_REQUEST_NAME_REPLY_IN_QUEUE: return result;
-    case DBUS_REQUEST_NAME_REPLY_EXISTS: throw Bus::Errors::AlreadyOwned{}; break;
-    case DBUS_REQUEST_NAME_REPLY_ALREADY_OWNER: throw Bus::Errors::AlreadyOwner{}; break;
-    case -1: throw std::runtime_error(error.print());
-    }
+    install_message_filter();
 
-    return result;
+    dbus_connection_set_exit_on_disconnect(d->connection.get(), FALSE);
 }
 
-void Bus::release_name_on_bus(Bus::Name&& name)
+void Bus::install_message_filter()
 {
-    Error error;
-    dbus_bus_release_name(
-                d->connection.get(),
-                name.as_string().c_str(),
-                std::addressof(error.raw()));
-}
+    d->message_type_router.install_route(
+                Message::Type::signal,
+                [this](const Message::Ptr& msg)
+                {
+                    // Signals and objects subscribe via the index, the
+                    // router only carries routes installed by users of
+                    // access_signal_router.
+                    d->match_rule_index(msg);
+                    if (!d->signal_router.empty())
+                        d->signal_router(msg);
+                });
+
+    dbus_connection_add_filter(
+                d->connection.get(),
+                Private::static_capture_message,
+                d.get(),
+                nullptr);
+
+    dbus_connection_add_filter(
+                d->connection.get(),
+                static_handle_message,
+                this,
+                nullptr);
+}
+
+std::future<Bus::Ptr> Bus::connect_asynchronously(const std::string& address, const ExecutorFactory& make_executor)
+{
+    // Keeps the instance alive until the reply to Hello hands it over.
+    struct Connecting
+    {
+        std::promise<Bus::Ptr> promise;
+        Bus::Ptr bus;
+    };
+
+    auto connecting = std::make_shared<Connecting>();
+    auto future = connecting->promise.get_future();
+
+    try
+    {
+        connecting->bus.reset(new Bus(address, Unregistered{}));
+        connecting->bus->install_executor(make_executor(connecting->bus));
+
+        auto message = dbus::Message::make_method_call(
+                    DBus::name(),
+                    DBus::path(),
+                    DBus::interface(),
+                    "Hello");
+
+        auto call = connecting->bus->send_with_reply_and_timeout(message, std::chrono::seconds(1));
+        call->then([connecting](const Message::Ptr& reply)
+        {
+            auto bus = std::move(connecting->bus);
+
+            try
+            {
+                bus->handle_hello_reply(reply);
+                connecting->promise.set_value(bus);
+            }
+            catch (...)
+            {
+                connecting->promise.set_exception(std::current_exception());
+            }
+        });
+    }
+    catch (...)
+    {
+        connecting->bus.reset();
+        connecting->promise.set_exception(std::current_exception());
+    }
+
+    return future;
+}
+
+std::future<Bus::Ptr> Bus::connect_asynchronously(const std::string& address)
+{
+    return std::async(std::launch::async, [address]()
+    {
+        return Bus::Ptr{new Bus(address)};
+    });
+}
+
+std::future<Bus::Ptr> Bus::connect_asynchronously(WellKnownBus bus)
+{
+    return std::async(std::launch::async, [bus]()
+    {
+        return Bus::Ptr{new Bus(bus)};
+    });
+}
+
+Bus::~Bus() noexcept
+{
+    dbus_connection_remove_filter(d->connection.get(), static_handle_message, this);
+    dbus_connection_remove_filter(d->connection.get(), Private::static_capture_message, d.get());
+    dbus_connection_close(d->connection.get());
+    dbus_connection_unref(d->connection.get());
+}
+
+const std::shared_ptr<MessageFactory> Bus::message_factory()
+{
+    return d->message_factory_impl;
+}
+
+Bus::Name Bus::request_name_on_bus(
+        const std::string& name,
+        Bus::RequestNameFlag flags)
+{
+    // Names carry no meaning between peers.
+    if (d->peer_to_peer)
+    {
+        std::lock_guard<std::mutex> lg(d->local_calls->guard);
+        d->local_calls->names.insert(name);
+        return Bus::Name{name};
+    }
+
+    Error error;
+    auto rc = dbus_bus_request_name(
+                d->connection.get(),
+                name.c_str(),
+                static_cast<unsigned int>(flags),
+                std::addressof(error.raw()));
+
+    Bus::Name result{name};
+
+    switch (rc)
+    {
+    case DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER:
+    {
+        std::lock_guard<std::mutex> lg(d->local_calls->guard);
+        d->local_calls->names.insert(name);
+        return result;
+    }
+    case DBUS_REQUEST_NAME_REPLY_IN_QUEUE: return result;
+    case DBUS_REQUEST_NAME_REPLY_EXISTS: throw Bus::Errors::AlreadyOwned{}; break;
+    case DBUS_REQUEST_NAME_REPLY_ALREADY_OWNER: throw Bus::Errors::AlreadyOwner{}; break;
+    case -1: throw std::runtime_error(error.print());
+    }
+
+    return result;
+}
+
+void Bus::request_name_on_bus_asynchronously(
+        const std::string& name,
+        Bus::RequestNameFlag flags,
+        const RequestNameHandler& handler)
+{
+    if (d->peer_to_peer)
+    {
+        {
+            std::lock_guard<std::mutex> lg(d->local_calls->guard);
+            d->local_calls->names.insert(name);
+        }
+        handler(std::exception_ptr{});
+        return;
+    }
+
+    auto msg = Message::make_method_call(
+                DBus::name(),
+                DBus::path(),
+                DBus::interface(),
+                "RequestName");
+    auto writer = msg->writer();
+    writer.push_stringn(name.c_str(), name.size());
+    writer.push_uint32(static_cast<std::uint32_t>(flags));
+
+    auto pending_call = send_with_reply_and_timeout(
+                msg,
+                Bus::default_timeout());
+
+    std::weak_ptr<impl::LocalCalls> local_calls{d->local_calls};
+    pending_call->then([handler, local_calls, name](const Message::Ptr& reply)
+    {
+        std::exception_ptr error;
+
+        try
+        {
+            if (reply->type() == Message::Type::error)
+                throw std::runtime_error(reply->error().print());
+
+            switch (reply->reader().pop_uint32())
+            {
+            case DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER:
+                if (auto sp = local_calls.lock())
+                {
+                    std::lock_guard<std::mutex> lg(sp->guard);
+                    sp->names.insert(name);
+                }
+                break;
+            case DBUS_REQUEST_NAME_REPLY_EXISTS: throw Bus::Errors::AlreadyOwned{}; break;
+            case DBUS_REQUEST_NAME_REPLY_ALREADY_OWNER: throw Bus::Errors::AlreadyOwner{}; break;
+            default: break;
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        handler(error);
+    });
+}
+
+std::future<Bus::Name> Bus::request_name_on_bus_asynchronously(
+        const std::string& name,
+        Bus::RequestNameFlag flags)
+{
+    auto promise = std::make_shared<std::promise<Bus::Name>>();
+    auto future = promise->get_future();
+
+    request_name_on_bus_asynchronously(name, flags, [promise, name](const std::exception_ptr& error)
+    {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(Bus::Name{name});
+    });
+
+    return future;
+}
+
+void Bus::release_name_on_bus(Bus::Name&& name)
+{
+    {
+        std::lock_guard<std::mutex> lg(d->local_calls->guard);
+        d->local_calls->names.erase(name.as_string());
+    }
+
+    if (d->peer_to_peer)
+        return;
+
+    Error error;
+    dbus_bus_release_name(
+                d->connection.get(),
+                name.as_string().c_str(),
+                std::addressof(error.raw()));
+}
 
 uint32_t Bus::send(const std::shared_ptr<Message>& msg)
 {
+    // Replies to calls dispatched in-process never reach libdbus.
+    if (d->local_calls->enabled &&
+        (msg->type() == Message::Type::method_return || msg->type() == Message::Type::error) &&
+        d->complete_locally(msg))
+        return dbus_message_get_serial(msg->d->dbus_message.get());
+
+    {
+        std::lock_guard<std::mutex> lg(d->cork.guard);
+        if (d->cork.depth > 0)
+        {
+            d->cork.queue.push_back(msg);
+            return 0;
+        }
+    }
+
+    d->apply_outgoing_queue_policy();
+
     dbus_uint32_t serial;
     if (!dbus_connection_send(
                 d->connection.get(),
@@ -262,9 +1090,96 @@ uint32_t Bus::send(const std::shared_ptr<Message>& msg)
                 std::addressof(serial)))
         throw std::runtime_error("Problem sending message");
 
+    d->record(msg, CaptureDirection::outgoing);
+    d->update_outgoing_queue_state();
+
     return serial;
 }
 
+std::vector<uint32_t> Bus::send_in_order(const std::vector<std::shared_ptr<Message>>& messages)
+{
+    std::vector<uint32_t> serials(messages.size(), 0);
+
+    // Replies to calls dispatched in-process never reach libdbus, just as with send.
+    std::vector<std::size_t> indices;
+    std::vector<Message::Ptr> outgoing;
+    indices.reserve(messages.size());
+    outgoing.reserve(messages.size());
+
+    for (std::size_t i = 0; i < messages.size(); i++)
+    {
+        const auto& msg = messages[i];
+        if (d->local_calls->enabled &&
+            (msg->type() == Message::Type::method_return || msg->type() == Message::Type::error) &&
+            d->complete_locally(msg))
+            serials[i] = dbus_message_get_serial(msg->d->dbus_message.get());
+        else
+        {
+            indices.push_back(i);
+            outgoing.push_back(msg);
+        }
+    }
+
+    if (outgoing.empty())
+        return serials;
+
+    {
+        std::lock_guard<std::mutex> lg(d->cork.guard);
+        if (d->cork.depth > 0)
+        {
+            d->cork.queue.insert(d->cork.queue.end(), outgoing.begin(), outgoing.end());
+            return serials;
+        }
+    }
+
+    auto sent = d->send_in_order(outgoing);
+    for (std::size_t i = 0; i < indices.size(); i++)
+        serials[indices[i]] = sent[i];
+
+    return serials;
+}
+
+Bus::Cork::Cork(const std::shared_ptr<Bus>& bus) : bus(bus), released(false)
+{
+    if (!bus)
+        throw std::runtime_error("Precondition violated, cannot cork a null bus.");
+
+    std::lock_guard<std::mutex> lg(bus->d->cork.guard);
+    ++bus->d->cork.depth;
+}
+
+Bus::Cork::~Cork() noexcept
+{
+    try
+    {
+        release();
+    }
+    catch (const std::exception& e)
+    {
+        // Nobody is left to hand the queued messages to, they are lost.
+        std::cerr << "Error releasing cork, queued messages have been dropped: " << e.what() << std::endl;
+    }
+}
+
+std::vector<uint32_t> Bus::Cork::release()
+{
+    if (released)
+        return std::vector<uint32_t>{};
+
+    released = true;
+
+    std::vector<Message::Ptr> queue;
+    {
+        std::lock_guard<std::mutex> lg(bus->d->cork.guard);
+        if (--bus->d->cork.depth > 0)
+            return std::vector<uint32_t>{};
+
+        queue.swap(bus->d->cork.queue);
+    }
+
+    return bus->send_in_order(queue);
+}
+
 std::shared_ptr<Message> Bus::send_with_reply_and_block_for_at_most(
         const std::shared_ptr<Message>& msg,
         const std::chrono::milliseconds& milliseconds)
@@ -281,24 +1196,114 @@ std::shared_ptr<Message> Bus::send_with_reply_and_block_for_at_most(
 
     Error se;
 
+    struct Scope
+    {
+        Scope(std::atomic<std::size_t>& counter) : counter(counter)
+        {
+            ++counter;
+        }
+
+        ~Scope()
+        {
+            --counter;
+        }
+
+        std::atomic<std::size_t>& counter;
+    } scope{*d->outstanding_calls};
+
+    auto promise = std::make_shared<std::promise<Message::Ptr>>();
+    auto call = d->dispatch_locally(msg, [promise](const Message::Ptr& reply)
+    {
+        promise->set_value(reply);
+    });
+
+    if (call)
+    {
+        auto serial = dbus_message_get_serial(call->d->dbus_message.get());
+        auto future = promise->get_future();
+        if (future.wait_for(milliseconds) != std::future_status::ready)
+        {
+            d->local_calls->abandon(serial);
+            throw std::runtime_error(std::string{DBUS_ERROR_NO_REPLY} + ": Did not receive a reply in time.");
+        }
+
+        auto reply = future.get();
+        if (reply->type() == Message::Type::error)
+            throw std::runtime_error(reply->error().print());
+
+        return reply;
+    }
+
+    d->submit_corked_messages();
+
+    auto sent_at = Private::now();
     auto result = dbus_connection_send_with_reply_and_block(
                 d->connection.get(),
                 msg->d->dbus_message.get(),
                 milliseconds.count(),
                 std::addressof(se.raw()));
 
+    // The serial is only known afterwards, we keep the time the call went out.
+    d->record(msg, CaptureDirection::outgoing, sent_at);
+
     if (!result)
         throw std::runtime_error(se.print());
 
     auto reply = Message::from_raw_message(result);
     dbus_message_unref(result);
+
+    // Replies to blocking calls bypass the filters.
+    d->record(reply, CaptureDirection::incoming);
+
     return reply;
 }
 
+const std::chrono::milliseconds& Bus::default_timeout()
+{
+    static const std::chrono::milliseconds timeout{25000};
+    return timeout;
+}
+
 PendingCall::Ptr Bus::send_with_reply_and_timeout(
         const std::shared_ptr<Message>& msg,
         const std::chrono::milliseconds& timeout)
 {
+    if (d->local_calls->enabled)
+    {
+        auto outstanding_calls = d->outstanding_calls;
+        auto local_call = std::make_shared<impl::LocalPendingCall>(d->local_calls, [outstanding_calls]()
+        {
+            --*outstanding_calls;
+        });
+
+        ++*outstanding_calls;
+
+        Message::Ptr call;
+        try
+        {
+            call = d->dispatch_locally(msg, [local_call](const Message::Ptr& reply)
+            {
+                local_call->complete(reply);
+            });
+        }
+        catch (...)
+        {
+            --*outstanding_calls;
+            throw;
+        }
+
+        if (call)
+        {
+            local_call->serial = dbus_message_get_serial(call->d->dbus_message.get());
+            d->arm_local_timeout(local_call, call, timeout);
+            return local_call;
+        }
+
+        --*outstanding_calls;
+    }
+
+    d->submit_corked_messages();
+
     DBusPendingCall* pending_call;
     auto result = dbus_connection_send_with_reply(
                 d->connection.get(),
@@ -312,28 +1317,428 @@ PendingCall::Ptr Bus::send_with_reply_and_timeout(
     if (!pending_call)
         throw std::runtime_error("Connection disconnected or tried to send fd's over a transport that does not support it");
 
-    return impl::PendingCall::create(pending_call);
+    d->record(msg, CaptureDirection::outgoing);
+
+    // Replies to pending calls bypass the filters, too.
+    std::function<void(const Message::Ptr&)> on_reply;
+    if (d->captured.enabled)
+    {
+        std::weak_ptr<MessageLog::Writer> wp{std::atomic_load(&d->captured.log)};
+        on_reply = [wp](const Message::Ptr& reply)
+        {
+            auto log = wp.lock();
+
+            if (!log)
+                return;
+
+            try
+            {
+                log->append(reply, static_cast<std::uint32_t>(CaptureDirection::incoming));
+            }
+            catch (const std::exception&)
+            {
+            }
+        };
+    }
+
+    auto outstanding_calls = d->outstanding_calls;
+    ++*outstanding_calls;
+
+    try
+    {
+        return impl::PendingCall::create(pending_call, [outstanding_calls]()
+        {
+            --*outstanding_calls;
+        }, on_reply);
+    }
+    catch (...)
+    {
+        --*outstanding_calls;
+        throw;
+    }
 }
 
 void Bus::add_match(const MatchRule& rule)
 {
+    auto s = rule.as_string();
+    auto match_rules = d->match_rules;
+
+    std::unique_lock<std::mutex> ul(match_rules->guard);
+
+    // Subscribers arriving while another thread installs the rule learn
+    // about the outcome first. That thread does not rely on us for the
+    // reply, we might be the thread dispatching the connection though.
+    match_rules->changed.wait(ul, [match_rules, &s]() { return match_rules->adding.count(s) == 0; });
+
+    // An asynchronous AddMatch for the rule might still fail, we cannot
+    // wait for it without risking to block the dispatching thread and thus
+    // install the rule ourselves. The duplicate is dropped once it is answered.
+    auto pending = match_rules->pending.find(s);
+    if (pending == match_rules->pending.end() || pending->second.confirmed)
+    {
+        auto it = match_rules->counts.find(s);
+        if (it != match_rules->counts.end())
+        {
+            it->second++;
+            return;
+        }
+
+        if (match_rules->local_only)
+        {
+            match_rules->counts.insert(std::make_pair(s, 1));
+            return;
+        }
+    }
+
+    // We do not hold the lock across the round trip, neither the
+    // dispatching thread nor other rules have to wait for it.
+    match_rules->adding.insert(s);
+    ul.unlock();
+
     Error se;
-    dbus_bus_add_match(d->connection.get(), rule.as_string().c_str(), std::addressof(se.raw()));
+    dbus_bus_add_match(d->connection.get(), s.c_str(), std::addressof(se.raw()));
+
+    ul.lock();
+    match_rules->adding.erase(s);
+    match_rules->changed.notify_all();
+
     if (se)
         throw std::runtime_error(se.print());
+
+    // Asynchronous subscribers might have installed the rule in the
+    // meantime. If their call is still in flight, it drops its copy once
+    // answered, otherwise we drop ours.
+    bool duplicate = false;
+    pending = match_rules->pending.find(s);
+    if (pending != match_rules->pending.end())
+        pending->second.confirmed = true;
+    else
+        duplicate = match_rules->counts.count(s) > 0;
+
+    match_rules->counts[s]++;
+    ul.unlock();
+
+    if (duplicate)
+        remove_duplicate_match(d->connection, s);
 }
 
 void Bus::remove_match(const MatchRule& rule)
 {
+    auto s = rule.as_string();
+
+    {
+        std::lock_guard<std::mutex> lg(d->match_rules->guard);
+
+        auto it = d->match_rules->counts.find(s);
+        if (it != d->match_rules->counts.end())
+        {
+            if (--it->second > 0)
+                return;
+
+            d->match_rules->counts.erase(it);
+        }
+
+        if (d->match_rules->local_only)
+            return;
+    }
+
+    // Rules we do not know about are handed to the daemon, too, which
+    // reports an error if it does not know about them either. A subscriber
+    // adding the rule again meanwhile installs another copy, which the
+    // daemon keeps independent of the order of both calls.
     Error se;
-    dbus_bus_remove_match(d->connection.get(), rule.as_string().c_str(), std::addressof(se.raw()));
+    dbus_bus_remove_match(d->connection.get(), s.c_str(), std::addressof(se.raw()));
     if (se)
         throw std::runtime_error(se.print());
 }
 
+std::future<Result<void>> Bus::add_match_asynchronously(const MatchRule& rule)
+{
+    auto promise = std::make_shared<std::promise<Result<void>>>();
+    auto future = promise->get_future();
+
+    add_match_asynchronously_with_notification(*this, d->connection, d->match_rules, rule.as_string(), [promise](const Message::Ptr& reply)
+    {
+        promise->set_value(result_for(reply));
+    });
+
+    return future;
+}
+
+std::future<Result<void>> Bus::add_matches_asynchronously(const std::vector<MatchRule>& rules)
+{
+    struct State
+    {
+        std::mutex guard;
+        std::size_t outstanding;
+        Message::Ptr first_error;
+        std::promise<Result<void>> promise;
+    };
+
+    auto state = std::make_shared<State>();
+    state->outstanding = rules.size() + 1;
+    auto future = state->promise.get_future();
+
+    auto notification = [state](const Message::Ptr& reply)
+    {
+        std::lock_guard<std::mutex> lg(state->guard);
+
+        if (reply && reply->type() == Message::Type::error && !state->first_error)
+            state->first_error = reply;
+
+        if (--state->outstanding == 0)
+            state->promise.set_value(result_for(state->first_error));
+    };
+
+    for (const MatchRule& rule : rules)
+        add_match_asynchronously_with_notification(*this, d->connection, d->match_rules, rule.as_string(), notification);
+
+    // Accounts for the initial count, such that the promise is not
+    // fulfilled before all calls have been submitted.
+    notification(Message::Ptr{});
+
+    return future;
+}
+
+std::future<Result<void>> Bus::remove_match_asynchronously(const MatchRule& rule)
+{
+    auto s = rule.as_string();
+
+    {
+        std::lock_guard<std::mutex> lg(d->match_rules->guard);
+
+        auto it = d->match_rules->counts.find(s);
+        if (it != d->match_rules->counts.end())
+        {
+            if (--it->second > 0)
+            {
+                std::promise<Result<void>> promise;
+                promise.set_value(Result<void>{});
+                return promise.get_future();
+            }
+
+            d->match_rules->counts.erase(it);
+        }
+
+        if (d->match_rules->local_only)
+        {
+            std::promise<Result<void>> promise;
+            promise.set_value(Result<void>{});
+            return promise.get_future();
+        }
+    }
+
+    auto promise = std::make_shared<std::promise<Result<void>>>();
+    auto future = promise->get_future();
+
+    auto pending_call = send_with_reply_and_timeout(
+                a_match_rule_call("RemoveMatch", s),
+                Bus::default_timeout());
+
+    pending_call->then([promise](const Message::Ptr& reply)
+    {
+        promise->set_value(Result<void>::from_message(reply));
+    });
+
+    return future;
+}
+
+std::map<std::string, std::size_t> Bus::match_rules() const
+{
+    std::lock_guard<std::mutex> lg(d->match_rules->guard);
+    return d->match_rules->counts;
+}
+
+MatchRuleIndex::Token Bus::subscribe_to_signals(const MatchRule& rule, const MatchRuleIndex::Handler& handler)
+{
+    auto signals = rule.type(Message::Type::signal);
+
+    // Nothing is routed if the daemon rejects the rule.
+    add_match(signals);
+    auto token = d->match_rule_index.install(signals, handler);
+
+    std::lock_guard<std::mutex> lg(d->subscriptions_guard);
+    d->subscriptions.insert(std::make_pair(token, signals));
+
+    return token;
+}
+
+void Bus::unsubscribe_from_signals(MatchRuleIndex::Token token)
+{
+    MatchRule rule;
+    {
+        std::lock_guard<std::mutex> lg(d->subscriptions_guard);
+        auto it = d->subscriptions.find(token);
+        if (it == d->subscriptions.end())
+            return;
+
+        rule = it->second;
+        d->subscriptions.erase(it);
+    }
+
+    d->match_rule_index.uninstall(token);
+    remove_match(rule);
+}
+
+std::size_t Bus::outstanding_calls() const
+{
+    return d->outstanding_calls->load();
+}
+
 bool Bus::has_owner_for_name(const std::string& name)
 {
-    return dbus_bus_name_has_owner(d->connection.get(), name.c_str(), nullptr);
+    // The peer is the only other party on the connection.
+    if (d->peer_to_peer)
+        return true;
+
+    auto name_owners = std::atomic_load(&d->name_owners);
+    if (!name_owners)
+        return dbus_bus_name_has_owner(d->connection.get(), name.c_str(), nullptr);
+
+    std::string owner;
+    if (name_owners->lookup(name, owner))
+        return !owner.empty();
+
+    name_owners->begin_query(name);
+
+    Error se;
+    auto msg = a_get_name_owner_call(name);
+    auto reply = dbus_connection_send_with_reply_and_block(
+                d->connection.get(),
+                msg->d->dbus_message.get(),
+                DBUS_TIMEOUT_USE_DEFAULT,
+                std::addressof(se.raw()));
+
+    if (reply)
+    {
+        const char* s = nullptr;
+        dbus_message_get_args(reply, nullptr, DBUS_TYPE_STRING, &s, DBUS_TYPE_INVALID);
+        owner = s ? s : "";
+        dbus_message_unref(reply);
+    } else if (se.name() != DBUS_ERROR_NAME_HAS_NO_OWNER)
+    {
+        // Errors other than the name not being owned are not cached.
+        name_owners->abort_query(name);
+        return false;
+    }
+
+    name_owners->end_query(name, owner);
+    return !owner.empty();
+}
+
+std::future<std::string> Bus::get_name_owner(const std::string& name)
+{
+    auto promise = std::make_shared<std::promise<std::string>>();
+    auto future = promise->get_future();
+
+    auto name_owners = std::atomic_load(&d->name_owners);
+
+    std::string owner;
+    if (name_owners && name_owners->lookup(name, owner))
+    {
+        promise->set_value(owner);
+        return future;
+    }
+
+    if (name_owners)
+        name_owners->begin_query(name);
+
+    PendingCall::Ptr pending_call;
+    try
+    {
+        pending_call = send_with_reply_and_timeout(
+                    a_get_name_owner_call(name),
+                    Bus::default_timeout());
+    }
+    catch (...)
+    {
+        if (name_owners)
+            name_owners->abort_query(name);
+        throw;
+    }
+
+    pending_call->then([promise, name_owners, name](const Message::Ptr& reply)
+    {
+        if (reply->type() == Message::Type::error && reply->error().name() != DBUS_ERROR_NAME_HAS_NO_OWNER)
+        {
+            if (name_owners)
+                name_owners->abort_query(name);
+            promise->set_exception(std::make_exception_ptr(std::runtime_error(reply->error().print())));
+            return;
+        }
+
+        std::string owner;
+        if (reply->type() == Message::Type::method_return)
+            owner = reply->reader().pop_string();
+
+        if (name_owners)
+            name_owners->end_query(name, owner);
+
+        promise->set_value(owner);
+    });
+
+    return future;
+}
+
+void Bus::enable_name_owner_cache()
+{
+    std::lock_guard<std::mutex> lg(d->name_owners_guard);
+
+    if (d->name_owners)
+        return;
+
+    auto name_owners = std::make_shared<NameOwners>();
+    auto rule = impl::NameOwnerChanged::rule();
+
+    auto token = d->match_rule_index.install(rule, [name_owners](const Message::Ptr& msg)
+    {
+        name_owners->on_name_owner_changed(msg);
+    });
+
+    try
+    {
+        add_match(rule);
+    }
+    catch (...)
+    {
+        d->match_rule_index.uninstall(token);
+        throw;
+    }
+
+    std::atomic_store(&d->name_owners, name_owners);
+}
+
+void Bus::enable_loopback()
+{
+    d->local_calls->enabled = true;
+}
+
+void Bus::capture_to(const std::shared_ptr<MessageLog::Writer>& log)
+{
+    std::atomic_store(&d->captured.log, log);
+    d->captured.enabled = static_cast<bool>(log);
+}
+
+void Bus::set_outgoing_high_water_mark(std::size_t bytes, OutgoingQueuePolicy policy)
+{
+    d->outgoing.policy = policy;
+    d->outgoing.high_water_mark = bytes;
+    d->update_outgoing_queue_state();
+}
+
+std::size_t Bus::outgoing_high_water_mark() const
+{
+    return d->outgoing.high_water_mark;
+}
+
+std::size_t Bus::outgoing_queue_size() const
+{
+    return d->update_outgoing_queue_state();
+}
+
+const core::Signal<bool>& Bus::outgoing_high_water_mark_crossed() const
+{
+    return d->outgoing.crossed;
 }
 
 void Bus::install_executor(const Executor::Ptr& e)
@@ -382,11 +1787,59 @@ void Bus::register_object_for_path(
         delete vtable;
         throw std::runtime_error(e.print());
     }
+
+    std::lock_guard<std::mutex> lg(d->local_calls->guard);
+    d->local_calls->objects[path.as_string()] = object;
+}
+
+void Bus::register_subtree_for_path(
+        const types::ObjectPath& path,
+        const SubtreeHandler& handler)
+{
+    // libdbus copies the function pointers, the vtable can be shared
+    // across all registrations.
+    static const DBusObjectPathVTable vtable
+    {
+            SubtreeVTable::unregister_subtree,
+            SubtreeVTable::on_new_message,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr
+    };
+
+    auto data = new SubtreeVTable{path.as_string().size(), handler};
+
+    Error e;
+    auto result = dbus_connection_try_register_fallback(
+                d->connection.get(),
+                path.as_string().c_str(),
+                std::addressof(vtable),
+                data,
+                std::addressof(e.raw()));
+
+    if (!result)
+    {
+        delete data;
+
+        if (!e)
+            throw Errors::NoMemory{};
+
+        if (e.name() == DBUS_ERROR_OBJECT_PATH_IN_USE)
+            throw Errors::ObjectPathInUse{};
+
+        throw std::runtime_error(e.print());
+    }
 }
 
 void Bus::unregister_object_path(
         const types::ObjectPath& path)
 {
+    {
+        std::lock_guard<std::mutex> lg(d->local_calls->guard);
+        d->local_calls->objects.erase(path.as_string());
+    }
+
     dbus_connection_unregister_object_path(
                 d->connection.get(),
                 path.as_string().c_str());
@@ -397,6 +1850,20 @@ Bus::SignalRouter& Bus::access_signal_router()
     return d->signal_router;
 }
 
+MatchRuleIndex& Bus::access_match_rule_index()
+{
+    return d->match_rule_index;
+}
+
+NameWatchRegistry& Bus::access_name_watch_registry()
+{
+    std::call_once(d->name_watch_registry_once, [this]()
+    {
+        d->name_watch_registry.reset(new NameWatchRegistry(*this));
+    });
+    return *d->name_watch_registry;
+}
+
 DBusConnection* Bus::raw() const
 {
     return d->connection.get();
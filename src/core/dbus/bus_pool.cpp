@@ -0,0 +1,132 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/bus_pool.h>
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <stdexcept>
+
+namespace dbus = core::dbus;
+
+namespace
+{
+// Connects concurrently and waits for all connections, such that no
+// connection is left behind if any of them fails.
+template<typename Address>
+std::vector<dbus::Bus::Ptr> connect(const Address& address, std::size_t size)
+{
+    if (size == 0)
+        throw std::runtime_error("Cannot create a connection pool without connections.");
+
+    std::vector<std::future<dbus::Bus::Ptr>> futures;
+    for (std::size_t i = 0; i < size; i++)
+        futures.push_back(dbus::Bus::connect_asynchronously(address));
+
+    std::vector<dbus::Bus::Ptr> result;
+    std::exception_ptr error;
+
+    for (auto& future : futures)
+    {
+        try
+        {
+            result.push_back(future.get());
+        }
+        catch (...)
+        {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+
+    return result;
+}
+}
+
+struct dbus::BusPool::Private
+{
+    Private(std::vector<Bus::Ptr> connections, Policy policy)
+        : connections(std::move(connections)),
+          policy(policy),
+          next(0)
+    {
+    }
+
+    std::vector<Bus::Ptr> connections;
+    Policy policy;
+    std::atomic<std::size_t> next;
+};
+
+dbus::BusPool::BusPool(const std::string& address, std::size_t size, Policy policy)
+    : d(new Private(connect(address, size), policy))
+{
+}
+
+dbus::BusPool::BusPool(WellKnownBus bus, std::size_t size, Policy policy)
+    : d(new Private(connect(bus, size), policy))
+{
+}
+
+dbus::BusPool::~BusPool()
+{
+}
+
+const std::vector<dbus::Bus::Ptr>& dbus::BusPool::connections() const
+{
+    return d->connections;
+}
+
+const dbus::Bus::Ptr& dbus::BusPool::primary() const
+{
+    return d->connections.front();
+}
+
+dbus::BusPool::Policy dbus::BusPool::policy() const
+{
+    return d->policy;
+}
+
+const dbus::Bus::Ptr& dbus::BusPool::connection_for_method_call(const types::ObjectPath& path)
+{
+    switch (d->policy)
+    {
+    case Policy::round_robin:
+        return d->connections[d->next++ % d->connections.size()];
+    case Policy::least_in_flight:
+    {
+        std::size_t index = 0;
+        std::size_t least = d->connections[0]->outstanding_calls();
+        for (std::size_t i = 1; i < d->connections.size() && least > 0; i++)
+        {
+            auto outstanding = d->connections[i]->outstanding_calls();
+            if (outstanding < least)
+            {
+                index = i;
+                least = outstanding;
+            }
+        }
+        return d->connections[index];
+    }
+    case Policy::object_path_hash:
+        return d->connections[std::hash<std::string>()(path.as_string()) % d->connections.size()];
+    }
+
+    return primary();
+}
@@ -153,7 +153,7 @@ std::string DBus::hello() const
 std::unique_ptr<ServiceWatcher> DBus::make_service_watcher(const std::string& name,
         WatchMode watch_mode)
 {
-    return std::unique_ptr<ServiceWatcher>(new ServiceWatcher(object, name, watch_mode));
+    return std::unique_ptr<ServiceWatcher>(new ServiceWatcher(bus, name, watch_mode));
 }
 
 }
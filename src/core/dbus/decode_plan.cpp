@@ -0,0 +1,330 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/decode_plan.h>
+
+#include "message_p.h"
+
+#include <dbus/dbus.h>
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+typedef core::dbus::DecodePlan::Instruction Instruction;
+typedef core::dbus::DecodePlan::OpCode OpCode;
+
+std::string signature_at(DBusSignatureIter* it)
+{
+    char* s = dbus_signature_iter_get_signature(it);
+    std::string result{s};
+    dbus_free(s);
+    return result;
+}
+
+// Compiles the single complete type the iterator points to, appending to
+// instructions. Returns the container nesting depth of the compiled type.
+std::size_t compile_single_complete_type(DBusSignatureIter* it, std::vector<Instruction>& instructions)
+{
+    auto type = static_cast<core::dbus::ArgumentType>(dbus_signature_iter_get_current_type(it));
+    std::size_t depth = 0;
+
+    switch (type)
+    {
+    case core::dbus::ArgumentType::array:
+    {
+        DBusSignatureIter sub;
+        dbus_signature_iter_recurse(it, std::addressof(sub));
+
+        auto enter = instructions.size();
+        instructions.push_back(Instruction{OpCode::enter_array, type, 0, signature_at(std::addressof(sub))});
+        depth = compile_single_complete_type(std::addressof(sub), instructions);
+        instructions.push_back(Instruction{OpCode::next_element, type, enter + 1, std::string{}});
+        instructions[enter].jump = instructions.size();
+        instructions.push_back(Instruction{OpCode::leave_array, type, 0, std::string{}});
+        break;
+    }
+    case core::dbus::ArgumentType::structure:
+    case core::dbus::ArgumentType::dictionary_entry:
+    {
+        bool is_structure = type == core::dbus::ArgumentType::structure;
+
+        // Strip the enclosing parentheses or braces to obtain the member signature.
+        auto s = signature_at(it);
+        instructions.push_back(Instruction
+        {
+            is_structure ? OpCode::enter_structure : OpCode::enter_dict_entry,
+            type,
+            0,
+            s.substr(1, s.size() - 2)
+        });
+
+        DBusSignatureIter sub;
+        dbus_signature_iter_recurse(it, std::addressof(sub));
+        do
+        {
+            depth = std::max(depth, compile_single_complete_type(std::addressof(sub), instructions));
+        } while (dbus_signature_iter_next(std::addressof(sub)));
+
+        instructions.push_back(Instruction
+        {
+            is_structure ? OpCode::leave_structure : OpCode::leave_dict_entry,
+            type,
+            0,
+            std::string{}
+        });
+        break;
+    }
+    case core::dbus::ArgumentType::variant:
+        instructions.push_back(Instruction{OpCode::decode_variant, type, 0, std::string{}});
+        break;
+    default:
+        instructions.push_back(Instruction{OpCode::decode_basic, type, 0, std::string{}});
+        return 0;
+    }
+
+    return depth + 1;
+}
+
+inline void ensure_argument_type_or_throw(DBusMessageIter* it, core::dbus::ArgumentType expected_type)
+{
+    auto actual_type = static_cast<core::dbus::ArgumentType>(dbus_message_iter_get_arg_type(it));
+    if (actual_type != expected_type)
+    {
+        std::stringstream ss;
+        ss << "Mismatch between expected and actual type reported by iterator: " << std::endl
+           << "\t Expected: " << expected_type << std::endl
+           << "\t Actual: " << actual_type;
+        throw std::runtime_error(ss.str());
+    }
+}
+
+// Plans are keyed by signature and live as long as the process does. Only
+// signatures known to the process end up here, the contents of variants
+// are chosen by remote peers and never cached. The limit bounds the cache
+// nevertheless, plans beyond it are compiled per request.
+struct Cache
+{
+    static constexpr std::size_t max_size = 1024;
+
+    static Cache& instance()
+    {
+        static Cache cache;
+        return cache;
+    }
+
+    std::mutex guard;
+    std::unordered_map<std::string, core::dbus::DecodePlan::Ptr> plans;
+};
+}
+
+void core::dbus::DecodePlan::Visitor::on_enter(ArgumentType, const char*)
+{
+}
+
+void core::dbus::DecodePlan::Visitor::on_leave(ArgumentType)
+{
+}
+
+core::dbus::DecodePlan::Ptr core::dbus::DecodePlan::compile(const std::string& signature)
+{
+    return Ptr{new DecodePlan(signature)};
+}
+
+core::dbus::DecodePlan::Ptr core::dbus::DecodePlan::for_signature(const std::string& signature)
+{
+    auto& cache = Cache::instance();
+
+    {
+        std::lock_guard<std::mutex> lg(cache.guard);
+        auto it = cache.plans.find(signature);
+        if (it != cache.plans.end())
+            return it->second;
+    }
+
+    // We compile outside of the lock and accept that concurrent
+    // callers might compile the same signature twice.
+    auto plan = compile(signature);
+
+    std::lock_guard<std::mutex> lg(cache.guard);
+    if (cache.plans.size() >= Cache::max_size)
+        return plan;
+
+    return cache.plans.insert(std::make_pair(signature, plan)).first->second;
+}
+
+core::dbus::DecodePlan::DecodePlan(const std::string& signature)
+    : signature_(signature),
+      max_depth_(0)
+{
+    DBusError error;
+    dbus_error_init(std::addressof(error));
+
+    if (!dbus_signature_validate(signature.c_str(), std::addressof(error)))
+    {
+        std::stringstream ss;
+        ss << "Cannot compile decode plan for invalid signature " << signature << ": " << error.message;
+        dbus_error_free(std::addressof(error));
+        throw std::runtime_error(ss.str());
+    }
+
+    if (signature.empty())
+        return;
+
+    DBusSignatureIter it;
+    dbus_signature_iter_init(std::addressof(it), signature.c_str());
+    do
+    {
+        max_depth_ = std::max(max_depth_, compile_single_complete_type(std::addressof(it), instructions_));
+    } while (dbus_signature_iter_next(std::addressof(it)));
+}
+
+const std::string& core::dbus::DecodePlan::signature() const
+{
+    return signature_;
+}
+
+const std::vector<core::dbus::DecodePlan::Instruction>& core::dbus::DecodePlan::instructions() const
+{
+    return instructions_;
+}
+
+void core::dbus::DecodePlan::execute(Message::Reader& reader, Visitor& visitor) const
+{
+    if (!reader.d)
+        throw std::runtime_error("Precondition violated, cannot execute decode plan on invalid reader.");
+
+    // Every container we enter pushes an iterator, every variant we enter
+    // additionally pushes a frame running the plan of the contained signature.
+    struct Frame
+    {
+        const DecodePlan* plan;
+        Ptr keep_alive;
+        std::size_t pc;
+    };
+
+    std::vector<DBusMessageIter> iterators;
+    iterators.reserve(max_depth_ + 1);
+    iterators.push_back(reader.d->iter);
+
+    std::vector<Frame> frames;
+    frames.push_back(Frame{this, Ptr{}, 0});
+
+    while (!frames.empty())
+    {
+        Frame& frame = frames.back();
+
+        if (frame.pc == frame.plan->instructions_.size())
+        {
+            frames.pop_back();
+            if (!frames.empty())
+            {
+                iterators.pop_back();
+                visitor.on_leave(ArgumentType::variant);
+            }
+            continue;
+        }
+
+        const Instruction& instruction = frame.plan->instructions_[frame.pc++];
+        DBusMessageIter* it = std::addressof(iterators.back());
+
+        switch (instruction.op)
+        {
+        case OpCode::decode_basic:
+        {
+            ensure_argument_type_or_throw(it, instruction.type);
+            DBusBasicValue value;
+            dbus_message_iter_get_basic(it, std::addressof(value));
+            dbus_message_iter_next(it);
+            visitor.on_basic(instruction.type, value);
+            break;
+        }
+        case OpCode::enter_array:
+        {
+            ensure_argument_type_or_throw(it, instruction.type);
+            // Compares the complete element signature, empty arrays would
+            // otherwise pass without any of their element instructions running.
+            char* s = dbus_message_iter_get_signature(it);
+            bool matches = s[0] == DBUS_TYPE_ARRAY && instruction.signature == s + 1;
+            dbus_free(s);
+            if (!matches)
+                throw std::runtime_error("Mismatch between expected and actual array element signature: " + instruction.signature);
+
+            DBusMessageIter sub;
+            dbus_message_iter_recurse(it, std::addressof(sub));
+            dbus_message_iter_next(it);
+            iterators.push_back(sub);
+            visitor.on_enter(instruction.type, instruction.signature.c_str());
+
+            if (dbus_message_iter_get_arg_type(std::addressof(iterators.back())) == DBUS_TYPE_INVALID)
+                frame.pc = instruction.jump;
+            break;
+        }
+        case OpCode::next_element:
+            if (dbus_message_iter_get_arg_type(it) != DBUS_TYPE_INVALID)
+                frame.pc = instruction.jump;
+            break;
+        case OpCode::enter_structure:
+        case OpCode::enter_dict_entry:
+        {
+            ensure_argument_type_or_throw(it, instruction.type);
+            DBusMessageIter sub;
+            dbus_message_iter_recurse(it, std::addressof(sub));
+            dbus_message_iter_next(it);
+            iterators.push_back(sub);
+            visitor.on_enter(instruction.type, instruction.signature.c_str());
+            break;
+        }
+        case OpCode::leave_structure:
+        case OpCode::leave_dict_entry:
+            // Members beyond the ones of the plan would be skipped silently.
+            if (dbus_message_iter_get_arg_type(it) != DBUS_TYPE_INVALID)
+                throw std::runtime_error("Mismatch between expected and actual number of members of " + std::string(instruction.type == ArgumentType::structure ? "structure" : "dict entry"));
+            iterators.pop_back();
+            visitor.on_leave(instruction.type);
+            break;
+        case OpCode::leave_array:
+            iterators.pop_back();
+            visitor.on_leave(instruction.type);
+            break;
+        case OpCode::decode_variant:
+        {
+            ensure_argument_type_or_throw(it, instruction.type);
+            DBusMessageIter sub;
+            dbus_message_iter_recurse(it, std::addressof(sub));
+            dbus_message_iter_next(it);
+
+            // The contained signature is up to the sender, its plan is not cached.
+            char* s = dbus_message_iter_get_signature(std::addressof(sub));
+            std::string signature{s};
+            dbus_free(s);
+            auto plan = compile(signature);
+
+            iterators.push_back(sub);
+            visitor.on_enter(instruction.type, plan->signature_.c_str());
+            // Invalidates frame.
+            frames.push_back(Frame{plan.get(), plan, 0});
+            break;
+        }
+        }
+    }
+
+    reader.d->iter = iterators.front();
+}
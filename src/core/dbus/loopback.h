@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_LOOPBACK_H_
+#define CORE_DBUS_LOOPBACK_H_
+
+#include <core/dbus/message.h>
+#include <core/dbus/pending_call.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace core
+{
+namespace dbus
+{
+class Object;
+namespace impl
+{
+// Book-keeping for method calls that are dispatched to objects exposed on
+// the very same connection, without ever reaching libdbus' transport.
+struct LocalCalls
+{
+    typedef std::function<void(const Message::Ptr&)> Completion;
+
+    // Removes the call with the given serial without completing it.
+    void abandon(std::uint32_t serial)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        pending.erase(serial);
+    }
+
+    // Removes the call with the given serial, returning its completion or
+    // an empty one if the call completed or was abandoned before.
+    Completion take(std::uint32_t serial)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+
+        Completion result;
+        auto it = pending.find(serial);
+        if (it != pending.end())
+        {
+            result = std::move(it->second);
+            pending.erase(it);
+        }
+
+        return result;
+    }
+
+    // Hands out serials for local messages, never returning 0.
+    std::uint32_t next_serial_locked()
+    {
+        if (++serial == 0)
+            ++serial;
+        return serial;
+    }
+
+    std::atomic<bool> enabled{false};
+
+    std::mutex guard;
+    // Names acquired on the connection.
+    std::set<std::string> names;
+    // Objects registered with the connection, by path.
+    std::unordered_map<std::string, std::weak_ptr<Object>> objects;
+    // Calls awaiting a reply, by serial.
+    std::unordered_map<std::uint32_t, Completion> pending;
+    std::uint32_t serial = 0;
+};
+
+// A pending call that is completed by a reply sent on the same connection.
+class LocalPendingCall : public core::dbus::PendingCall
+{
+public:
+    LocalPendingCall(
+            const std::weak_ptr<LocalCalls>& calls,
+            const std::function<void()>& on_completed)
+        : completed(false),
+          serial(0),
+          calls(calls),
+          on_completed(on_completed)
+    {
+    }
+
+    // Announces the reply and invokes the callback if set.
+    void complete(const Message::Ptr& reply)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        if (completed.exchange(true))
+            return;
+
+        if (cancel_timeout)
+            cancel_timeout();
+
+        if (on_completed)
+            on_completed();
+
+        message = reply;
+
+        if (callback)
+            callback(message);
+    }
+
+    // Keeps the cancellation of the timer timing out the call, invoked once the call completes.
+    void arm(const std::function<void()>& cancellation)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        if (completed)
+        {
+            cancellation();
+            return;
+        }
+
+        cancel_timeout = cancellation;
+    }
+
+    // Completes the call with the given error unless a reply arrived before.
+    void time_out(const Message::Ptr& error)
+    {
+        if (auto sp = calls.lock())
+            sp->abandon(serial);
+
+        complete(error);
+    }
+
+    // Cancels the outstanding call, a cancelled call never completes.
+    void cancel() override
+    {
+        if (auto sp = calls.lock())
+            sp->abandon(serial);
+
+        std::lock_guard<std::mutex> lg(guard);
+        if (completed.exchange(true))
+            return;
+
+        if (cancel_timeout)
+            cancel_timeout();
+
+        if (on_completed)
+            on_completed();
+    }
+
+    // Installs a continuation and invokes it if the call already completed.
+    void then(const core::dbus::PendingCall::Notification& notification) override
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        callback = notification;
+
+        if (message)
+            callback(message);
+    }
+
+    std::atomic<bool> completed;
+    std::uint32_t serial;
+
+private:
+    std::weak_ptr<LocalCalls> calls;
+    std::function<void()> on_completed;
+    std::function<void()> cancel_timeout;
+    std::mutex guard;
+    Message::Ptr message;
+    core::dbus::PendingCall::Notification callback;
+};
+}
+}
+}
+
+#endif // CORE_DBUS_LOOPBACK_H_
@@ -18,6 +18,8 @@
 
 #include <core/dbus/match_rule.h>
 
+#include "match_rule_p.h"
+
 #include <map>
 #include <sstream>
 #include <string>
@@ -42,17 +44,28 @@ struct Comma
 
     mutable bool is_required;
 };
-}
 
-struct dbus::MatchRule::Private
+// Quotes a value according to the match rule grammar. Apostrophes cannot
+// be escaped within quotes, so we close the quotes, emit an escaped
+// apostrophe and reopen the quotes.
+struct Quoted
 {
-    Message::Type type = Message::Type::invalid;
-    std::string sender;
-    std::string interface;
-    std::string member;
-    types::ObjectPath path;
-    dbus::MatchRule::MatchArgs args;
+    friend std::ostream& operator<<(std::ostream& out, const Quoted& q)
+    {
+        out << "'";
+        for (char c : q.value)
+        {
+            if (c == '\'')
+                out << "'\\''";
+            else
+                out << c;
+        }
+        return out << "'";
+    }
+
+    const std::string& value;
 };
+}
 
 dbus::MatchRule::MatchRule() : d(new Private())
 {
@@ -99,6 +112,18 @@ dbus::MatchRule dbus::MatchRule::sender(const std::string& s) const
     return result;
 }
 
+dbus::MatchRule& dbus::MatchRule::destination(const std::string& d)
+{
+    this->d->destination = d;
+    return *this;
+}
+
+dbus::MatchRule dbus::MatchRule::destination(const std::string& d) const
+{
+    MatchRule result {*this};
+    return result.destination(d);
+}
+
 dbus::MatchRule& dbus::MatchRule::interface(const std::string& i)
 {
     d->interface = i;
@@ -137,6 +162,18 @@ dbus::MatchRule dbus::MatchRule::path(const dbus::types::ObjectPath& p) const
     return result.path(p);
 }
 
+dbus::MatchRule& dbus::MatchRule::path_namespace(const types::ObjectPath& p)
+{
+    d->path_namespace = p.as_string();
+    return *this;
+}
+
+dbus::MatchRule dbus::MatchRule::path_namespace(const dbus::types::ObjectPath& p) const
+{
+    MatchRule result {*this};
+    return result.path_namespace(p);
+}
+
 dbus::MatchRule& dbus::MatchRule::args(const MatchArgs& p)
 {
     d->args = p;
@@ -149,6 +186,42 @@ dbus::MatchRule& dbus::MatchRule::args(const MatchArgs& p) const
     return result.args(p);
 }
 
+dbus::MatchRule& dbus::MatchRule::arg_paths(const MatchArgs& p)
+{
+    d->arg_paths = p;
+    return *this;
+}
+
+dbus::MatchRule dbus::MatchRule::arg_paths(const MatchArgs& p) const
+{
+    MatchRule result {*this};
+    return result.arg_paths(p);
+}
+
+dbus::MatchRule& dbus::MatchRule::arg0_namespace(const std::string& n)
+{
+    d->arg0_namespace = n;
+    return *this;
+}
+
+dbus::MatchRule dbus::MatchRule::arg0_namespace(const std::string& n) const
+{
+    MatchRule result {*this};
+    return result.arg0_namespace(n);
+}
+
+dbus::MatchRule& dbus::MatchRule::eavesdrop(bool e)
+{
+    d->eavesdrop = e;
+    return *this;
+}
+
+dbus::MatchRule dbus::MatchRule::eavesdrop(bool e) const
+{
+    MatchRule result {*this};
+    return result.eavesdrop(e);
+}
+
 std::string dbus::MatchRule::as_string() const
 {
     Comma comma;
@@ -156,16 +229,28 @@ std::string dbus::MatchRule::as_string() const
     if (d->type != Message::Type::invalid)
         ss << "type='" << d->type << "'" << comma;
     if (!d->sender.empty())
-        ss << comma << "sender='" << d->sender << "'" << comma;
+        ss << comma << "sender=" << Quoted{d->sender} << comma;
+    if (!d->destination.empty())
+        ss << comma << "destination=" << Quoted{d->destination} << comma;
     if (!d->interface.empty())
-        ss << comma << "interface='" << d->interface << "'" << comma;
+        ss << comma << "interface=" << Quoted{d->interface} << comma;
     if (!d->member.empty())
-        ss << comma << "member='" << d->member << "'" << comma;
-    if (!d->path.empty())
-        ss << comma << "path='" << d->path.as_string() << "'" << comma;
+        ss << comma << "member=" << Quoted{d->member} << comma;
+    // path and path_namespace are mutually exclusive.
+    if (!d->path_namespace.empty())
+        ss << comma << "path_namespace=" << Quoted{d->path_namespace} << comma;
+    else if (!d->path.empty())
+        ss << comma << "path=" << Quoted{d->path.as_string()} << comma;
     for(const MatchArg& arg: d->args) {
-        ss << comma << "arg" << arg.first << "='" << arg.second << "'" << comma;
+        ss << comma << "arg" << arg.first << "=" << Quoted{arg.second} << comma;
+    }
+    for(const MatchArg& arg: d->arg_paths) {
+        ss << comma << "arg" << arg.first << "path=" << Quoted{arg.second} << comma;
     }
+    if (!d->arg0_namespace.empty())
+        ss << comma << "arg0namespace=" << Quoted{d->arg0_namespace} << comma;
+    if (d->eavesdrop)
+        ss << comma << "eavesdrop='true'" << comma;
 
     return ss.str();
 }
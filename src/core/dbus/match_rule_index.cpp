@@ -0,0 +1,355 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/match_rule_index.h>
+
+#include "match_rule_p.h"
+#include "message_p.h"
+
+#include <dbus/dbus.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace dbus = core::dbus;
+
+namespace
+{
+// A rule compiled for evaluation, i.e., with all the criteria that are not
+// covered by the interface and member index.
+struct Entry
+{
+    dbus::MatchRuleIndex::Token token;
+    dbus::Message::Type type;
+    std::string sender;
+    std::string destination;
+    std::string path;
+    std::string path_namespace;
+    dbus::MatchRule::MatchArgs args;
+    dbus::MatchRule::MatchArgs arg_paths;
+    std::string arg0_namespace;
+    // Number of leading arguments referenced by args, arg_paths and arg0_namespace.
+    std::size_t arg_count;
+    dbus::MatchRuleIndex::Handler handler;
+};
+
+typedef std::map<dbus::MatchRuleIndex::Token, std::shared_ptr<const Entry>> Entries;
+
+inline bool is_prefix_of(const std::string& prefix, const char* s)
+{
+    return std::strncmp(prefix.c_str(), s, prefix.size()) == 0;
+}
+
+// Implements the namespace semantics of argNpath: either one of the
+// values is a namespace of the other, i.e., ends in '/' and is a prefix
+// of the other.
+bool matches_arg_path(const std::string& value, const char* arg)
+{
+    if (value == arg)
+        return true;
+
+    if (!value.empty() && value.back() == '/' && is_prefix_of(value, arg))
+        return true;
+
+    auto length = std::strlen(arg);
+    return length > 0 && arg[length - 1] == '/' && value.compare(0, length, arg) == 0;
+}
+
+bool matches_path_namespace(const std::string& ns, const char* path)
+{
+    if (ns == "/")
+        return true;
+
+    return is_prefix_of(ns, path) && (path[ns.size()] == '\0' || path[ns.size()] == '/');
+}
+
+bool matches_arg0_namespace(const std::string& ns, const char* arg)
+{
+    return is_prefix_of(ns, arg) && (arg[ns.size()] == '\0' || arg[ns.size()] == '.');
+}
+
+// The leading arguments of a message, extracted in a single pass. Only
+// string and object path arguments are of interest for matching.
+struct Arguments
+{
+    Arguments(DBusMessage* msg, std::size_t count) : strings(count, nullptr), is_path(count, false)
+    {
+        DBusMessageIter it;
+        if (!dbus_message_iter_init(msg, std::addressof(it)))
+            return;
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto type = dbus_message_iter_get_arg_type(std::addressof(it));
+            if (type == DBUS_TYPE_INVALID)
+                break;
+
+            if (type == DBUS_TYPE_STRING || type == DBUS_TYPE_OBJECT_PATH)
+            {
+                dbus_message_iter_get_basic(std::addressof(it), std::addressof(strings[i]));
+                is_path[i] = type == DBUS_TYPE_OBJECT_PATH;
+            }
+
+            dbus_message_iter_next(std::addressof(it));
+        }
+    }
+
+    std::vector<const char*> strings;
+    std::vector<bool> is_path;
+};
+
+bool matches(const Entry& entry, DBusMessage* msg, const Arguments& arguments)
+{
+    if (entry.type != dbus::Message::Type::invalid && static_cast<int>(entry.type) != dbus_message_get_type(msg))
+        return false;
+
+    // Well-known names can only be resolved by the daemon.
+    if (!entry.sender.empty() && entry.sender[0] == ':')
+    {
+        const char* sender = dbus_message_get_sender(msg);
+        if (!sender || entry.sender != sender)
+            return false;
+    }
+
+    if (!entry.destination.empty())
+    {
+        const char* destination = dbus_message_get_destination(msg);
+        if (!destination || entry.destination != destination)
+            return false;
+    }
+
+    // path and path_namespace are mutually exclusive, refer to MatchRule::as_string.
+    const char* path = dbus_message_get_path(msg);
+    if (!entry.path_namespace.empty())
+    {
+        if (!path || !matches_path_namespace(entry.path_namespace, path))
+            return false;
+    }
+    else if (!entry.path.empty())
+    {
+        if (!path || entry.path != path)
+            return false;
+    }
+
+    for (const dbus::MatchRule::MatchArg& arg : entry.args)
+    {
+        const char* value = arguments.strings[arg.first];
+        if (!value || arguments.is_path[arg.first] || arg.second != value)
+            return false;
+    }
+
+    for (const dbus::MatchRule::MatchArg& arg : entry.arg_paths)
+    {
+        const char* value = arguments.strings[arg.first];
+        if (!value || !matches_arg_path(arg.second, value))
+            return false;
+    }
+
+    if (!entry.arg0_namespace.empty())
+    {
+        const char* value = arguments.strings[0];
+        if (!value || arguments.is_path[0] || !matches_arg0_namespace(entry.arg0_namespace, value))
+            return false;
+    }
+
+    return true;
+}
+}
+
+struct dbus::MatchRuleIndex::Private
+{
+    // Interface, member and path a rule is bucketed by.
+    typedef std::tuple<std::string, std::string, std::string> Key;
+
+    // Appends the entries in the buckets for interface and member to
+    // candidates, i.e., the ones for path and the ones not restricting it.
+    void collect_candidates(const std::string& interface, const std::string& member, const std::string& path, std::vector<std::shared_ptr<const Entry>>& candidates)
+    {
+        auto it = buckets.find(interface);
+        if (it == buckets.end())
+            return;
+
+        auto jt = it->second.find(member);
+        if (jt == it->second.end())
+            return;
+
+        for (const std::string& p : {std::string{}, path})
+        {
+            auto kt = jt->second.find(p);
+            if (kt == jt->second.end())
+                continue;
+
+            for (const auto& pair : kt->second)
+                candidates.push_back(pair.second);
+
+            if (path.empty())
+                break;
+        }
+    }
+
+    mutable std::mutex guard;
+    // Mirrors keys.size(), allows for skipping evaluation of messages
+    // without taking the lock while no rules are installed.
+    std::atomic<std::size_t> count{0};
+    Token next_token = 0;
+    // Rules are bucketed by interface, member and path, an empty string
+    // denoting a rule that does not restrict the respective field. Rules
+    // for a path namespace are bucketed with the ones not restricting the path.
+    std::unordered_map<std::string, std::unordered_map<std::string, std::unordered_map<std::string, Entries>>> buckets;
+    // Maps tokens back to their bucket for uninstalling rules.
+    std::unordered_map<Token, Key> keys;
+};
+
+dbus::MatchRuleIndex::MatchRuleIndex() : d(new Private())
+{
+}
+
+dbus::MatchRuleIndex::~MatchRuleIndex()
+{
+}
+
+dbus::MatchRuleIndex::Token dbus::MatchRuleIndex::install(const MatchRule& rule, const Handler& handler)
+{
+    std::shared_ptr<Entry> entry{new Entry
+    {
+        0,
+        rule.d->type,
+        rule.d->sender,
+        rule.d->destination,
+        rule.d->path.as_string(),
+        rule.d->path_namespace,
+        rule.d->args,
+        rule.d->arg_paths,
+        rule.d->arg0_namespace,
+        rule.d->arg0_namespace.empty() ? std::size_t{0} : std::size_t{1},
+        handler
+    }};
+
+    for (const MatchRule::MatchArg& arg : entry->args)
+        entry->arg_count = std::max(entry->arg_count, arg.first + 1);
+    for (const MatchRule::MatchArg& arg : entry->arg_paths)
+        entry->arg_count = std::max(entry->arg_count, arg.first + 1);
+
+    std::lock_guard<std::mutex> lg(d->guard);
+
+    const std::string& path = rule.d->path_namespace.empty() ? entry->path : std::string{};
+
+    entry->token = d->next_token++;
+    d->buckets[rule.d->interface][rule.d->member][path].insert(std::make_pair(entry->token, entry));
+    d->keys.insert(std::make_pair(entry->token, Private::Key{rule.d->interface, rule.d->member, path}));
+    d->count.store(d->keys.size());
+
+    return entry->token;
+}
+
+void dbus::MatchRuleIndex::uninstall(Token token)
+{
+    std::lock_guard<std::mutex> lg(d->guard);
+
+    auto it = d->keys.find(token);
+    if (it == d->keys.end())
+        return;
+
+    const std::string& interface = std::get<0>(it->second);
+    const std::string& member = std::get<1>(it->second);
+    const std::string& path = std::get<2>(it->second);
+
+    auto& members = d->buckets[interface];
+    auto& paths = members[member];
+    auto& entries = paths[path];
+
+    entries.erase(token);
+    if (entries.empty())
+        paths.erase(path);
+    if (paths.empty())
+        members.erase(member);
+    if (members.empty())
+        d->buckets.erase(interface);
+
+    d->keys.erase(it);
+    d->count.store(d->keys.size());
+}
+
+std::size_t dbus::MatchRuleIndex::size() const
+{
+    return d->count.load();
+}
+
+bool dbus::MatchRuleIndex::operator()(const Message::Ptr& msg)
+{
+    // Every incoming signal passes through here, most of the time without
+    // any rule installed.
+    if (d->count.load() == 0)
+        return false;
+
+    DBusMessage* raw = msg->d->dbus_message.get();
+
+    const char* interface = dbus_message_get_interface(raw);
+    const char* member = dbus_message_get_member(raw);
+    const char* path = dbus_message_get_path(raw);
+
+    std::vector<std::shared_ptr<const Entry>> candidates;
+
+    {
+        std::lock_guard<std::mutex> lg(d->guard);
+
+        const std::string empty;
+        const std::string i{interface ? interface : ""};
+        const std::string m{member ? member : ""};
+        const std::string p{path ? path : ""};
+
+        d->collect_candidates(empty, empty, p, candidates);
+        if (!m.empty())
+            d->collect_candidates(empty, m, p, candidates);
+        if (!i.empty())
+            d->collect_candidates(i, empty, p, candidates);
+        if (!i.empty() && !m.empty())
+            d->collect_candidates(i, m, p, candidates);
+    }
+
+    if (candidates.empty())
+        return false;
+
+    std::sort(candidates.begin(), candidates.end(), [](const std::shared_ptr<const Entry>& lhs, const std::shared_ptr<const Entry>& rhs)
+    {
+        return lhs->token < rhs->token;
+    });
+
+    std::size_t arg_count = 0;
+    for (const auto& candidate : candidates)
+        arg_count = std::max(arg_count, candidate->arg_count);
+
+    Arguments arguments{raw, arg_count};
+
+    bool invoked = false;
+    for (const auto& candidate : candidates)
+    {
+        if (matches(*candidate, raw, arguments))
+        {
+            candidate->handler(msg);
+            invoked = true;
+        }
+    }
+
+    return invoked;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_MATCH_RULE_P_H_
+#define CORE_DBUS_MATCH_RULE_P_H_
+
+#include <core/dbus/match_rule.h>
+
+#include <string>
+
+namespace core
+{
+namespace dbus
+{
+struct MatchRule::Private
+{
+    Message::Type type = Message::Type::invalid;
+    std::string sender;
+    std::string destination;
+    std::string interface;
+    std::string member;
+    types::ObjectPath path;
+    std::string path_namespace;
+    MatchRule::MatchArgs args;
+    MatchRule::MatchArgs arg_paths;
+    std::string arg0_namespace;
+    bool eavesdrop = false;
+};
+}
+}
+
+#endif // CORE_DBUS_MATCH_RULE_P_H_
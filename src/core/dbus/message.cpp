@@ -29,6 +29,7 @@
 #include <dbus/dbus.h>
 
 #include <exception>
+#include <limits>
 #include <map>
 #include <memory>
 #include <ostream>
@@ -218,6 +219,11 @@ types::UnixFd Message::Reader::pop_unix_fd()
     return types::UnixFd(result);
 }
 
+types::UniqueFd Message::Reader::pop_unique_fd()
+{
+    return types::UniqueFd{pop_unix_fd().to_int()};
+}
+
 Message::Reader Message::Reader::pop_array()
 {
     Reader result(d->msg);
@@ -248,6 +254,26 @@ Message::Reader Message::Reader::pop_variant()
     return result;
 }
 
+ArgumentType Message::Reader::pop_basic_variant(DBusBasicValue& value)
+{
+    d->ensure_argument_type_or_throw(ArgumentType::variant);
+
+    DBusMessageIter sub;
+    dbus_message_iter_recurse(
+                std::addressof(d->iter),
+                std::addressof(sub));
+
+    auto type = dbus_message_iter_get_arg_type(std::addressof(sub));
+    if (!dbus_type_is_basic(type) || type == DBUS_TYPE_UNIX_FD)
+        return ArgumentType::invalid;
+
+    dbus_message_iter_get_basic(
+                std::addressof(sub),
+                std::addressof(value));
+    dbus_message_iter_next(std::addressof(d->iter));
+    return static_cast<ArgumentType>(type);
+}
+
 Message::Reader Message::Reader::pop_dict_entry()
 {
     Reader result(d->msg);
@@ -409,13 +435,24 @@ void Message::Writer::push_unix_fd(const types::UnixFd& value)
         throw std::runtime_error("Not enough memory to append data to message.");
 }
 
+void Message::Writer::push_unique_fd(types::UniqueFd value)
+{
+    // libdbus always duplicates, value closes our copy once we return.
+    push_unix_fd(value.to_unix_fd());
+}
+
 Message::Writer Message::Writer::open_array(const types::Signature& signature)
+{
+    return open_array(signature.as_string().c_str());
+}
+
+Message::Writer Message::Writer::open_array(const char* signature)
 {
     Writer w(d->msg);
     if (!dbus_message_iter_open_container(
                 std::addressof(d->iter),
                 static_cast<int>(ArgumentType::array),
-                signature.as_string().c_str(),
+                signature,
                 std::addressof(w.d->iter)))
         throw std::runtime_error("Problem opening container");
 
@@ -450,6 +487,11 @@ void Message::Writer::close_structure(Message::Writer w)
 }
 
 Message::Writer Message::Writer::open_variant(const types::Signature& signature)
+{
+    return open_variant(signature.as_string().c_str());
+}
+
+Message::Writer Message::Writer::open_variant(const char* signature)
 {
     // TODO(tvoss): We really should check that the signature refers to a
     // single complete type here.
@@ -458,7 +500,7 @@ Message::Writer Message::Writer::open_variant(const types::Signature& signature)
     if (!dbus_message_iter_open_container(
                 std::addressof(d->iter),
                 static_cast<int>(ArgumentType::variant),
-                signature.as_string().c_str(),
+                signature,
                 std::addressof(w.d->iter)))
         throw std::runtime_error("Problem opening container");
 
@@ -472,6 +514,34 @@ void Message::Writer::close_variant(Writer w)
                 std::addressof(w.d->iter));
 }
 
+void Message::Writer::push_basic_variant(ArgumentType type, const DBusBasicValue& value)
+{
+    const char signature[] = {static_cast<char>(type), '\0'};
+
+    DBusMessageIter sub;
+    if (!dbus_message_iter_open_container(
+                std::addressof(d->iter),
+                static_cast<int>(ArgumentType::variant),
+                signature,
+                std::addressof(sub)))
+        throw std::runtime_error("Problem opening container");
+
+    if (!dbus_message_iter_append_basic(
+                std::addressof(sub),
+                static_cast<int>(type),
+                std::addressof(value)))
+    {
+        dbus_message_iter_abandon_container(
+                    std::addressof(d->iter),
+                    std::addressof(sub));
+        throw std::runtime_error("Not enough memory to append data to message.");
+    }
+
+    dbus_message_iter_close_container(
+                std::addressof(d->iter),
+                std::addressof(sub));
+}
+
 Message::Writer Message::Writer::open_dict_entry()
 {
     Writer w(d->msg);
@@ -511,12 +581,13 @@ std::shared_ptr<Message> Message::make_method_call(
 
 std::shared_ptr<Message> Message::make_method_return(const Message::Ptr& msg)
 {
+    auto reply = dbus_message_new_method_return(msg->d->dbus_message.get());
+    Message::Private::inherit_local_call_mark(msg->d->dbus_message.get(), reply);
+
     return std::shared_ptr<Message>(
                 new Message(
                     std::unique_ptr<Message::Private>(
-                        new Message::Private(
-                            dbus_message_new_method_return(
-                                msg->d->dbus_message.get())))));
+                        new Message::Private(reply))));
 }
 
 std::shared_ptr<Message> Message::make_signal(
@@ -539,14 +610,16 @@ std::shared_ptr<Message> Message::make_error(
         const std::string& error_name,
         const std::string& error_desc)
 {
+    auto reply = dbus_message_new_error(
+                in_reply_to->d->dbus_message.get(),
+                error_name.c_str(),
+                error_desc.c_str());
+    Message::Private::inherit_local_call_mark(in_reply_to->d->dbus_message.get(), reply);
+
     return std::shared_ptr<Message>(
                 new Message(
                     std::unique_ptr<Message::Private>(
-                        new Message::Private(
-                            dbus_message_new_error(
-                                in_reply_to->d->dbus_message.get(),
-                                error_name.c_str(),
-                                error_desc.c_str())))));
+                        new Message::Private(reply))));
 }
 
 std::shared_ptr<Message> Message::from_raw_message(DBusMessage* msg)
@@ -558,6 +631,26 @@ std::shared_ptr<Message> Message::from_raw_message(DBusMessage* msg)
                             msg, true))));
 }
 
+std::shared_ptr<Message> Message::deserialize(const void* data, std::size_t size)
+{
+    if (size > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+        throw std::runtime_error("Serialized message exceeds the maximum message size.");
+
+    Error error;
+    auto msg = dbus_message_demarshal(
+                static_cast<const char*>(data),
+                static_cast<int>(size),
+                std::addressof(error.raw()));
+
+    if (!msg)
+        throw std::runtime_error(error.print());
+
+    return std::shared_ptr<Message>(
+                new Message(
+                    std::unique_ptr<Message::Private>(
+                        new Message::Private(msg))));
+}
+
 Message::Type Message::type() const
 {
     return static_cast<Type>(dbus_message_get_type(d->dbus_message.get()));
@@ -648,6 +741,35 @@ Message::~Message()
 {
 }
 
+std::vector<std::uint8_t> Message::serialize() const
+{
+    if (dbus_message_contains_unix_fds(d->dbus_message.get()))
+        throw std::runtime_error("Cannot serialize a message carrying unix fds.");
+
+    auto msg = d->dbus_message;
+
+    // libdbus refuses to restore a message without serial. We hand a
+    // placeholder to a copy instead of touching a message that is still being built.
+    if (dbus_message_get_serial(msg.get()) == 0)
+    {
+        msg = Private(dbus_message_copy(msg.get())).dbus_message;
+        if (!msg)
+            throw std::runtime_error("Not enough memory to serialize message.");
+        dbus_message_set_serial(msg.get(), 1);
+    }
+
+    char* buffer = nullptr;
+    int size = 0;
+
+    if (!dbus_message_marshal(msg.get(), std::addressof(buffer), std::addressof(size)))
+        throw std::runtime_error("Not enough memory to serialize message.");
+
+    std::vector<std::uint8_t> result(buffer, buffer + size);
+    dbus_free(buffer);
+
+    return result;
+}
+
 std::shared_ptr<Message> Message::clone()
 {
     return std::shared_ptr<Message>(new Message(d->clone()));
@@ -0,0 +1,208 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/message_log.h>
+
+#include <dbus/dbus.h>
+
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+const char magic[8] = {'D', 'B', 'U', 'S', 'C', 'P', 'P', 'L'};
+
+struct FileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+};
+
+struct EntryHeader
+{
+    std::uint64_t timestamp;
+    std::uint32_t tag;
+    std::uint32_t size;
+};
+
+static_assert(sizeof(FileHeader) == 16, "FileHeader must not contain padding.");
+static_assert(sizeof(EntryHeader) == 16, "EntryHeader must not contain padding.");
+
+bool is_valid(const FileHeader& header)
+{
+    return std::memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+           header.version == core::dbus::MessageLog::version;
+}
+}
+
+namespace core
+{
+namespace dbus
+{
+constexpr std::uint32_t MessageLog::version;
+
+struct MessageLog::Writer::Private
+{
+    std::mutex guard;
+    std::ofstream out;
+};
+
+MessageLog::Writer::Writer(const std::string& path) : d(new Private())
+{
+    bool empty = true;
+
+    // Validate an existing log before appending to it, and drop a torn
+    // entry left behind by a writer that did not finish it. Entries
+    // appended after it would never be reached by a Reader otherwise.
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (in.is_open() && in.tellg() > 0)
+        {
+            empty = false;
+
+            auto size = static_cast<std::uint64_t>(in.tellg());
+
+            FileHeader header;
+            in.seekg(0);
+            if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !is_valid(header))
+                throw Errors::NotAMessageLog{};
+
+            std::uint64_t end = sizeof(header);
+            EntryHeader entry;
+            while (in.read(reinterpret_cast<char*>(&entry), sizeof(entry)))
+            {
+                if (entry.size > DBUS_MAXIMUM_MESSAGE_LENGTH)
+                    throw std::runtime_error("Entry of message log " + path + " exceeds the maximum message size.");
+
+                if (end + sizeof(entry) + entry.size > size)
+                    break;
+
+                end += sizeof(entry) + entry.size;
+                in.seekg(static_cast<std::streamoff>(end));
+            }
+
+            in.close();
+
+            if (end < size && ::truncate(path.c_str(), static_cast<off_t>(end)) == -1)
+                throw std::runtime_error("Could not drop the incomplete last entry of message log " + path + ".");
+        }
+    }
+
+    d->out.open(path, std::ios::binary | std::ios::app);
+    if (!d->out.is_open())
+        throw std::runtime_error("Could not open message log " + path + " for appending.");
+
+    if (empty)
+    {
+        FileHeader header;
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.reserved = 0;
+
+        if (!d->out.write(reinterpret_cast<const char*>(&header), sizeof(header)))
+            throw std::runtime_error("Could not write header of message log " + path + ".");
+    }
+}
+
+MessageLog::Writer::~Writer()
+{
+}
+
+void MessageLog::Writer::append(const Message::Ptr& msg, std::uint32_t tag)
+{
+    append(
+        msg,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()),
+        tag);
+}
+
+void MessageLog::Writer::append(
+        const Message::Ptr& msg,
+        const std::chrono::nanoseconds& timestamp,
+        std::uint32_t tag)
+{
+    if (!msg)
+        throw std::runtime_error("Precondition violated, cannot append null message.");
+
+    auto bytes = msg->serialize();
+
+    EntryHeader header;
+    header.timestamp = static_cast<std::uint64_t>(timestamp.count());
+    header.tag = tag;
+    header.size = static_cast<std::uint32_t>(bytes.size());
+
+    std::lock_guard<std::mutex> lg(d->guard);
+    d->out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    d->out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+    if (!d->out)
+        throw std::runtime_error("Could not append message to message log.");
+}
+
+void MessageLog::Writer::flush()
+{
+    std::lock_guard<std::mutex> lg(d->guard);
+    d->out.flush();
+}
+
+struct MessageLog::Reader::Private
+{
+    std::ifstream in;
+    std::vector<char> buffer;
+};
+
+MessageLog::Reader::Reader(const std::string& path) : d(new Private())
+{
+    d->in.open(path, std::ios::binary);
+    if (!d->in.is_open())
+        throw std::runtime_error("Could not open message log " + path + " for reading.");
+
+    FileHeader header;
+    if (!d->in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !is_valid(header))
+        throw Errors::NotAMessageLog{};
+}
+
+MessageLog::Reader::~Reader()
+{
+}
+
+bool MessageLog::Reader::next(Entry& entry)
+{
+    EntryHeader header;
+    if (!d->in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+
+    if (header.size > DBUS_MAXIMUM_MESSAGE_LENGTH)
+        throw std::runtime_error("Entry of message log exceeds the maximum message size.");
+
+    d->buffer.resize(header.size);
+    if (!d->in.read(d->buffer.data(), d->buffer.size()))
+        return false;
+
+    entry.timestamp = std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(header.timestamp));
+    entry.tag = header.tag;
+    entry.message = Message::deserialize(d->buffer.data(), d->buffer.size());
+
+    return true;
+}
+}
+}
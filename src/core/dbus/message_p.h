@@ -21,6 +21,7 @@
 #include <core/dbus/message.h>
 
 #include <cstring>
+#include <new>
 #include <sstream>
 
 namespace core
@@ -89,6 +90,32 @@ struct Message::Private
                         dbus_message_copy(dbus_message.get())));
     }
 
+    // libdbus data slot marking method calls a bus dispatched in-process,
+    // carrying the address of the bus' bookkeeping. Replies created for a
+    // marked call inherit the mark, which tells them apart from replies to
+    // calls that went through the daemon, even if their serials collide.
+    static dbus_int32_t local_call_slot()
+    {
+        static const dbus_int32_t slot = []()
+        {
+            dbus_int32_t result = -1;
+            if (!dbus_message_allocate_data_slot(std::addressof(result)))
+                throw std::bad_alloc();
+            return result;
+        }();
+
+        return slot;
+    }
+
+    static void inherit_local_call_mark(DBusMessage* call, DBusMessage* reply)
+    {
+        if (!reply)
+            return;
+
+        if (auto mark = dbus_message_get_data(call, local_call_slot()))
+            dbus_message_set_data(reply, local_call_slot(), mark, nullptr);
+    }
+
     std::shared_ptr<DBusMessage> dbus_message;
 };
 }
@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORE_DBUS_NAME_OWNER_CHANGED_H_
+#define CORE_DBUS_NAME_OWNER_CHANGED_H_
+
+#include <core/dbus/dbus.h>
+#include <core/dbus/match_rule.h>
+#include <core/dbus/message.h>
+
+#include <string>
+
+namespace core
+{
+namespace dbus
+{
+namespace impl
+{
+// The arguments of the NameOwnerChanged signal emitted by the daemon.
+struct NameOwnerChanged
+{
+    // Selects the signal, shared by all subscribers on a connection.
+    static MatchRule rule()
+    {
+        return MatchRule()
+                .type(Message::Type::signal)
+                .sender(DBus::name())
+                .interface(DBus::interface())
+                .member("NameOwnerChanged")
+                .path(DBus::path());
+    }
+
+    // Unpacks msg, returns false if it has not been emitted by the daemon.
+    bool unpack(const Message::Ptr& msg)
+    {
+        // Peers cannot send messages on behalf of the daemon, but other
+        // rules might deliver look-alikes emitted by peers.
+        if (msg->sender() != DBus::name() || msg->signature() != "sss")
+            return false;
+
+        auto reader = msg->reader();
+        name = reader.pop_string();
+        old_owner = reader.pop_string();
+        new_owner = reader.pop_string();
+
+        return true;
+    }
+
+    std::string name;
+    std::string old_owner;
+    std::string new_owner;
+};
+}
+}
+}
+
+#endif // CORE_DBUS_NAME_OWNER_CHANGED_H_
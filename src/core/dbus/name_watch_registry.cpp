@@ -0,0 +1,181 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/name_watch_registry.h>
+
+#include <core/dbus/bus.h>
+#include <core/dbus/dbus.h>
+#include <core/dbus/match_rule.h>
+#include <core/dbus/match_rule_index.h>
+
+#include "name_owner_changed.h"
+
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace dbus = core::dbus;
+
+struct dbus::NameWatchRegistry::Private
+{
+    Private(Bus& bus) : bus(bus), rule(impl::NameOwnerChanged::rule())
+    {
+    }
+
+    void on_name_owner_changed(const Message::Ptr& msg)
+    {
+        impl::NameOwnerChanged args;
+        if (!args.unpack(msg))
+            return;
+
+        std::vector<Handler> handlers;
+
+        {
+            std::lock_guard<std::mutex> lg(guard);
+
+            auto it = watches.find(args.name);
+            if (it == watches.end())
+                return;
+
+            for (const auto& pair : it->second)
+                handlers.push_back(pair.second);
+        }
+
+        // Handlers are invoked without holding the lock so that they can
+        // modify the registry.
+        for (const Handler& handler : handlers)
+            handler(args.old_owner, args.new_owner);
+    }
+
+    Bus& bus;
+    MatchRule rule;
+
+    mutable std::mutex guard;
+    Token next_token = 0;
+    // Watches keyed by name, and the names of watches keyed by token.
+    std::unordered_map<std::string, std::map<Token, Handler>> watches;
+    std::unordered_map<Token, std::string> names;
+    // Set while the rule is installed, valid as long as at least one watch is installed.
+    bool installed = false;
+    MatchRuleIndex::Token index_token = 0;
+    // Set while a thread installs or removes the rule without holding the
+    // lock, which would stall the dispatch of signals to all watches.
+    bool pending = false;
+    std::condition_variable pending_changed;
+};
+
+dbus::NameWatchRegistry::NameWatchRegistry(Bus& bus) : d(new Private(bus))
+{
+}
+
+dbus::NameWatchRegistry::~NameWatchRegistry()
+{
+}
+
+dbus::NameWatchRegistry::Token dbus::NameWatchRegistry::watch(const std::string& name, const Handler& handler)
+{
+    std::unique_lock<std::mutex> ul(d->guard);
+    d->pending_changed.wait(ul, [this]() { return !d->pending; });
+
+    if (!d->installed)
+    {
+        d->pending = true;
+        ul.unlock();
+
+        std::weak_ptr<Private> wp{d};
+        auto index_token = d->bus.access_match_rule_index().install(d->rule, [wp](const Message::Ptr& msg)
+        {
+            if (auto sp = wp.lock())
+                sp->on_name_owner_changed(msg);
+        });
+
+        std::exception_ptr error;
+        try
+        {
+            d->bus.add_match(d->rule);
+        }
+        catch (...)
+        {
+            d->bus.access_match_rule_index().uninstall(index_token);
+            error = std::current_exception();
+        }
+
+        ul.lock();
+        d->pending = false;
+        d->installed = !error;
+        d->index_token = index_token;
+        d->pending_changed.notify_all();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    auto token = d->next_token++;
+    d->watches[name].insert(std::make_pair(token, handler));
+    d->names.insert(std::make_pair(token, name));
+
+    return token;
+}
+
+void dbus::NameWatchRegistry::unwatch(Token token)
+{
+    std::unique_lock<std::mutex> ul(d->guard);
+
+    auto it = d->names.find(token);
+    if (it == d->names.end())
+        return;
+
+    auto jt = d->watches.find(it->second);
+    jt->second.erase(token);
+    if (jt->second.empty())
+        d->watches.erase(jt);
+
+    d->names.erase(it);
+
+    if (!d->names.empty())
+        return;
+
+    // Watches are only added once the rule is installed, i.e., no other
+    // thread is installing or removing it while watches exist.
+    d->installed = false;
+    d->pending = true;
+    ul.unlock();
+
+    d->bus.access_match_rule_index().uninstall(d->index_token);
+
+    try
+    {
+        d->bus.remove_match(d->rule);
+    }
+    catch (...)
+    {
+        // Intentionally left empty as there is hardly anything we
+        // can do about the match rule not being removed.
+    }
+
+    ul.lock();
+    d->pending = false;
+    d->pending_changed.notify_all();
+}
+
+std::size_t dbus::NameWatchRegistry::size() const
+{
+    std::lock_guard<std::mutex> lg(d->guard);
+    return d->names.size();
+}
@@ -24,6 +24,7 @@
 
 #include <dbus/dbus.h>
 
+#include <functional>
 #include <mutex>
 
 namespace
@@ -106,6 +107,12 @@ private:
         if (state.exchange(State::completed) == State::completed)
             return;
 
+        if (on_completed)
+            on_completed();
+
+        if (on_reply)
+            on_reply(msg);
+
         message = msg;
 
         if (callback)
@@ -114,12 +121,18 @@ private:
 
 public:
     // Creates a new PendingCall instance given the opaque call instance
-    // handed out by libdbus. Throws in case of errors.
-    inline static core::dbus::PendingCall::Ptr create(DBusPendingCall* call)
+    // handed out by libdbus. The optional on_completed is invoked exactly
+    // once, when the call either completes or is cancelled. The optional
+    // on_reply is handed the reply, before any callback. Throws in case
+    // of errors.
+    inline static core::dbus::PendingCall::Ptr create(
+            DBusPendingCall* call,
+            const std::function<void()>& on_completed = std::function<void()>{},
+            const std::function<void(const Message::Ptr&)>& on_reply = std::function<void(const Message::Ptr&)>{})
     {
         auto result = std::shared_ptr<core::dbus::impl::PendingCall>
         {
-            new core::dbus::impl::PendingCall{call}
+            new core::dbus::impl::PendingCall{call, on_completed, on_reply}
         };
 
         // Our scope contains two objects that are dynamically created:
@@ -179,6 +192,11 @@ public:
     void cancel() override
     {
         dbus_pending_call_cancel(pending_call);
+
+        // A cancelled call never completes.
+        std::lock_guard<std::mutex> lg(guard);
+        if (state.exchange(State::completed) == State::pending && on_completed)
+            on_completed();
     }
 
     // Installs a continuation and invokes it if the call already completed.
@@ -193,8 +211,11 @@ public:
     }
 
 private:
-    PendingCall(DBusPendingCall* call)
-        : state(State::pending), pending_call(call)
+    PendingCall(
+            DBusPendingCall* call,
+            const std::function<void()>& on_completed,
+            const std::function<void(const Message::Ptr&)>& on_reply)
+        : state(State::pending), pending_call(call), on_completed(on_completed), on_reply(on_reply)
     {
         if (not call) throw std::runtime_error
         {
@@ -206,6 +227,10 @@ private:
     std::atomic<State> state;
     // Our pending call instance.
     DBusPendingCall* pending_call;
+    // Invoked once the call either completed or has been cancelled.
+    std::function<void()> on_completed;
+    // Invoked with the reply, if any.
+    std::function<void(const Message::Ptr&)> on_reply;
     // We synchronize access to the following two members.
     std::mutex guard;
     // The reply message.
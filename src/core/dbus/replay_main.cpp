@@ -0,0 +1,403 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/bus.h>
+#include <core/dbus/error.h>
+#include <core/dbus/message.h>
+#include <core/dbus/message_log.h>
+
+#include <core/dbus/asio/executor.h>
+
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include <dbus/dbus.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dbus = core::dbus;
+
+namespace
+{
+struct CommandLineOptions
+{
+    static const char* key_help() { return "help"; }
+    static const char* key_capture() { return "capture"; }
+    static const char* key_bus() { return "bus"; }
+    static const char* key_rate() { return "rate"; }
+    static const char* key_direction() { return "direction"; }
+    static const char* key_timeout() { return "timeout"; }
+    static const char* key_destination() { return "destination"; }
+
+    CommandLineOptions() : allowed_options("Allowed options")
+    {
+        allowed_options.add_options()
+                (CommandLineOptions::key_help(),
+                 "Print this help message")
+                (CommandLineOptions::key_capture(),
+                 boost::program_options::value<std::string>(),
+                 "Capture recorded by core::dbus::Bus::capture_to")
+                (CommandLineOptions::key_bus(),
+                 boost::program_options::value<std::string>()->default_value("session"),
+                 "Bus to replay on: session, system or an address")
+                (CommandLineOptions::key_rate(),
+                 boost::program_options::value<std::string>()->default_value("1x"),
+                 "Replay rate relative to the capture, e.g. 1x or 10x, or max for no delays at all")
+                (CommandLineOptions::key_direction(),
+                 boost::program_options::value<std::string>()->default_value("outgoing"),
+                 "Replays method calls the capturing connection sent (outgoing) or received (incoming)")
+                (CommandLineOptions::key_timeout(),
+                 boost::program_options::value<unsigned int>()->default_value(5000),
+                 "Timeout for individual calls in [ms]")
+                (CommandLineOptions::key_destination(),
+                 boost::program_options::value<std::string>(),
+                 "Name to address all replayed calls to instead of their captured destination");
+        positional_options.add(CommandLineOptions::key_capture(), 1);
+    }
+
+    bool parse(int argc, const char* argv[])
+    {
+        try
+        {
+            boost::program_options::variables_map vm;
+
+            boost::program_options::store(
+                        boost::program_options::command_line_parser(
+                            argc,
+                            argv).options(allowed_options).positional(positional_options).run(), vm);
+            boost::program_options::notify(vm);
+
+            help = vm.count(CommandLineOptions::key_help()) > 0;
+            if (help)
+                return true;
+
+            capture = vm[CommandLineOptions::key_capture()].as<std::string>();
+            bus = vm[CommandLineOptions::key_bus()].as<std::string>();
+            timeout = std::chrono::milliseconds{vm[CommandLineOptions::key_timeout()].as<unsigned int>()};
+
+            if (vm.count(CommandLineOptions::key_destination()) > 0)
+            {
+                destination = vm[CommandLineOptions::key_destination()].as<std::string>();
+                if (!dbus_validate_bus_name(destination.c_str(), nullptr))
+                    return false;
+            }
+
+            auto r = vm[CommandLineOptions::key_rate()].as<std::string>();
+            if (r == "max")
+            {
+                rate = 0.;
+            } else
+            {
+                if (!r.empty() && r.back() == 'x')
+                    r.pop_back();
+                rate = std::stod(r);
+                if (!(rate > 0.))
+                    return false;
+            }
+
+            auto d = vm[CommandLineOptions::key_direction()].as<std::string>();
+            if (d == "outgoing")
+                direction = dbus::Bus::CaptureDirection::outgoing;
+            else if (d == "incoming")
+                direction = dbus::Bus::CaptureDirection::incoming;
+            else
+                return false;
+        } catch(...)
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string usage() const
+    {
+        std::stringstream ss;
+        ss << "Usage: dbus-cpp-replay [options] capture" << std::endl << allowed_options;
+        return ss.str();
+    }
+
+    boost::program_options::options_description allowed_options;
+    boost::program_options::positional_options_description positional_options;
+
+    bool help = false;
+    std::string capture;
+    std::string bus;
+    // 0 replays as fast as possible.
+    double rate = 1.;
+    dbus::Bus::CaptureDirection direction = dbus::Bus::CaptureDirection::outgoing;
+    std::chrono::milliseconds timeout{5000};
+    // Empty keeps the captured destinations.
+    std::string destination;
+};
+
+dbus::Bus::Ptr connect(const std::string& bus)
+{
+    if (bus == "session")
+        return std::make_shared<dbus::Bus>(dbus::WellKnownBus::session);
+    if (bus == "system")
+        return std::make_shared<dbus::Bus>(dbus::WellKnownBus::system);
+
+    return std::make_shared<dbus::Bus>(bus);
+}
+
+// Copies a captured call, addressing the copy to destination. Message
+// lacks a setter for the destination, we go through libdbus instead.
+dbus::Message::Ptr readdress(const dbus::Message::Ptr& msg, const std::string& destination)
+{
+    auto bytes = msg->serialize();
+
+    dbus::Error error;
+    auto raw = dbus_message_demarshal(
+                reinterpret_cast<const char*>(bytes.data()),
+                static_cast<int>(bytes.size()),
+                std::addressof(error.raw()));
+
+    if (!raw)
+        throw std::runtime_error(error.print());
+
+    // The copy carries no serial, just like Message::clone.
+    auto copy = dbus_message_copy(raw);
+    dbus_message_unref(raw);
+
+    if (!copy || !dbus_message_set_destination(copy, destination.c_str()))
+    {
+        if (copy)
+            dbus_message_unref(copy);
+        throw std::runtime_error("Could not readdress call, out of memory.");
+    }
+
+    auto result = dbus::Message::from_raw_message(copy);
+    dbus_message_unref(copy);
+
+    return result;
+}
+
+// Collects the outcome of all replayed calls.
+struct Statistics
+{
+    // Accounts for the reply to a call sent at the given point in time.
+    void on_reply(const dbus::Message::Ptr& reply, std::chrono::steady_clock::time_point sent)
+    {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - sent);
+
+        bool failed = reply->type() == dbus::Message::Type::error;
+        bool timed_out = failed && reply->error().name() == DBUS_ERROR_NO_REPLY;
+
+        std::lock_guard<std::mutex> lg(guard);
+
+        // Timed out calls would only tell us about the timeout.
+        if (timed_out)
+            timeouts++;
+        else
+            latencies.push_back(latency);
+
+        if (failed && !timed_out)
+            errors++;
+
+        completed++;
+        cv.notify_all();
+    }
+
+    // Waits for count calls to complete, returns false if we gave up waiting.
+    bool wait_for(std::size_t count, const std::chrono::milliseconds& timeout)
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        return cv.wait_for(ul, timeout, [this, count]() { return completed >= count; });
+    }
+
+    std::chrono::microseconds percentile(double p)
+    {
+        if (latencies.empty())
+            return std::chrono::microseconds{0};
+
+        auto index = static_cast<std::size_t>(std::ceil(p * latencies.size()));
+        return latencies[std::min(std::max<std::size_t>(index, 1), latencies.size()) - 1];
+    }
+
+    std::mutex guard;
+    std::condition_variable cv;
+    std::vector<std::chrono::microseconds> latencies;
+    std::size_t completed = 0;
+    std::size_t errors = 0;
+    std::size_t timeouts = 0;
+};
+}
+
+int main(int argc, const char* argv[])
+{
+    CommandLineOptions cli_options;
+
+    if (!cli_options.parse(argc, argv))
+    {
+        std::cout << "Could not parse command line arguments, aborting now." << std::endl;
+        std::cout << cli_options.usage() << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    if (cli_options.help)
+    {
+        std::cout << cli_options.usage() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<dbus::MessageLog::Entry> calls;
+    std::size_t skipped = 0;
+
+    try
+    {
+        dbus::MessageLog::Reader reader{cli_options.capture};
+        dbus::MessageLog::Entry entry;
+
+        while (reader.next(entry))
+        {
+            if (entry.message->type() == dbus::Message::Type::method_call &&
+                entry.tag == static_cast<std::uint32_t>(cli_options.direction))
+                calls.push_back(entry);
+            else
+                skipped++;
+        }
+    } catch (const std::exception& e)
+    {
+        std::cout << "Could not read capture " << cli_options.capture << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (calls.empty())
+    {
+        std::cout << "Capture " << cli_options.capture << " does not contain any method calls to replay." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Unique names are handed out per connection and never reused, the
+    // ones in a capture are gone by now. That is the rule rather than the
+    // exception for incoming calls, which are addressed to the capturing
+    // connection itself.
+    if (cli_options.destination.empty())
+    {
+        auto it = std::find_if(calls.begin(), calls.end(), [](const dbus::MessageLog::Entry& call)
+        {
+            auto destination = call.message->destination();
+            return !destination.empty() && destination[0] == ':';
+        });
+
+        if (it != calls.end())
+        {
+            std::cout << "Capture " << cli_options.capture << " contains calls addressed to the unique name "
+                      << it->message->destination() << ", which is no longer valid. "
+                      << "Pass --" << CommandLineOptions::key_destination()
+                      << " to address the calls to a name of your choice." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    dbus::Bus::Ptr bus;
+    try
+    {
+        bus = connect(cli_options.bus);
+    } catch (const std::exception& e)
+    {
+        std::cout << "Could not connect to bus " << cli_options.bus << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    boost::asio::io_service io_service;
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    std::thread worker{[bus]() { bus->run(); }};
+
+    // Shared with the callbacks, which might fire while tearing down the connection.
+    auto statistics = std::make_shared<Statistics>();
+
+    // Concurrent writers do not append in timestamp order, and offsets must
+    // not go negative. The sort is stable to keep the order of ties.
+    std::stable_sort(calls.begin(), calls.end(), [](const dbus::MessageLog::Entry& lhs, const dbus::MessageLog::Entry& rhs)
+    {
+        return lhs.timestamp < rhs.timestamp;
+    });
+
+    auto first = calls.front().timestamp;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& call : calls)
+    {
+        if (cli_options.rate > 0.)
+        {
+            auto offset = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double, std::nano>((call.timestamp - first).count() / cli_options.rate));
+            std::this_thread::sleep_until(start + offset);
+        }
+
+        // Captured calls carry their original serial, a copy gets a fresh one.
+        auto msg = cli_options.destination.empty() ?
+                    call.message->clone() :
+                    readdress(call.message, cli_options.destination);
+        auto sent = std::chrono::steady_clock::now();
+
+        try
+        {
+            bus->send_with_reply_and_timeout(msg, cli_options.timeout)->then([statistics, sent](const dbus::Message::Ptr& reply)
+            {
+                statistics->on_reply(reply, sent);
+            });
+        } catch (const std::exception& e)
+        {
+            std::cout << "Could not replay call to " << msg->interface() << "." << msg->member() << ": " << e.what() << std::endl;
+            bus->stop();
+            worker.join();
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool all_completed = statistics->wait_for(calls.size(), cli_options.timeout + std::chrono::seconds{1});
+    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start);
+
+    bus->stop();
+    if (worker.joinable())
+        worker.join();
+
+    std::lock_guard<std::mutex> lg(statistics->guard);
+    std::sort(statistics->latencies.begin(), statistics->latencies.end());
+
+    std::cout << "Replayed " << calls.size() << " calls in " << std::fixed << std::setprecision(3)
+              << elapsed.count() << " [s], " << std::setprecision(1) << calls.size() / elapsed.count()
+              << " [calls/s], skipped " << skipped << " other entries" << std::endl;
+    std::cout << "Errors: " << statistics->errors << ", timeouts: " << statistics->timeouts;
+    if (!all_completed)
+        std::cout << ", incomplete: " << calls.size() - statistics->completed;
+    std::cout << std::endl;
+
+    std::cout << "Latency -> p50: " << statistics->percentile(.5).count()
+              << " [µs], p90: " << statistics->percentile(.9).count()
+              << " [µs], p99: " << statistics->percentile(.99).count()
+              << " [µs], p99.9: " << statistics->percentile(.999).count()
+              << " [µs], max: " << statistics->percentile(1.).count() << " [µs]" << std::endl;
+
+    return all_completed && statistics->errors == 0 && statistics->timeouts == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/server.h>
+
+#include <core/dbus/error.h>
+
+#include <stdexcept>
+
+namespace core
+{
+namespace dbus
+{
+struct Server::Private
+{
+    static void on_new_connection(DBusServer*, DBusConnection* connection, void* data)
+    {
+        auto thiz = static_cast<Server*>(data);
+
+        // libdbus drops its reference once we return, the bus instance
+        // takes over the one we acquire here.
+        dbus_connection_ref(connection);
+
+        try
+        {
+            thiz->d->handler(thiz->adopt(connection));
+        }
+        catch (...)
+        {
+            // Unwinding through libdbus is not an option.
+            if (thiz->d->error_handler)
+                thiz->d->error_handler(std::current_exception());
+        }
+    }
+
+    DBusServer* server;
+    NewConnectionHandler handler;
+    ErrorHandler error_handler;
+    Executor::Ptr executor;
+};
+
+Server::Server(const std::string& address, const NewConnectionHandler& handler)
+    : d(new Private{nullptr, handler, ErrorHandler{}, Executor::Ptr{}})
+{
+    Error se;
+    d->server = dbus_server_listen(address.c_str(), std::addressof(se.raw()));
+
+    if (!d->server)
+        throw std::runtime_error(se.print());
+
+    dbus_server_set_new_connection_function(
+                d->server,
+                Private::on_new_connection,
+                this,
+                nullptr);
+}
+
+Server::~Server() noexcept
+{
+    dbus_server_disconnect(d->server);
+    dbus_server_unref(d->server);
+}
+
+std::string Server::address() const
+{
+    char* s = dbus_server_get_address(d->server);
+    std::string result{s};
+    dbus_free(s);
+    return result;
+}
+
+void Server::install_executor(const Executor::Ptr& e)
+{
+    d->executor = e;
+}
+
+void Server::install_error_handler(const ErrorHandler& handler)
+{
+    d->error_handler = handler;
+}
+
+void Server::stop()
+{
+    if (!d->executor)
+        throw std::runtime_error("Missing executor, cannot stop.");
+    d->executor->stop();
+}
+
+void Server::run()
+{
+    if (!d->executor)
+        throw std::runtime_error("Missing executor, cannot run.");
+    d->executor->run();
+}
+
+DBusServer* Server::raw() const
+{
+    return d->server;
+}
+
+Bus::Ptr Server::adopt(DBusConnection* connection)
+{
+    return Bus::Ptr{new Bus(connection, Bus::PeerToPeer{})};
+}
+}
+}
@@ -19,6 +19,7 @@
 #include <core/dbus/service.h>
 
 #include <core/dbus/bus.h>
+#include <core/dbus/bus_pool.h>
 #include <core/dbus/codec.h>
 #include <core/dbus/match_rule.h>
 #include <core/dbus/message_router.h>
@@ -45,6 +46,25 @@ namespace core
 {
 namespace dbus
 {
+std::future<Service::Ptr> Service::add_service_asynchronously(
+        const Bus::Ptr& connection,
+        const std::string& name,
+        const Bus::RequestNameFlag& flags)
+{
+    auto promise = std::make_shared<std::promise<Ptr>>();
+    auto future = promise->get_future();
+
+    connection->request_name_on_bus_asynchronously(name, flags, [promise, connection, name](const std::exception_ptr& error)
+    {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(Ptr(new Service(connection, name, NameAcquired{})));
+    });
+
+    return future;
+}
+
 Service::Ptr Service::use_service(const Bus::Ptr& connection, const std::string& name)
 {
     return Ptr(new Service(connection, name));
@@ -57,6 +77,13 @@ Service::Ptr Service::use_service_or_throw_if_not_available(const Bus::Ptr& conn
     return Ptr(new Service(connection, name));
 }
 
+Service::Ptr Service::use_service(const std::shared_ptr<BusPool>& pool, const std::string& name)
+{
+    Ptr service(new Service(pool->primary(), name));
+    service->pool = pool;
+    return service;
+}
+
 const std::string& Service::get_name() const
 {
     return name;
@@ -72,6 +99,11 @@ const Bus::Ptr& Service::get_connection() const
     return connection;
 }
 
+const Bus::Ptr& Service::connection_for_method_call(const types::ObjectPath& path) const
+{
+    return pool ? pool->connection_for_method_call(path) : connection;
+}
+
 void Service::add_match(const MatchRule& rule)
 {
     connection->add_match(rule.sender(name));
@@ -90,29 +122,21 @@ Service::Service(const Bus::Ptr& connection, const std::string& name)
 
 }
 
-Service::Service(const Bus::Ptr& connection, const std::string& name, const Bus::RequestNameFlag& flags)
+Service::Service(const Bus::Ptr& connection, const std::string& name, NameAcquired)
     : connection(connection),
       name(name),
       stub(false)
 {
-    Error error;
-    auto rc = dbus_bus_request_name(
-                connection->raw(),
-                name.c_str(),
-                static_cast<unsigned int>(flags),
-                std::addressof(error.raw()));
-
-    if (error)
-        throw std::runtime_error(error.name() + ": " + error.message());
+}
 
-    switch (rc)
-    {
-    case DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER: break;
-    case DBUS_REQUEST_NAME_REPLY_IN_QUEUE: break;
-    case DBUS_REQUEST_NAME_REPLY_EXISTS: throw Bus::Errors::AlreadyOwned{}; break;
-    case DBUS_REQUEST_NAME_REPLY_ALREADY_OWNER: throw Bus::Errors::AlreadyOwner{}; break;
-    case -1: throw std::runtime_error(error.print());
-    }
+Service::Service(const Bus::Ptr& connection, const std::string& name, const Bus::RequestNameFlag& flags)
+    : connection(connection),
+      name(name),
+      stub(false)
+{
+    // Throws if the name cannot be acquired. Direct connections to a
+    // peer acquire the name without any round trip.
+    connection->request_name_on_bus(name, flags);
 }
 
 const std::shared_ptr<Object>& Service::root_object()
@@ -135,5 +159,15 @@ std::shared_ptr<Object> Service::add_object_for_path(const types::ObjectPath& pa
 
     return object;
 }
+
+void Service::add_subtree_for_path(const types::ObjectPath& path, const Bus::SubtreeHandler& handler)
+{
+    connection->register_subtree_for_path(path, handler);
+}
+
+void Service::remove_subtree_for_path(const types::ObjectPath& path)
+{
+    connection->unregister_object_path(path);
+}
 }
 }
@@ -16,38 +16,38 @@
  * Authored by: Pete Woods <pete.woods@canonical.com>
  */
 
+#include <core/dbus/bus.h>
 #include <core/dbus/dbus.h>
-#include <core/dbus/match_rule.h>
-#include <core/dbus/object.h>
+#include <core/dbus/name_watch_registry.h>
 #include <core/dbus/service_watcher.h>
-#include <core/dbus/signal.h>
 
 namespace core
 {
 namespace dbus
 {
-
-namespace {
-struct NameOwnerChanged
+struct dbus::ServiceWatcher::Private
 {
-    static const std::string& name()
+    ~Private()
     {
-        static const std::string s { "NameOwnerChanged" };
-        return s;
+        if (watching)
+            bus->access_name_watch_registry().unwatch(token);
     }
 
-    typedef DBus Interface;
-    typedef std::tuple<std::string, std::string, std::string> ArgumentType;
-};
-}
-
-struct dbus::ServiceWatcher::Private
-{
-    void signal_handler(const NameOwnerChanged::ArgumentType& args)
+    void on_owner_changed(const std::string& old_owner, const std::string& new_owner)
     {
-        const std::string& old_owner(std::get<1>(args));
-        const std::string& new_owner(std::get<2>(args));
-
+        switch (watch_mode)
+        {
+        case DBus::WatchMode::owner_change:
+            break;
+        case DBus::WatchMode::registration:
+            if (!old_owner.empty())
+                return;
+            break;
+        case DBus::WatchMode::unregistration:
+            if (!new_owner.empty())
+                return;
+            break;
+        }
 
         if (old_owner.empty() && !new_owner.empty())
         {
@@ -65,35 +65,26 @@ struct dbus::ServiceWatcher::Private
     core::Signal<std::string, std::string> owner_changed;
     core::Signal<void> service_registered;
     core::Signal<void> service_unregistered;
-    std::shared_ptr<Object> object;
-    std::shared_ptr<
-            core::dbus::Signal<NameOwnerChanged, NameOwnerChanged::ArgumentType>> signal;
+    std::shared_ptr<Bus> bus;
+    DBus::WatchMode watch_mode;
+    NameWatchRegistry::Token token;
+    bool watching = false;
 };
 
-dbus::ServiceWatcher::ServiceWatcher(std::shared_ptr<Object> object,
+dbus::ServiceWatcher::ServiceWatcher(std::shared_ptr<Bus> bus,
         const std::string& name, DBus::WatchMode watch_mode) :
         d(new Private())
 {
-    d->object = object;
-
-    MatchRule::MatchArgs match_args{ { 0, name } };
+    d->bus = bus;
+    d->watch_mode = watch_mode;
 
-    switch (watch_mode)
+    std::weak_ptr<Private> wp{d};
+    d->token = d->bus->access_name_watch_registry().watch(name, [wp](const std::string& old_owner, const std::string& new_owner)
     {
-    case DBus::WatchMode::owner_change:
-        break;
-    case DBus::WatchMode::registration:
-        match_args.push_back({ 1, std::string() });
-        break;
-    case DBus::WatchMode::unregistration:
-        match_args.push_back({ 2, std::string() });
-        break;
-    }
-
-    d->signal = d->object->get_signal<NameOwnerChanged>();
-
-    d->signal->connect_with_match_args(
-            std::bind(&Private::signal_handler, d, std::placeholders::_1), match_args);
+        if (auto sp = wp.lock())
+            sp->on_owner_changed(old_owner, new_owner);
+    });
+    d->watching = true;
 }
 
 const core::Signal<std::string, std::string>& dbus::ServiceWatcher::owner_changed() const
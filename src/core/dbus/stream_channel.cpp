@@ -0,0 +1,302 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/stream_channel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The ring requires lock-free, and thus address-free, 64-bit atomics.");
+
+constexpr std::uint32_t magic = 0x64627363; // "dbsc"
+
+// Leads the shared memory, followed by capacity records. Producer and
+// consumer indices live on separate cache lines and grow monotonically,
+// their difference being the number of records in flight.
+struct Header
+{
+    std::uint32_t magic;
+    std::uint32_t record_size;
+    std::uint64_t capacity;
+
+    alignas(64) std::atomic<std::uint64_t> head;
+    alignas(64) std::atomic<std::uint64_t> tail;
+};
+
+// Seals a consumer relies on, the mapping must not vanish underneath it.
+// Writes cannot be sealed, the producer keeps writing to its mapping.
+constexpr int required_seals()
+{
+    return F_SEAL_SHRINK | F_SEAL_GROW;
+}
+
+constexpr std::size_t records_offset()
+{
+    return (sizeof(Header) + 63) & ~std::size_t{63};
+}
+
+std::system_error an_error_from_errno(const char* what)
+{
+    return std::system_error(errno, std::system_category(), what);
+}
+
+std::size_t next_power_of_two(std::size_t value)
+{
+    std::size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+}
+
+namespace core
+{
+namespace dbus
+{
+struct RawStreamChannel::Private
+{
+    Private(int memory, int event)
+        : memory(memory),
+          event(event),
+          header(nullptr),
+          records(nullptr),
+          size(0),
+          record_size(0),
+          capacity(0)
+    {
+    }
+
+    ~Private()
+    {
+        if (header)
+            ::munmap(header, size);
+        if (memory >= 0)
+            ::close(memory);
+        if (event >= 0)
+            ::close(event);
+    }
+
+    void map()
+    {
+        auto p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+        if (p == MAP_FAILED)
+            throw an_error_from_errno("Could not map stream channel");
+
+        header = static_cast<Header*>(p);
+        records = static_cast<std::uint8_t*>(p) + records_offset();
+    }
+
+    std::uint8_t* slot(std::uint64_t index)
+    {
+        return records + (index & (capacity - 1)) * record_size;
+    }
+
+    int memory;
+    int event;
+    Header* header;
+    std::uint8_t* records;
+    std::size_t size;
+    // Local copies, the shared header is not trusted after attaching.
+    std::size_t record_size;
+    std::size_t capacity;
+};
+
+RawStreamChannel::Ptr RawStreamChannel::create(std::size_t record_size, std::size_t capacity)
+{
+    if (record_size == 0 || record_size > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("Precondition violated: record size out of range.");
+
+    int memory = ::memfd_create("dbus-cpp-stream-channel", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memory == -1)
+        throw an_error_from_errno("Could not create memfd for stream channel");
+
+    int event = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event == -1)
+    {
+        auto error = an_error_from_errno("Could not create eventfd for stream channel");
+        ::close(memory);
+        throw error;
+    }
+
+    Ptr result(new RawStreamChannel());
+    result->d.reset(new Private(memory, event));
+    result->d->record_size = record_size;
+    result->d->capacity = next_power_of_two(std::max<std::size_t>(capacity, 1));
+    result->d->size = records_offset() + result->d->capacity * record_size;
+
+    if (::ftruncate(memory, result->d->size) == -1)
+        throw an_error_from_errno("Could not resize stream channel");
+
+    if (::fcntl(memory, F_ADD_SEALS, required_seals() | F_SEAL_SEAL) == -1)
+        throw an_error_from_errno("Could not seal stream channel");
+
+    result->d->map();
+
+    auto header = new (result->d->header) Header;
+    header->magic = magic;
+    header->record_size = static_cast<std::uint32_t>(record_size);
+    header->capacity = result->d->capacity;
+    header->head.store(0);
+    header->tail.store(0);
+
+    return result;
+}
+
+RawStreamChannel::Ptr RawStreamChannel::attach(
+        const types::UnixFd& memory,
+        const types::UnixFd& event,
+        std::size_t record_size)
+{
+    Ptr result(new RawStreamChannel());
+    result->d.reset(new Private(memory.to_int(), event.to_int()));
+
+    // Only a sealed size is safe to map, a shrinking memfd would fault us.
+    auto seals = ::fcntl(memory.to_int(), F_GET_SEALS);
+    if (seals == -1 || (seals & required_seals()) != required_seals())
+        throw Errors::NotSealed{};
+
+    struct stat st;
+    if (::fstat(memory.to_int(), &st) == -1)
+        throw an_error_from_errno("Could not query size of stream channel");
+
+    if (static_cast<std::size_t>(st.st_size) < records_offset())
+        throw Errors::IncompatibleLayout{};
+
+    result->d->size = static_cast<std::size_t>(st.st_size);
+    result->d->map();
+
+    auto header = result->d->header;
+    auto capacity = static_cast<std::size_t>(header->capacity);
+
+    if (record_size == 0 ||
+        header->magic != magic ||
+        header->record_size != record_size ||
+        capacity == 0 ||
+        (capacity & (capacity - 1)) != 0 ||
+        (result->d->size - records_offset()) / record_size < capacity)
+        throw Errors::IncompatibleLayout{};
+
+    result->d->record_size = record_size;
+    result->d->capacity = capacity;
+
+    return result;
+}
+
+RawStreamChannel::RawStreamChannel()
+{
+}
+
+RawStreamChannel::~RawStreamChannel()
+{
+}
+
+std::size_t RawStreamChannel::record_size() const
+{
+    return d->record_size;
+}
+
+std::size_t RawStreamChannel::capacity() const
+{
+    return d->capacity;
+}
+
+types::UnixFd RawStreamChannel::memory() const
+{
+    return types::UnixFd{d->memory};
+}
+
+types::UnixFd RawStreamChannel::event() const
+{
+    return types::UnixFd{d->event};
+}
+
+bool RawStreamChannel::try_push(const void* record)
+{
+    auto header = d->header;
+
+    auto head = header->head.load(std::memory_order_relaxed);
+    auto tail = header->tail.load(std::memory_order_acquire);
+
+    if (head - tail >= d->capacity)
+        return false;
+
+    std::memcpy(d->slot(head), record, d->record_size);
+    header->head.store(head + 1, std::memory_order_seq_cst);
+
+    // The consumer might only be waiting if it had caught up with us. It
+    // re-checks head after publishing its tail, so one of us always notices.
+    if (header->tail.load(std::memory_order_seq_cst) == head)
+    {
+        std::uint64_t one{1};
+        if (::write(d->event, &one, sizeof(one)) == -1 && errno != EAGAIN)
+            throw an_error_from_errno("Could not notify consumer of stream channel");
+    }
+
+    return true;
+}
+
+std::size_t RawStreamChannel::drain(const BatchHandler& handler)
+{
+    auto header = d->header;
+
+    // Resets the notification before looking at the ring, later pushes wake us up again.
+    std::uint64_t counter{0};
+    if (::read(d->event, &counter, sizeof(counter)) == -1 && errno != EAGAIN)
+        throw an_error_from_errno("Could not read notification of stream channel");
+
+    std::size_t consumed = 0;
+
+    while (true)
+    {
+        auto tail = header->tail.load(std::memory_order_relaxed);
+        auto head = header->head.load(std::memory_order_seq_cst);
+
+        // Clamping protects us from a misbehaving producer.
+        auto available = static_cast<std::size_t>(std::min<std::uint64_t>(head - tail, d->capacity));
+        if (available == 0)
+            break;
+
+        auto offset = static_cast<std::size_t>(tail & (d->capacity - 1));
+        auto first = std::min(available, d->capacity - offset);
+
+        if (handler)
+        {
+            handler(d->slot(tail), first);
+            if (first < available)
+                handler(d->slot(tail + first), available - first);
+        }
+
+        header->tail.store(tail + available, std::memory_order_seq_cst);
+        consumed += available;
+    }
+
+    return consumed;
+}
+}
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/types/shared_buffer.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+// Seals a receiver relies on, the mapping must neither change nor vanish.
+constexpr int required_seals()
+{
+    return F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+}
+
+std::system_error an_error_from_errno(const char* what)
+{
+    return std::system_error(errno, std::system_category(), what);
+}
+}
+
+namespace core
+{
+namespace dbus
+{
+namespace types
+{
+struct SharedBuffer::Private
+{
+    Private(int fd) : fd(fd), data(nullptr), size(0)
+    {
+    }
+
+    ~Private()
+    {
+        if (data)
+            ::munmap(data, size);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    // Maps the whole memfd read-only.
+    void map_read_only()
+    {
+        struct stat st;
+        if (::fstat(fd, &st) == -1)
+            throw an_error_from_errno("Could not query size of shared buffer");
+
+        size = static_cast<std::size_t>(st.st_size);
+        if (size == 0)
+            return;
+
+        auto p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            throw an_error_from_errno("Could not map shared buffer");
+
+        data = static_cast<std::uint8_t*>(p);
+    }
+
+    int fd;
+    std::uint8_t* data;
+    std::size_t size;
+};
+
+SharedBuffer SharedBuffer::create(std::size_t size, const Filler& fill)
+{
+    int fd = ::memfd_create("dbus-cpp-shared-buffer", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+        throw an_error_from_errno("Could not create memfd for shared buffer");
+
+    SharedBuffer result;
+    result.d = std::make_shared<Private>(fd);
+
+    if (::ftruncate(fd, size) == -1)
+        throw an_error_from_errno("Could not resize shared buffer");
+
+    // The writable mapping has to be gone before we can seal against writes.
+    if (size > 0 && fill)
+    {
+        auto p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            throw an_error_from_errno("Could not map shared buffer for writing");
+
+        struct Scope
+        {
+            ~Scope() { ::munmap(p, size); }
+            void* p;
+            std::size_t size;
+        } scope{p, size};
+
+        fill(static_cast<std::uint8_t*>(p), size);
+    }
+
+    if (::fcntl(fd, F_ADD_SEALS, required_seals() | F_SEAL_SEAL) == -1)
+        throw an_error_from_errno("Could not seal shared buffer");
+
+    result.d->map_read_only();
+    return result;
+}
+
+SharedBuffer SharedBuffer::copy_of(const void* data, std::size_t size)
+{
+    return create(size, [data](std::uint8_t* p, std::size_t size)
+    {
+        std::memcpy(p, data, size);
+    });
+}
+
+SharedBuffer SharedBuffer::map(const UnixFd& fd)
+{
+    SharedBuffer result;
+    result.d = std::make_shared<Private>(fd.to_int());
+
+    auto seals = ::fcntl(fd.to_int(), F_GET_SEALS);
+    if (seals == -1 || (seals & required_seals()) != required_seals())
+        throw Errors::NotSealed{};
+
+    result.d->map_read_only();
+    return result;
+}
+
+SharedBuffer::SharedBuffer()
+{
+}
+
+const std::uint8_t* SharedBuffer::data() const
+{
+    return d ? d->data : nullptr;
+}
+
+std::size_t SharedBuffer::size() const
+{
+    return d ? d->size : 0;
+}
+
+bool SharedBuffer::empty() const
+{
+    return size() == 0;
+}
+
+const std::uint8_t* SharedBuffer::begin() const
+{
+    return data();
+}
+
+const std::uint8_t* SharedBuffer::end() const
+{
+    return data() + size();
+}
+
+UnixFd SharedBuffer::fd() const
+{
+    return UnixFd{d ? d->fd : -1};
+}
+}
+}
+}
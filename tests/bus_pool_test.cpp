@@ -0,0 +1,186 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/bus.h>
+#include <core/dbus/bus_pool.h>
+#include <core/dbus/dbus.h>
+#include <core/dbus/fixture.h>
+#include <core/dbus/object.h>
+#include <core/dbus/service.h>
+
+#include <core/dbus/asio/executor.h>
+#include <core/dbus/types/stl/string.h>
+
+#include "test_data.h"
+
+#include <boost/asio.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <set>
+#include <thread>
+
+namespace dbus = core::dbus;
+
+namespace
+{
+struct BusPool : public core::dbus::testing::Fixture
+{
+};
+
+auto session_bus_config_file =
+        core::dbus::testing::Fixture::default_session_bus_config_file() =
+        core::testing::session_bus_configuration_file();
+
+auto system_bus_config_file =
+        core::dbus::testing::Fixture::default_system_bus_config_file() =
+        core::testing::system_bus_configuration_file();
+
+struct Pooled
+{
+    static const std::string& name()
+    {
+        static const std::string s{"com.canonical.dbus.Pooled"};
+        return s;
+    }
+
+    // Replies with the unique name of the calling connection.
+    struct WhoAmI
+    {
+        typedef Pooled Interface;
+
+        static const std::string& name()
+        {
+            static const std::string s{"WhoAmI"};
+            return s;
+        }
+
+        static const std::chrono::milliseconds default_timeout()
+        {
+            return std::chrono::seconds{1};
+        }
+    };
+};
+
+// Serves Pooled for all objects below /pooled on a connection of its own.
+struct Server
+{
+    Server(const dbus::Bus::Ptr& bus) : bus(bus)
+    {
+        bus->install_executor(dbus::asio::make_executor(bus, io_service));
+
+        service = dbus::Service::add_service(bus, Pooled::name());
+        service->add_subtree_for_path(dbus::types::ObjectPath("/pooled"), [bus](const dbus::Message::Ptr& msg, const std::string&)
+        {
+            if (msg->type() != dbus::Message::Type::method_call)
+                return dbus::Bus::MessageHandlerResult::not_yet_handled;
+
+            auto reply = dbus::Message::make_method_return(msg);
+            reply->writer() << msg->sender();
+            bus->send(reply);
+
+            return dbus::Bus::MessageHandlerResult::handled;
+        });
+
+        worker = std::thread{[bus](){ bus->run(); }};
+    }
+
+    ~Server()
+    {
+        bus->stop();
+
+        if (worker.joinable())
+            worker.join();
+    }
+
+    boost::asio::io_service io_service;
+    dbus::Bus::Ptr bus;
+    dbus::Service::Ptr service;
+    std::thread worker;
+};
+
+std::string who_am_i(const dbus::Service::Ptr& stub, const std::string& path)
+{
+    return stub->object_for_path(dbus::types::ObjectPath(path))
+            ->invoke_method_synchronously<Pooled::WhoAmI, std::string>().value();
+}
+}
+
+TEST_F(BusPool, CreatingAPoolWithoutConnectionsThrows)
+{
+    EXPECT_ANY_THROW(dbus::BusPool(session_bus_address(), 0));
+}
+
+TEST_F(BusPool, CreatingAPoolForAnInvalidAddressThrows)
+{
+    EXPECT_ANY_THROW(dbus::BusPool("unix:path=/this/path/does/not/exist", 2));
+}
+
+TEST_F(BusPool, RoundRobinSpreadsCallsAcrossAllConnections)
+{
+    Server server{session_bus()};
+
+    auto pool = std::make_shared<dbus::BusPool>(session_bus_address(), 3);
+    EXPECT_EQ(std::size_t{3}, pool->connections().size());
+    EXPECT_EQ(pool->connections().front(), pool->primary());
+
+    auto stub = dbus::Service::use_service<Pooled>(pool);
+
+    std::set<std::string> callers;
+    for (std::size_t i = 0; i < 6; i++)
+        callers.insert(who_am_i(stub, "/pooled/a"));
+
+    EXPECT_EQ(std::size_t{3}, callers.size());
+}
+
+TEST_F(BusPool, HashingOnTheObjectPathPinsCallsToAnObjectToOneConnection)
+{
+    Server server{session_bus()};
+
+    auto pool = std::make_shared<dbus::BusPool>(session_bus_address(), 3, dbus::BusPool::Policy::object_path_hash);
+    auto stub = dbus::Service::use_service<Pooled>(pool);
+
+    std::set<std::string> callers;
+    for (std::size_t i = 0; i < 6; i++)
+        callers.insert(who_am_i(stub, "/pooled/a"));
+
+    EXPECT_EQ(std::size_t{1}, callers.size());
+}
+
+TEST_F(BusPool, LeastInFlightPrefersIdleConnections)
+{
+    auto pool = std::make_shared<dbus::BusPool>(session_bus_address(), 2, dbus::BusPool::Policy::least_in_flight);
+    auto& connections = pool->connections();
+
+    // Without any outstanding calls, the primary connection is picked.
+    EXPECT_EQ(connections[0], pool->connection_for_method_call(dbus::types::ObjectPath("/")));
+
+    // The reply is never dispatched as there is no executor installed.
+    auto msg = dbus::Message::make_method_call(
+                dbus::DBus::name(),
+                dbus::DBus::path(),
+                dbus::DBus::interface(),
+                "ListNames");
+    auto pending_call = connections[0]->send_with_reply_and_timeout(msg, std::chrono::seconds{10});
+
+    EXPECT_EQ(std::size_t{1}, connections[0]->outstanding_calls());
+    EXPECT_EQ(connections[1], pool->connection_for_method_call(dbus::types::ObjectPath("/")));
+
+    pending_call->cancel();
+    EXPECT_EQ(std::size_t{0}, connections[0]->outstanding_calls());
+}
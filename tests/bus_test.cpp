@@ -21,6 +21,9 @@
 #include <core/dbus/dbus.h>
 #include <core/dbus/fixture.h>
 #include <core/dbus/match_rule.h>
+#include <core/dbus/match_rule_index.h>
+#include <core/dbus/message_log.h>
+#include <core/dbus/server.h>
 #include <core/dbus/message_streaming_operators.h>
 
 #include <core/dbus/types/stl/string.h>
@@ -37,7 +40,12 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace dbus = core::dbus;
 
@@ -148,6 +156,288 @@ TEST_F(Bus, AddingAndRemovingAValidMatchRuleDoesNotThrow)
     ScopedMatch match(bus, valid_match_rule);
 }
 
+TEST_F(Bus, MatchRulesAreReferenceCounted)
+{
+    auto bus = session_bus();
+
+    auto rule = dbus::MatchRule()
+            .type(dbus::Message::Type::signal)
+            .interface("org.freedesktop.DBus");
+
+    EXPECT_TRUE(bus->match_rules().empty());
+
+    EXPECT_NO_THROW(bus->add_match(rule));
+    EXPECT_NO_THROW(bus->add_match(rule));
+    EXPECT_EQ(std::size_t{2}, bus->match_rules().at(rule.as_string()));
+
+    EXPECT_NO_THROW(bus->remove_match(rule));
+    EXPECT_EQ(std::size_t{1}, bus->match_rules().at(rule.as_string()));
+
+    EXPECT_NO_THROW(bus->remove_match(rule));
+    EXPECT_TRUE(bus->match_rules().empty());
+
+    // The rule is gone from the daemon, too.
+    EXPECT_ANY_THROW(bus->remove_match(rule));
+}
+
+TEST_F(Bus, SubscribersAddingARuleConcurrentlyInstallItOnce)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+    std::thread t{[bus](){ bus->run(); }};
+
+    auto rule = dbus::MatchRule()
+            .type(dbus::Message::Type::signal)
+            .member("Concurrent");
+
+    // Mixes in an asynchronous subscriber whose AddMatch call is in flight.
+    auto f = bus->add_match_asynchronously(rule);
+
+    std::vector<std::thread> subscribers;
+    for (unsigned int i = 0; i < 8; i++)
+        subscribers.emplace_back([bus, rule]() { bus->add_match(rule); });
+
+    for (auto& subscriber : subscribers)
+        subscriber.join();
+
+    ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds{1}));
+    EXPECT_FALSE(f.get().is_error());
+    EXPECT_EQ(std::size_t{9}, bus->match_rules().at(rule.as_string()));
+
+    for (unsigned int i = 0; i < 9; i++)
+        EXPECT_NO_THROW(bus->remove_match(rule));
+
+    // No copy of the rule is left behind with the daemon.
+    EXPECT_ANY_THROW(bus->remove_match(rule));
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Bus, AddingAndRemovingMatchRulesAsynchronouslyWorks)
+{
+    // The default executor shares its io_service across the process, and
+    // other tests in this binary have already stopped it.
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+    std::thread t{[bus](){ bus->run(); }};
+
+    auto rule = [](const std::string& member)
+    {
+        return dbus::MatchRule().type(dbus::Message::Type::signal).member(member);
+    };
+
+    // The daemon only supports arguments up to index 63.
+    auto invalid_rule = rule("Invalid").args({{64, "x"}});
+
+    auto f1 = bus->add_match_asynchronously(rule("A"));
+    auto f2 = bus->add_match_asynchronously(rule("A"));
+    auto f3 = bus->add_matches_asynchronously({rule("B"), rule("C")});
+    auto f4 = bus->add_matches_asynchronously({rule("D"), invalid_rule});
+
+    for (auto f : {&f1, &f2, &f3, &f4})
+        EXPECT_EQ(std::future_status::ready, f->wait_for(std::chrono::seconds{1}));
+
+    EXPECT_FALSE(f1.get().is_error());
+    EXPECT_FALSE(f2.get().is_error());
+    EXPECT_FALSE(f3.get().is_error());
+    EXPECT_TRUE(f4.get().is_error());
+
+    auto match_rules = bus->match_rules();
+    EXPECT_EQ(std::size_t{4}, match_rules.size());
+    EXPECT_EQ(std::size_t{2}, match_rules[rule("A").as_string()]);
+    EXPECT_EQ(0u, match_rules.count(invalid_rule.as_string()));
+
+    auto f5 = bus->remove_match_asynchronously(rule("A"));
+    auto f6 = bus->remove_match_asynchronously(rule("A"));
+    auto f7 = bus->remove_match_asynchronously(rule("A"));
+
+    for (auto f : {&f5, &f6, &f7})
+        EXPECT_EQ(std::future_status::ready, f->wait_for(std::chrono::seconds{1}));
+
+    EXPECT_FALSE(f5.get().is_error());
+    EXPECT_FALSE(f6.get().is_error());
+    // The rule is gone from the daemon.
+    EXPECT_TRUE(f7.get().is_error());
+
+    EXPECT_EQ(std::size_t{3}, bus->match_rules().size());
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Bus, SubscribersQueuedForAFailingMatchRuleAllSeeTheError)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+
+    // The daemon only supports arguments up to index 63.
+    auto invalid_rule = dbus::MatchRule().type(dbus::Message::Type::signal).args({{64, "x"}});
+
+    // Both are queued before the connection is dispatched, i.e., before the daemon replied.
+    auto f1 = bus->add_match_asynchronously(invalid_rule);
+    auto f2 = bus->add_match_asynchronously(invalid_rule);
+    EXPECT_EQ(std::future_status::timeout, f2.wait_for(std::chrono::milliseconds{0}));
+
+    std::thread t{[bus](){ bus->run(); }};
+
+    for (auto f : {&f1, &f2})
+        EXPECT_EQ(std::future_status::ready, f->wait_for(std::chrono::seconds{1}));
+
+    EXPECT_TRUE(f1.get().is_error());
+    EXPECT_TRUE(f2.get().is_error());
+    EXPECT_EQ(0u, bus->match_rules().count(invalid_rule.as_string()));
+
+    // Later subscribers try again instead of relying on stale counts.
+    EXPECT_ANY_THROW(bus->add_match(invalid_rule));
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Bus, NameOwnerCacheFollowsOwnershipChanges)
+{
+    static const std::string name{"com.canonical.dbus.cached"};
+
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+    std::thread t{[bus](){ bus->run(); }};
+
+    bus->enable_name_owner_cache();
+    bus->enable_name_owner_cache();
+    EXPECT_EQ(std::size_t{1}, bus->match_rules().size());
+
+    auto owner_of = [bus](const std::string& name)
+    {
+        auto f = bus->get_name_owner(name);
+        EXPECT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds{1}));
+        return f.get();
+    };
+
+    EXPECT_EQ(dbus::DBus::name(), owner_of(dbus::DBus::name()));
+    // Populates the cache with the name not being owned.
+    EXPECT_FALSE(bus->has_owner_for_name(name));
+    EXPECT_EQ(std::string{}, owner_of(name));
+
+    // Without the NameOwnerChanged subscription, the cache would keep
+    // reporting the name as not owned.
+    auto wait_for_owner = [owner_of](const std::string& name, bool owned)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+        while (owner_of(name).empty() == owned && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        return owner_of(name);
+    };
+
+    auto other = session_bus();
+
+    auto owned = other->request_name_on_bus(name, dbus::Bus::RequestNameFlag::do_not_queue);
+    EXPECT_EQ(':', wait_for_owner(name, true)[0]);
+    EXPECT_TRUE(bus->has_owner_for_name(name));
+
+    other->release_name_on_bus(std::move(owned));
+    EXPECT_EQ(std::string{}, wait_for_owner(name, false));
+    EXPECT_FALSE(bus->has_owner_for_name(name));
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Bus, ConnectingAndRequestingNamesAsynchronouslyWorks)
+{
+    auto f1 = dbus::Bus::connect_asynchronously(session_bus_address());
+    auto f2 = dbus::Bus::connect_asynchronously(session_bus_address());
+    auto f3 = dbus::Bus::connect_asynchronously("unix:path=/this/path/does/not/exist");
+
+    auto bus = f1.get();
+    auto other = f2.get();
+    EXPECT_ANY_THROW(f3.get());
+
+    boost::asio::io_service io_service;
+    bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+    std::thread t{[bus](){ bus->run(); }};
+
+    auto n1 = bus->request_name_on_bus_asynchronously("com.canonical.dbus.first", dbus::Bus::RequestNameFlag::do_not_queue);
+    auto n2 = bus->request_name_on_bus_asynchronously("com.canonical.dbus.second", dbus::Bus::RequestNameFlag::do_not_queue);
+
+    for (auto f : {&n1, &n2})
+        EXPECT_EQ(std::future_status::ready, f->wait_for(std::chrono::seconds{1}));
+
+    EXPECT_EQ("com.canonical.dbus.first", n1.get().as_string());
+    EXPECT_EQ("com.canonical.dbus.second", n2.get().as_string());
+    EXPECT_TRUE(other->has_owner_for_name("com.canonical.dbus.first"));
+
+    auto n3 = bus->request_name_on_bus_asynchronously("com.canonical.dbus.first", dbus::Bus::RequestNameFlag::do_not_queue);
+    EXPECT_EQ(std::future_status::ready, n3.wait_for(std::chrono::seconds{1}));
+    EXPECT_THROW(n3.get(), dbus::Bus::Errors::AlreadyOwner);
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Bus, ConnectingOnASharedEventLoopCompletesTheHelloOnIt)
+{
+    boost::asio::io_service io_service;
+    auto make_executor = [&io_service](const dbus::Bus::Ptr& bus)
+    {
+        return core::dbus::asio::make_executor(bus, io_service);
+    };
+
+    auto f1 = dbus::Bus::connect_asynchronously(session_bus_address(), make_executor);
+    auto f2 = dbus::Bus::connect_asynchronously(session_bus_address(), make_executor);
+    auto f3 = dbus::Bus::connect_asynchronously("unix:path=/this/path/does/not/exist", make_executor);
+
+    // Nothing completes the handshake until the event loop runs.
+    EXPECT_EQ(std::future_status::timeout, f1.wait_for(std::chrono::milliseconds{100}));
+    EXPECT_ANY_THROW(f3.get());
+
+    std::thread t{[&io_service]() { io_service.run(); }};
+
+    for (auto f : {&f1, &f2})
+        EXPECT_EQ(std::future_status::ready, f->wait_for(std::chrono::seconds{1}));
+
+    auto bus = f1.get();
+    auto other = f2.get();
+
+    bus->request_name_on_bus("com.canonical.dbus.shared", dbus::Bus::RequestNameFlag::do_not_queue);
+    EXPECT_TRUE(other->has_owner_for_name("com.canonical.dbus.shared"));
+
+    io_service.stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Bus, AddingAndRemovingAMatchRuleUsingTheFullGrammarDoesNotThrow)
+{
+    auto bus = session_bus();
+
+    auto rule = dbus::MatchRule()
+            .type(dbus::Message::Type::signal)
+            .destination(":1.42")
+            .path_namespace(dbus::types::ObjectPath("/org/freedesktop"))
+            .args({{1, "it's"}})
+            .arg_paths({{2, "/org/freedesktop/"}})
+            .arg0_namespace("org.freedesktop");
+
+    EXPECT_NO_THROW(bus->add_match(rule));
+    EXPECT_NO_THROW(bus->remove_match(rule));
+}
+
 namespace
 {
 dbus::Message::Ptr a_signal_message(const std::string& path, const std::string& interface, const std::string& name)
@@ -177,3 +467,322 @@ TEST_F(Bus, InstallingARouteForSignalsResultsInTheRouteBeingInvoked)
                 "LaLeLu");
     bus->access_signal_router()(signal);
 }
+
+TEST_F(Bus, HandlingASignalEvaluatesTheMatchRuleIndex)
+{
+    const core::dbus::types::ObjectPath path{"/org/gnome/SettingsDaemon/Power"};
+    bool invoked {false};
+    auto bus = session_bus();
+    bus->access_match_rule_index().install(
+                dbus::MatchRule()
+                    .type(dbus::Message::Type::signal)
+                    .interface("org.gnome.SettingsDaemon.Power")
+                    .path(path),
+                [&](const dbus::Message::Ptr&)
+                {
+                    invoked = true;
+                });
+    auto signal = a_signal_message(
+                path.as_string(),
+                "org.gnome.SettingsDaemon.Power",
+                "LaLeLu");
+    bus->handle_message(signal);
+
+    EXPECT_TRUE(invoked);
+}
+
+TEST_F(Bus, SubscribingToASubtreeDeliversTheSignalsOfAllObjectsBelowIt)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+    std::thread t{[bus](){ bus->run(); }};
+
+    std::mutex guard;
+    std::condition_variable cv;
+    std::vector<std::string> paths;
+
+    auto rule = dbus::MatchRule()
+            .interface("com.canonical.dbus.Devices")
+            .member("Changed")
+            .path_namespace(dbus::types::ObjectPath("/devices"));
+
+    auto token = bus->subscribe_to_signals(rule, [&](const dbus::Message::Ptr& msg)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        paths.push_back(msg->path().as_string());
+        cv.notify_all();
+    });
+
+    EXPECT_EQ(std::size_t{1}, bus->match_rules().count(rule.type(dbus::Message::Type::signal).as_string()));
+
+    // Signals only reach us if the daemon has the rule, too.
+    auto emitter = session_bus();
+    for (const char* path : {"/devices/a", "/other/b", "/devicesc", "/devices/b/c"})
+        emitter->send(a_signal_message(path, "com.canonical.dbus.Devices", "Changed"));
+
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        cv.wait_for(ul, std::chrono::seconds{1}, [&paths]() { return paths.size() >= 2; });
+        EXPECT_EQ((std::vector<std::string>{"/devices/a", "/devices/b/c"}), paths);
+    }
+
+    bus->unsubscribe_from_signals(token);
+    EXPECT_TRUE(bus->match_rules().empty());
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+namespace
+{
+// Collects the members of signals emitted on /batch, in order of arrival.
+struct BatchReceiver
+{
+    BatchReceiver(const dbus::Bus::Ptr& bus) : bus(bus)
+    {
+        auto rule = dbus::MatchRule()
+                .type(dbus::Message::Type::signal)
+                .interface("com.canonical.dbus.Batch")
+                .path(dbus::types::ObjectPath("/batch"));
+
+        bus->access_match_rule_index().install(rule, [this](const dbus::Message::Ptr& msg)
+        {
+            std::lock_guard<std::mutex> lg(guard);
+            members.push_back(msg->member());
+            cv.notify_all();
+        });
+        bus->add_match(rule);
+
+        bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+        worker = std::thread{[bus](){ bus->run(); }};
+    }
+
+    ~BatchReceiver()
+    {
+        bus->stop();
+
+        if (worker.joinable())
+            worker.join();
+    }
+
+    std::vector<std::string> wait_for(std::size_t count)
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        cv.wait_for(ul, std::chrono::seconds{1}, [this, count]() { return members.size() >= count; });
+        return members;
+    }
+
+    boost::asio::io_service io_service;
+    dbus::Bus::Ptr bus;
+    std::mutex guard;
+    std::condition_variable cv;
+    std::vector<std::string> members;
+    std::thread worker;
+};
+
+std::vector<dbus::Message::Ptr> a_batch_of_signals(std::size_t size, std::vector<std::string>& members)
+{
+    std::vector<dbus::Message::Ptr> batch;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        members.push_back("Signal" + std::to_string(i));
+        batch.push_back(a_signal_message("/batch", "com.canonical.dbus.Batch", members.back()));
+    }
+    return batch;
+}
+}
+
+TEST_F(Bus, SendingInOrderQueuesAllMessagesInOrder)
+{
+    BatchReceiver receiver{session_bus()};
+    auto bus = session_bus();
+
+    std::vector<std::string> members;
+    auto serials = bus->send_in_order(a_batch_of_signals(10, members));
+
+    ASSERT_EQ(std::size_t{10}, serials.size());
+    EXPECT_GT(serials.front(), 0u);
+    for (std::size_t i = 1; i < serials.size(); i++)
+        EXPECT_LT(serials[i-1], serials[i]);
+
+    EXPECT_EQ(members, receiver.wait_for(members.size()));
+}
+
+TEST_F(Bus, CorkedMessagesAreSubmittedOnceTheOutermostCorkIsReleased)
+{
+    BatchReceiver receiver{session_bus()};
+    auto bus = session_bus();
+
+    std::vector<std::string> members;
+    auto batch = a_batch_of_signals(6, members);
+
+    dbus::Bus::Cork outer{bus};
+    {
+        dbus::Bus::Cork inner{bus};
+
+        for (std::size_t i = 0; i < 3; i++)
+            EXPECT_EQ(0u, bus->send(batch[i]));
+
+        EXPECT_EQ(std::vector<uint32_t>(3, 0), bus->send_in_order({batch.begin() + 3, batch.end()}));
+        EXPECT_TRUE(inner.release().empty());
+    }
+
+    auto serials = outer.release();
+    ASSERT_EQ(std::size_t{6}, serials.size());
+    for (std::size_t i = 1; i < serials.size(); i++)
+        EXPECT_LT(serials[i-1], serials[i]);
+
+    EXPECT_TRUE(outer.release().empty());
+    EXPECT_EQ(members, receiver.wait_for(members.size()));
+
+    // Once released, messages go out right away.
+    EXPECT_GT(bus->send(a_signal_message("/batch", "com.canonical.dbus.Batch", "Uncorked")), 0u);
+}
+
+TEST_F(Bus, CorkedMessagesGoOutAheadOfMethodCallsIssuedAfterThem)
+{
+    const std::string path = "/tmp/dbus-cpp-bus-cork-order-test";
+    std::remove(path.c_str());
+
+    BatchReceiver receiver{session_bus()};
+    receiver.bus->request_name_on_bus("com.canonical.dbus.Batch", dbus::Bus::RequestNameFlag::do_not_queue);
+
+    auto log = std::make_shared<dbus::MessageLog::Writer>(path);
+    receiver.bus->capture_to(log);
+
+    auto bus = session_bus();
+    auto call = dbus::Message::make_method_call(
+                "com.canonical.dbus.Batch",
+                dbus::types::ObjectPath("/batch"),
+                "com.canonical.dbus.Batch",
+                "Call");
+
+    {
+        dbus::Bus::Cork cork{bus};
+        EXPECT_EQ(0u, bus->send(a_signal_message("/batch", "com.canonical.dbus.Batch", "Signal0")));
+        bus->send_with_reply_and_timeout(call, std::chrono::seconds{1});
+        EXPECT_EQ(0u, bus->send(a_signal_message("/batch", "com.canonical.dbus.Batch", "Signal1")));
+    }
+
+    EXPECT_EQ((std::vector<std::string>{"Signal0", "Signal1"}), receiver.wait_for(2));
+
+    receiver.bus->capture_to(nullptr);
+    log.reset();
+
+    dbus::MessageLog::Reader reader{path};
+    dbus::MessageLog::Entry entry;
+
+    std::vector<std::string> members;
+    while (reader.next(entry))
+    {
+        if (entry.tag == static_cast<std::uint32_t>(dbus::Bus::CaptureDirection::incoming) &&
+            entry.message->path().as_string() == "/batch")
+            members.push_back(entry.message->member());
+    }
+
+    EXPECT_EQ((std::vector<std::string>{"Signal0", "Call", "Signal1"}), members);
+
+    std::remove(path.c_str());
+}
+
+TEST_F(Bus, ExceedingTheOutgoingHighWaterMarkIsAnnouncedAndFailsFastOnRequest)
+{
+    // The server never accepts, i.e., everything we send stays queued.
+    dbus::Server server{"unix:tmpdir=/tmp", [](const dbus::Bus::Ptr&){}};
+    auto bus = std::make_shared<dbus::Bus>(server.address(), dbus::Bus::PeerToPeer{});
+
+    std::vector<bool> crossings;
+    bus->outgoing_high_water_mark_crossed().connect([&crossings](bool above)
+    {
+        crossings.push_back(above);
+    });
+
+    bus->set_outgoing_high_water_mark(4096, dbus::Bus::OutgoingQueuePolicy::fail);
+    EXPECT_EQ(std::size_t{4096}, bus->outgoing_high_water_mark());
+
+    const std::string payload(1024, 'x');
+
+    std::size_t sent = 0;
+    try
+    {
+        for (; sent < 100; sent++)
+        {
+            auto signal = a_signal_message("/batch", "com.canonical.dbus.Batch", "Payload");
+            signal->writer() << payload;
+            bus->send(signal);
+        }
+    }
+    catch (const dbus::Bus::Errors::OutgoingQueueFull&)
+    {
+    }
+
+    EXPECT_GT(sent, std::size_t{0});
+    EXPECT_LT(sent, std::size_t{100});
+    EXPECT_GT(bus->outgoing_queue_size(), std::size_t{4096});
+    EXPECT_EQ(std::vector<bool>{true}, crossings);
+
+    // Raising the mark brings the queue back below it.
+    bus->set_outgoing_high_water_mark(1 << 20);
+    EXPECT_EQ((std::vector<bool>{true, false}), crossings);
+}
+
+TEST_F(Bus, CapturingRecordsOutgoingCallsAndIncomingRepliesInOrder)
+{
+    const std::string path = "/tmp/dbus-cpp-bus-capture-test";
+    std::remove(path.c_str());
+
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    std::thread worker{[bus](){ bus->run(); }};
+
+    auto log = std::make_shared<dbus::MessageLog::Writer>(path);
+    bus->capture_to(log);
+
+    auto list_names = dbus::Message::make_method_call(
+                dbus::DBus::name(), dbus::DBus::path(), dbus::DBus::interface(), "ListNames");
+    EXPECT_EQ(dbus::Message::Type::method_return,
+              bus->send_with_reply_and_block_for_at_most(list_names, std::chrono::seconds{1})->type());
+
+    auto get_id = dbus::Message::make_method_call(
+                dbus::DBus::name(), dbus::DBus::path(), dbus::DBus::interface(), "GetId");
+
+    std::promise<void> replied;
+    bus->send_with_reply_and_timeout(get_id, std::chrono::seconds{1})->then([&replied](const dbus::Message::Ptr&)
+    {
+        replied.set_value();
+    });
+    EXPECT_EQ(std::future_status::ready, replied.get_future().wait_for(std::chrono::seconds{5}));
+
+    bus->capture_to(nullptr);
+    log.reset();
+
+    bus->stop();
+    if (worker.joinable())
+        worker.join();
+
+    dbus::MessageLog::Reader reader{path};
+    dbus::MessageLog::Entry entry;
+
+    std::vector<std::pair<dbus::Bus::CaptureDirection, std::string>> calls;
+    std::vector<dbus::Bus::CaptureDirection> replies;
+    while (reader.next(entry))
+    {
+        auto direction = static_cast<dbus::Bus::CaptureDirection>(entry.tag);
+        if (entry.message->type() == dbus::Message::Type::method_call)
+            calls.push_back(std::make_pair(direction, entry.message->member()));
+        else if (entry.message->type() == dbus::Message::Type::method_return)
+            replies.push_back(direction);
+    }
+
+    EXPECT_EQ((std::vector<std::pair<dbus::Bus::CaptureDirection, std::string>>{
+                   {dbus::Bus::CaptureDirection::outgoing, "ListNames"},
+                   {dbus::Bus::CaptureDirection::outgoing, "GetId"}}),
+              calls);
+    EXPECT_EQ(std::vector<dbus::Bus::CaptureDirection>(2, dbus::Bus::CaptureDirection::incoming), replies);
+
+    std::remove(path.c_str());
+}
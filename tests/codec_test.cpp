@@ -23,8 +23,10 @@
 
 #include <core/dbus/types/any.h>
 #include <core/dbus/types/object_path.h>
+#include <core/dbus/types/shared_buffer.h>
 #include <core/dbus/types/signature.h>
 #include <core/dbus/types/struct.h>
+#include <core/dbus/types/unique_fd.h>
 #include <core/dbus/types/unix_fd.h>
 #include <core/dbus/types/variant.h>
 
@@ -126,6 +128,20 @@ TEST(Codec, CompoundTypeSignaturesMapToCorrectDBusSignatures)
         core::dbus::helper::TypeMapper<Map>::signature().c_str());
 }
 
+TEST(Codec, CompoundTypeSignaturesAreAvailableAtCompileTime)
+{
+    typedef std::map<std::string, std::vector<std::int32_t>> Map;
+    typedef core::dbus::helper::TypeMapper<Map>::StaticSignatureType MapSignature;
+    static_assert(MapSignature::size == 6, "Static signature of a{sai} has unexpected size.");
+    ASSERT_STREQ("a{sai}", core::dbus::helper::static_signature<Map>());
+
+    typedef std::tuple<std::string, dbus::types::Struct<std::tuple<double, bool>>> Tuple;
+    static_assert(core::dbus::helper::TypeMapper<Tuple>::StaticSignatureType::size == 5, "Static signature of s(db) has unexpected size.");
+    ASSERT_STREQ("s(db)", core::dbus::helper::static_signature<Tuple>());
+
+    ASSERT_EQ("sa{sai}", core::dbus::helper::signature(std::string{}, Map{}));
+}
+
 namespace
 {
 
@@ -298,6 +314,96 @@ TEST(UnixFd, EncodingAndDecodingWorksCorrectly)
     ASSERT_EQ(magic_value, result);
 }
 
+#include <fcntl.h>
+
+TEST(UniqueFd, DecodingTakesOwnershipOfTheDuplicate)
+{
+    namespace dbus = core::dbus;
+    ASSERT_EQ(dbus::ArgumentType::unix_fd, dbus::helper::TypeMapper<dbus::types::UniqueFd>::type_value());
+
+    dbus::types::UniqueFd expected_value{eventfd(0,0)};
+    auto msg = a_method_call();
+    msg->writer() << expected_value;
+    EXPECT_EQ(DBUS_TYPE_UNIX_FD_AS_STRING, msg->signature());
+
+    int duplicate = -1;
+    {
+        auto reader = msg->reader();
+        auto fd = dbus::decode_argument<dbus::types::UniqueFd>(reader);
+        ASSERT_TRUE(static_cast<bool>(fd));
+        EXPECT_NE(expected_value.to_int(), fd.to_int());
+        duplicate = fd.to_int();
+        EXPECT_NE(-1, fcntl(duplicate, F_GETFD));
+    }
+    // Going out of scope closed the fd.
+    EXPECT_EQ(-1, fcntl(duplicate, F_GETFD));
+    EXPECT_NE(-1, fcntl(expected_value.to_int(), F_GETFD));
+}
+
+TEST(UniqueFd, PushingHandsOwnershipToTheMessage)
+{
+    namespace dbus = core::dbus;
+    dbus::types::UniqueFd fd{eventfd(0,0)};
+    const int original = fd.to_int();
+
+    auto msg = a_method_call();
+    msg->writer() << std::move(fd);
+
+    EXPECT_FALSE(static_cast<bool>(fd));
+    EXPECT_EQ(-1, fcntl(original, F_GETFD));
+
+    auto reader = msg->reader();
+    auto received = reader.pop_unique_fd();
+    static const uint64_t magic_value{42};
+    EXPECT_EQ(ssize_t(sizeof(magic_value)), write(received.to_int(), std::addressof(magic_value), sizeof(magic_value)));
+}
+
+TEST(SharedBuffer, EncodingAndDecodingMapsTheSamePayloadReadOnly)
+{
+    namespace dbus = core::dbus;
+    const std::string payload(4 * 1024 * 1024, 'x');
+
+    auto buffer = dbus::types::SharedBuffer::copy_of(payload.data(), payload.size());
+    auto msg = a_method_call();
+    auto writer = msg->writer();
+
+    ASSERT_NO_THROW(dbus::encode_argument(writer, buffer););
+    EXPECT_EQ(DBUS_TYPE_UNIX_FD_AS_STRING, msg->signature());
+
+    auto reader = msg->reader();
+    auto received = dbus::decode_argument<dbus::types::SharedBuffer>(reader);
+
+    ASSERT_EQ(payload.size(), received.size());
+    EXPECT_NE(buffer.fd().to_int(), received.fd().to_int());
+    EXPECT_EQ(payload, std::string(received.begin(), received.end()));
+
+    // The memfd is sealed, neither the sender nor the receiver can modify it.
+    EXPECT_EQ(-1, write(received.fd().to_int(), "y", 1));
+    EXPECT_EQ(-1, ftruncate(received.fd().to_int(), 0));
+}
+
+TEST(SharedBuffer, EmptyBuffersAreTransferredAsAnEmptyMemfd)
+{
+    namespace dbus = core::dbus;
+    auto msg = a_method_call();
+    auto writer = msg->writer();
+
+    ASSERT_NO_THROW(dbus::encode_argument(writer, dbus::types::SharedBuffer{}););
+
+    auto reader = msg->reader();
+    auto received = dbus::decode_argument<dbus::types::SharedBuffer>(reader);
+
+    EXPECT_TRUE(received.empty());
+    EXPECT_EQ(nullptr, received.data());
+}
+
+TEST(SharedBuffer, MappingAnUnsealedFdThrows)
+{
+    namespace dbus = core::dbus;
+    EXPECT_THROW(dbus::types::SharedBuffer::map(dbus::types::UnixFd{eventfd(0, 0)}),
+                 dbus::types::SharedBuffer::Errors::NotSealed);
+}
+
 TEST(Variant, TypeMapperSpecializationReturnsCorrectValues)
 {
     namespace dbus = core::dbus;
@@ -328,6 +434,82 @@ TEST(Variant, EncodingAndDecodingWorksCorrectly)
     ASSERT_EQ(expected_value, my_struct);
 }
 
+TEST(Variant, BasicValuesAreHeldInlineAndSurviveCopiesAndMoves)
+{
+    namespace dbus = core::dbus;
+
+    auto v1 = dbus::types::Variant::encode<std::uint32_t>(42);
+    EXPECT_EQ(dbus::ArgumentType::uint32, v1.type());
+    EXPECT_EQ(dbus::types::Signature{"u"}, v1.signature());
+    EXPECT_EQ(std::uint32_t(42), v1.as<std::uint32_t>());
+    EXPECT_ANY_THROW(v1.as<std::int32_t>());
+
+    dbus::types::Variant v2;
+    {
+        dbus::types::TypedVariant<std::string> typed{"a string that is too long for the small string optimization"};
+        v2 = std::move(typed);
+    }
+
+    auto v3 = v2;
+    EXPECT_EQ(dbus::ArgumentType::string, v3.type());
+    EXPECT_EQ("a string that is too long for the small string optimization", v3.as<std::string>());
+
+    auto msg = a_method_call();
+    msg->writer() << v1 << v3;
+    EXPECT_EQ("vv", msg->signature());
+
+    dbus::types::Variant r1, r2;
+    msg->reader() >> r1 >> r2;
+    EXPECT_EQ(std::uint32_t(42), r1.as<std::uint32_t>());
+    EXPECT_EQ(dbus::types::Signature{"s"}, r2.signature());
+    EXPECT_EQ("a string that is too long for the small string optimization", r2.as<std::string>());
+}
+
+TEST(Variant, DecodingAContainerDropsTheSignatureOfAPreviousBasicValue)
+{
+    namespace dbus = core::dbus;
+
+    auto msg = a_method_call();
+    msg->writer()
+            << dbus::types::Variant::encode<std::int32_t>(42)
+            << dbus::types::TypedVariant<std::vector<std::int32_t>>{std::vector<std::int32_t>{1, 2}};
+
+    dbus::types::Variant v;
+    auto reader = msg->reader();
+    reader >> v;
+    EXPECT_EQ(dbus::types::Signature{"i"}, v.signature());
+
+    reader >> v;
+    EXPECT_EQ(dbus::ArgumentType::invalid, v.type());
+    EXPECT_EQ(dbus::types::Signature{}, v.signature());
+}
+
+TEST(Variant, TypedVariantsCanBeMovedBeforeEncodingAndDecoding)
+{
+    namespace dbus = core::dbus;
+
+    typedef std::vector<std::int32_t> Vector;
+
+    auto msg = a_method_call();
+    {
+        dbus::types::TypedVariant<Vector> v1{Vector{1, 2, 3}};
+        auto v2 = std::move(v1);
+        dbus::types::Variant sliced = dbus::types::TypedVariant<Vector>{Vector{4, 5}};
+        msg->writer() << v2 << sliced;
+    }
+    EXPECT_EQ("vv", msg->signature());
+
+    dbus::types::TypedVariant<Vector> v1;
+    dbus::types::Variant v2;
+    msg->reader() >> v1 >> v2;
+
+    auto moved = std::move(v1);
+    EXPECT_EQ((Vector{1, 2, 3}), moved.get());
+    EXPECT_EQ((Vector{1, 2, 3}), moved.as<Vector>());
+    EXPECT_EQ(dbus::types::Signature{"ai"}, moved.signature());
+    EXPECT_EQ((Vector{4, 5}), v2.as<Vector>());
+}
+
 TEST(Signature, TypeMapperSpecializationReturnsCorrectValues)
 {
     namespace dbus = core::dbus;
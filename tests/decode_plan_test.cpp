@@ -0,0 +1,181 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/dbus.h>
+#include <core/dbus/decode_plan.h>
+#include <core/dbus/message_streaming_operators.h>
+
+#include <core/dbus/types/struct.h>
+#include <core/dbus/types/variant.h>
+
+#include <core/dbus/types/stl/map.h>
+#include <core/dbus/types/stl/string.h>
+#include <core/dbus/types/stl/tuple.h>
+#include <core/dbus/types/stl/vector.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+
+namespace dbus = core::dbus;
+
+namespace
+{
+std::shared_ptr<core::dbus::Message> a_method_call()
+{
+    return dbus::Message::make_method_call(
+                dbus::DBus::name(),
+                dbus::DBus::path(),
+                dbus::DBus::interface(),
+                "ListNames");
+}
+
+// Renders the decoded values in a compact, signature-like notation.
+struct Printer : public dbus::DecodePlan::Visitor
+{
+    void on_basic(dbus::ArgumentType type, const DBusBasicValue& value) override
+    {
+        switch (type)
+        {
+        case dbus::ArgumentType::int32: out << value.i32 << " "; break;
+        case dbus::ArgumentType::uint32: out << value.u32 << " "; break;
+        case dbus::ArgumentType::floating_point: out << value.dbl << " "; break;
+        case dbus::ArgumentType::boolean: out << (value.bool_val ? "true" : "false") << " "; break;
+        case dbus::ArgumentType::string: out << value.str << " "; break;
+        default: out << "? "; break;
+        }
+    }
+
+    void on_enter(dbus::ArgumentType type, const char* signature) override
+    {
+        out << static_cast<char>(type) << "<" << signature << "> ";
+    }
+
+    void on_leave(dbus::ArgumentType) override
+    {
+        out << "/ ";
+    }
+
+    std::stringstream out;
+};
+}
+
+TEST(DecodePlan, CompilingAnInvalidSignatureThrows)
+{
+    EXPECT_ANY_THROW(dbus::DecodePlan::compile("a{"));
+    EXPECT_ANY_THROW(dbus::DecodePlan::for_signature("(s"));
+}
+
+TEST(DecodePlan, CompilingYieldsFlatInstructionSequence)
+{
+    typedef dbus::DecodePlan::OpCode OpCode;
+
+    auto plan = dbus::DecodePlan::compile("sa{sv}");
+    auto& instructions = plan->instructions();
+
+    ASSERT_EQ(8u, instructions.size());
+    EXPECT_EQ(OpCode::decode_basic, instructions[0].op);
+    EXPECT_EQ(OpCode::enter_array, instructions[1].op);
+    EXPECT_EQ("{sv}", instructions[1].signature);
+    EXPECT_EQ(7u, instructions[1].jump);
+    EXPECT_EQ(OpCode::enter_dict_entry, instructions[2].op);
+    EXPECT_EQ("sv", instructions[2].signature);
+    EXPECT_EQ(OpCode::decode_basic, instructions[3].op);
+    EXPECT_EQ(OpCode::decode_variant, instructions[4].op);
+    EXPECT_EQ(OpCode::leave_dict_entry, instructions[5].op);
+    EXPECT_EQ(OpCode::next_element, instructions[6].op);
+    EXPECT_EQ(2u, instructions[6].jump);
+    EXPECT_EQ(OpCode::leave_array, instructions[7].op);
+}
+
+TEST(DecodePlan, PlansAreCachedBySignature)
+{
+    auto p1 = dbus::DecodePlan::for_signature("a(ii)");
+    auto p2 = dbus::DecodePlan::for_signature("a(ii)");
+    auto p3 = dbus::DecodePlan::for_signature("a(id)");
+
+    EXPECT_EQ(p1, p2);
+    EXPECT_NE(p1, p3);
+    EXPECT_EQ("a(ii)", p1->signature());
+}
+
+TEST(DecodePlan, ExecutingAPlanDecodesAllValues)
+{
+    typedef std::map<std::string, dbus::types::Variant> Dictionary;
+    typedef dbus::types::Struct<std::tuple<std::int32_t, bool>> Pair;
+
+    auto msg = a_method_call();
+    Dictionary dict
+    {
+        {"answer", dbus::types::Variant::encode<std::uint32_t>(42)}
+    };
+
+    msg->writer()
+            << std::string{"name"}
+            << dict
+            << std::vector<std::int32_t>{}
+            << std::vector<Pair>{Pair{std::make_tuple(1, true)}, Pair{std::make_tuple(2, false)}}
+            << 3.;
+
+    auto plan = dbus::DecodePlan::for_signature(msg->signature());
+    EXPECT_EQ("sa{sv}aia(ib)d", plan->signature());
+
+    Printer printer;
+    auto reader = msg->reader();
+    plan->execute(reader, printer);
+
+    EXPECT_EQ("name a<{sv}> e<sv> answer v<u> 42 / / / "
+              "a<i> / "
+              "a<(ib)> r<ib> 1 true / r<ib> 2 false / / "
+              "3 ",
+              printer.out.str());
+    EXPECT_EQ(dbus::ArgumentType::invalid, reader.type());
+}
+
+TEST(DecodePlan, ExecutingAPlanOnAMismatchingMessageThrows)
+{
+    auto msg = a_method_call();
+    msg->writer() << std::int32_t{42};
+
+    Printer printer;
+    auto reader = msg->reader();
+    EXPECT_ANY_THROW(dbus::DecodePlan::for_signature("s")->execute(reader, printer));
+}
+
+TEST(DecodePlan, ExecutingAPlanOnAnEmptyArrayOfMismatchingElementsThrows)
+{
+    typedef dbus::types::Struct<std::tuple<std::int32_t, std::int32_t>> Pair;
+
+    auto msg = a_method_call();
+    msg->writer() << std::vector<Pair>{};
+
+    Printer printer;
+    auto reader = msg->reader();
+    EXPECT_ANY_THROW(dbus::DecodePlan::for_signature("a(is)")->execute(reader, printer));
+}
+
+TEST(DecodePlan, ExecutingAPlanOnAStructureWithAdditionalMembersThrows)
+{
+    typedef dbus::types::Struct<std::tuple<std::int32_t, std::int32_t>> Pair;
+
+    auto msg = a_method_call();
+    msg->writer() << Pair{std::make_tuple(1, 2)};
+
+    Printer printer;
+    auto reader = msg->reader();
+    EXPECT_ANY_THROW(dbus::DecodePlan::for_signature("(i)")->execute(reader, printer));
+}
@@ -17,9 +17,29 @@
  */
 
 #include <core/dbus/match_rule.h>
+#include <core/dbus/match_rule_index.h>
+#include <core/dbus/message_streaming_operators.h>
+
+#include <core/dbus/types/stl/string.h>
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <vector>
+
+namespace dbus = core::dbus;
+
+namespace
+{
+dbus::Message::Ptr a_signal_message(const std::string& path, const std::string& interface, const std::string& name)
+{
+    return dbus::Message::make_signal(
+                path,
+                interface,
+                name);
+}
+}
+
 TEST(MatchRule, ConstructingAMatchRuleYieldsCorrectResult)
 {
     core::dbus::MatchRule rule;
@@ -36,3 +56,174 @@ TEST(MatchRule, ConstructingAMatchRuleYieldsCorrectResult)
 
     EXPECT_EQ(expected_rule, rule.as_string());
 }
+
+TEST(MatchRule, ConstructingAMatchRuleWithPathNamespaceYieldsCorrectResult)
+{
+    auto rule = core::dbus::MatchRule()
+            .type(core::dbus::Message::Type::signal)
+            .interface("org.freedesktop.DBus.Properties")
+            .path_namespace(core::dbus::types::ObjectPath("/org/freedesktop/UPower/devices"));
+
+    const std::string expected_rule
+    {"type='signal',interface='org.freedesktop.DBus.Properties',path_namespace='/org/freedesktop/UPower/devices'"
+    };
+
+    EXPECT_EQ(expected_rule, rule.as_string());
+}
+
+TEST(MatchRule, ConstructingAMatchRuleWithTheFullGrammarYieldsCorrectResult)
+{
+    auto rule = core::dbus::MatchRule()
+            .type(core::dbus::Message::Type::signal)
+            .sender("org.freedesktop.DBus")
+            .destination(":1.42")
+            .interface("org.freedesktop.DBus")
+            .member("NameOwnerChanged")
+            .args({{1, ""}})
+            .arg_paths({{2, "/org/freedesktop/"}})
+            .arg0_namespace("com.example")
+            .eavesdrop(true);
+
+    const std::string expected_rule
+    {"type='signal',sender='org.freedesktop.DBus',destination=':1.42',interface='org.freedesktop.DBus',"
+     "member='NameOwnerChanged',path='/',arg1='',arg2path='/org/freedesktop/',arg0namespace='com.example',"
+     "eavesdrop='true'"
+    };
+
+    EXPECT_EQ(expected_rule, rule.as_string());
+}
+
+TEST(MatchRule, ApostrophesInValuesAreEscaped)
+{
+    auto rule = core::dbus::MatchRule()
+            .type(core::dbus::Message::Type::signal)
+            .args({{0, "it's"}});
+
+    EXPECT_EQ("type='signal',path='/',arg0='it'\\''s'", rule.as_string());
+}
+
+TEST(MatchRuleIndex, RulesOnlyMatchTheirInterfaceAndMember)
+{
+    std::vector<std::string> invoked;
+
+    dbus::MatchRuleIndex index;
+    index.install(dbus::MatchRule().type(dbus::Message::Type::signal).interface("a.b").member("M").path_namespace(dbus::types::ObjectPath::root()),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("a.b.M"); });
+    index.install(dbus::MatchRule().type(dbus::Message::Type::signal).interface("a.b").path_namespace(dbus::types::ObjectPath::root()),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("a.b.*"); });
+    index.install(dbus::MatchRule().type(dbus::Message::Type::signal).member("M").path_namespace(dbus::types::ObjectPath::root()),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("*.M"); });
+    index.install(dbus::MatchRule().type(dbus::Message::Type::method_call).path_namespace(dbus::types::ObjectPath::root()),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("method_call"); });
+
+    EXPECT_EQ(std::size_t{4}, index.size());
+
+    EXPECT_TRUE(index(a_signal_message("/x", "a.b", "M")));
+    EXPECT_EQ((std::vector<std::string>{"a.b.M", "a.b.*", "*.M"}), invoked);
+
+    invoked.clear();
+    EXPECT_TRUE(index(a_signal_message("/x", "a.b", "N")));
+    EXPECT_EQ((std::vector<std::string>{"a.b.*"}), invoked);
+
+    invoked.clear();
+    EXPECT_FALSE(index(a_signal_message("/x", "c.d", "N")));
+    EXPECT_TRUE(invoked.empty());
+}
+
+TEST(MatchRuleIndex, PathsAndPathNamespacesAreHonored)
+{
+    std::vector<std::string> invoked;
+
+    dbus::MatchRuleIndex index;
+    index.install(dbus::MatchRule().interface("a.b").path(dbus::types::ObjectPath("/a/b")),
+                  [&](const dbus::Message::Ptr& msg) { invoked.push_back("path " + msg->path().as_string()); });
+    index.install(dbus::MatchRule().interface("a.b").path_namespace(dbus::types::ObjectPath("/a/b")),
+                  [&](const dbus::Message::Ptr& msg) { invoked.push_back("namespace " + msg->path().as_string()); });
+
+    index(a_signal_message("/a/b", "a.b", "M"));
+    index(a_signal_message("/a/b/c", "a.b", "M"));
+    index(a_signal_message("/a/bc", "a.b", "M"));
+
+    EXPECT_EQ((std::vector<std::string>{"path /a/b", "namespace /a/b", "namespace /a/b/c"}), invoked);
+}
+
+TEST(MatchRuleIndex, RulesForDifferentPathsOnlySeeTheirOwnMessages)
+{
+    std::vector<std::string> invoked;
+
+    auto rule = dbus::MatchRule().type(dbus::Message::Type::signal).interface("a.b").member("M");
+
+    dbus::MatchRuleIndex index;
+    index.install(dbus::MatchRule(rule).path(dbus::types::ObjectPath("/a/1")),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("/a/1"); });
+    index.install(dbus::MatchRule(rule).path_namespace(dbus::types::ObjectPath("/a")),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("/a/*"); });
+    index.install(dbus::MatchRule(rule).path(dbus::types::ObjectPath("/a/2")),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("/a/2"); });
+
+    index(a_signal_message("/a/2", "a.b", "M"));
+    index(a_signal_message("/a/1", "a.b", "M"));
+    EXPECT_FALSE(index(a_signal_message("/b", "a.b", "M")));
+
+    EXPECT_EQ((std::vector<std::string>{"/a/*", "/a/2", "/a/1", "/a/*"}), invoked);
+}
+
+TEST(MatchRuleIndex, ArgumentsAreHonored)
+{
+    std::vector<std::string> invoked;
+
+    auto rule = dbus::MatchRule().interface("a.b").member("M").path_namespace(dbus::types::ObjectPath::root());
+
+    dbus::MatchRuleIndex index;
+    index.install(dbus::MatchRule(rule).args({{1, "x"}}),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("arg1"); });
+    index.install(dbus::MatchRule(rule).arg_paths({{2, "/a/"}}),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("arg2path"); });
+    index.install(dbus::MatchRule(rule).arg0_namespace("com.example"),
+                  [&](const dbus::Message::Ptr&) { invoked.push_back("arg0namespace"); });
+
+    auto signal = [](const std::string& arg0, const std::string& arg1, const std::string& arg2)
+    {
+        auto msg = a_signal_message("/", "a.b", "M");
+        msg->writer() << arg0 << arg1 << arg2;
+        return msg;
+    };
+
+    index(signal("com.example.Foo", "x", "/a/b"));
+    EXPECT_EQ((std::vector<std::string>{"arg1", "arg2path", "arg0namespace"}), invoked);
+
+    invoked.clear();
+    index(signal("com.examples", "y", "/"));
+    EXPECT_EQ((std::vector<std::string>{"arg2path"}), invoked);
+
+    invoked.clear();
+    index(signal("com.example", "y", "/b"));
+    EXPECT_EQ((std::vector<std::string>{"arg0namespace"}), invoked);
+
+    // Messages with too few arguments do not match rules for missing arguments.
+    invoked.clear();
+    index(a_signal_message("/", "a.b", "M"));
+    EXPECT_TRUE(invoked.empty());
+}
+
+TEST(MatchRuleIndex, UninstallingARuleRemovesItFromTheIndex)
+{
+    int invoked {0};
+
+    auto rule = dbus::MatchRule().interface("a.b").member("M");
+
+    dbus::MatchRuleIndex index;
+    auto t1 = index.install(rule, [&](const dbus::Message::Ptr&) { invoked++; });
+    auto t2 = index.install(rule, [&](const dbus::Message::Ptr&) { invoked++; });
+
+    index.uninstall(t1);
+    EXPECT_EQ(std::size_t{1}, index.size());
+    EXPECT_TRUE(index(a_signal_message("/", "a.b", "M")));
+
+    // Handlers are free to modify the index.
+    index.install(rule, [&](const dbus::Message::Ptr&) { index.uninstall(t2); });
+    EXPECT_TRUE(index(a_signal_message("/", "a.b", "M")));
+    EXPECT_EQ(std::size_t{1}, index.size());
+
+    EXPECT_EQ(2, invoked);
+}
@@ -18,6 +18,10 @@
 
 #include <core/dbus/message.h>
 #include <core/dbus/message_router.h>
+#include <core/dbus/path_namespace_router.h>
+
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -76,3 +80,105 @@ TEST(MessageRouterForType, HandlerDoesNotDeadlock)
 
     EXPECT_TRUE(invoked);
 }
+
+TEST(PathNamespaceRouter, ARouteForAPathIsOnlyInvokedForThatPath)
+{
+    int invoked {0};
+
+    dbus::PathNamespaceRouter router;
+    router.install_route(dbus::types::ObjectPath{"/org/freedesktop/UPower/devices"}, [&](const dbus::Message::Ptr&)
+    {
+        invoked++;
+    });
+
+    EXPECT_TRUE(router(a_signal_message("/org/freedesktop/UPower/devices", "org.freedesktop.UPower", "Changed")));
+    EXPECT_FALSE(router(a_signal_message("/org/freedesktop/UPower/devices/battery_BAT0", "org.freedesktop.UPower", "Changed")));
+    EXPECT_FALSE(router(a_signal_message("/org/freedesktop/UPower", "org.freedesktop.UPower", "Changed")));
+    EXPECT_FALSE(router(a_signal_message("/org/freedesktop/UPower/devicesX", "org.freedesktop.UPower", "Changed")));
+
+    EXPECT_EQ(1, invoked);
+}
+
+TEST(PathNamespaceRouter, ARouteForANamespaceIsInvokedForAllPathsBelowIt)
+{
+    std::vector<std::string> paths;
+
+    dbus::PathNamespaceRouter router;
+    router.install_namespace_route(dbus::types::ObjectPath{"/org/freedesktop/UPower/devices"}, [&](const dbus::Message::Ptr& msg)
+    {
+        paths.push_back(msg->path().as_string());
+    });
+
+    EXPECT_TRUE(router(a_signal_message("/org/freedesktop/UPower/devices", "org.freedesktop.UPower", "Changed")));
+    EXPECT_TRUE(router(a_signal_message("/org/freedesktop/UPower/devices/battery_BAT0", "org.freedesktop.UPower", "Changed")));
+    EXPECT_TRUE(router(a_signal_message("/org/freedesktop/UPower/devices/line_power_AC/x", "org.freedesktop.UPower", "Changed")));
+    EXPECT_FALSE(router(a_signal_message("/org/freedesktop/UPower", "org.freedesktop.UPower", "Changed")));
+    EXPECT_FALSE(router(a_signal_message("/org/freedesktop/UPower/devicesX", "org.freedesktop.UPower", "Changed")));
+
+    EXPECT_EQ((std::vector<std::string>
+              {
+                  "/org/freedesktop/UPower/devices",
+                  "/org/freedesktop/UPower/devices/battery_BAT0",
+                  "/org/freedesktop/UPower/devices/line_power_AC/x"
+              }),
+              paths);
+}
+
+TEST(PathNamespaceRouter, ExactRoutesAreInvokedBeforeNamespaceRoutesFromMostToLeastSpecific)
+{
+    std::vector<std::string> invoked;
+
+    dbus::PathNamespaceRouter router;
+    router.install_namespace_route(dbus::types::ObjectPath::root(), [&](const dbus::Message::Ptr&)
+    {
+        invoked.push_back("/*");
+    });
+    router.install_namespace_route(dbus::types::ObjectPath{"/org/freedesktop"}, [&](const dbus::Message::Ptr&)
+    {
+        invoked.push_back("/org/freedesktop/*");
+    });
+    router.install_route(dbus::types::ObjectPath{"/org/freedesktop/UPower"}, [&](const dbus::Message::Ptr&)
+    {
+        invoked.push_back("/org/freedesktop/UPower");
+    });
+
+    EXPECT_TRUE(router(a_signal_message("/org/freedesktop/UPower", "org.freedesktop.UPower", "Changed")));
+    EXPECT_EQ((std::vector<std::string>{"/org/freedesktop/UPower", "/org/freedesktop/*", "/*"}), invoked);
+}
+
+TEST(PathNamespaceRouter, UninstallingRoutesLeavesOtherRoutesIntact)
+{
+    int exact {0}, namespaced {0};
+
+    dbus::PathNamespaceRouter router;
+    router.install_route(dbus::types::ObjectPath{"/a/b/c"}, [&](const dbus::Message::Ptr&) { exact++; });
+    router.install_namespace_route(dbus::types::ObjectPath{"/a/b"}, [&](const dbus::Message::Ptr&) { namespaced++; });
+
+    router.uninstall_route(dbus::types::ObjectPath{"/a/b/c"});
+    EXPECT_TRUE(router(a_signal_message("/a/b/c", "a.b", "C")));
+
+    router.uninstall_namespace_route(dbus::types::ObjectPath{"/a/b"});
+    EXPECT_FALSE(router(a_signal_message("/a/b/c", "a.b", "C")));
+
+    // Uninstalling unknown routes is a no-op.
+    router.uninstall_route(dbus::types::ObjectPath{"/x/y"});
+
+    EXPECT_EQ(0, exact);
+    EXPECT_EQ(1, namespaced);
+}
+
+TEST(PathNamespaceRouter, HandlerDoesNotDeadlock)
+{
+    bool invoked {false};
+
+    dbus::PathNamespaceRouter router;
+    router.install_namespace_route(dbus::types::ObjectPath{"/core"}, [&](const dbus::Message::Ptr&)
+    {
+        router.uninstall_namespace_route(dbus::types::ObjectPath{"/core"});
+        invoked = true;
+    });
+
+    router(a_signal_message("/core/DBus", "org.freedesktop.DBus", "LaLeLu"));
+
+    EXPECT_TRUE(invoked);
+}
@@ -18,12 +18,18 @@
 
 #include <core/dbus/dbus.h>
 #include <core/dbus/message.h>
+#include <core/dbus/message_log.h>
 
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <memory>
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 namespace dbus = core::dbus;
 
 TEST(Message, BuildingAMethodCallMessageSucceedsForValidArguments)
@@ -176,6 +182,156 @@ TEST(Message, WriteAndSuccessiveIterationAreIdempotent)
     }
 }
 
+TEST(Message, SerializingAndDeserializingRestoresHeaderAndArguments)
+{
+    auto msg = core::dbus::Message::make_method_call(
+                core::dbus::DBus::name(),
+                core::dbus::DBus::path(),
+                core::dbus::DBus::name(),
+                "GetNameOwner");
+    msg->writer().push_int32(42);
+
+    auto bytes = msg->serialize();
+    EXPECT_FALSE(bytes.empty());
+
+    auto restored = core::dbus::Message::deserialize(bytes.data(), bytes.size());
+    EXPECT_EQ(core::dbus::Message::Type::method_call, restored->type());
+    EXPECT_EQ(msg->destination(), restored->destination());
+    EXPECT_EQ(msg->path(), restored->path());
+    EXPECT_EQ(msg->interface(), restored->interface());
+    EXPECT_EQ(msg->member(), restored->member());
+    EXPECT_EQ(msg->signature(), restored->signature());
+    EXPECT_EQ(42, restored->reader().pop_int32());
+}
+
+TEST(Message, DeserializingGarbageThrows)
+{
+    const std::uint8_t garbage[] = {'n', 'o', 't', ' ', 'a', ' ', 'm', 'e', 's', 's', 'a', 'g', 'e', 0, 0, 0};
+    EXPECT_THROW(core::dbus::Message::deserialize(garbage, sizeof(garbage)), std::runtime_error);
+}
+
+TEST(Message, SerializingAMessageCarryingUnixFdsThrows)
+{
+    auto msg = core::dbus::Message::make_signal("/", core::dbus::DBus::name(), "Fd");
+    int fd = eventfd(0, 0);
+    msg->writer().push_unix_fd(core::dbus::types::UnixFd{fd});
+    ::close(fd);
+
+    EXPECT_THROW(msg->serialize(), std::runtime_error);
+}
+
+TEST(MessageLog, EntriesAreReadBackInOrderAcrossWriters)
+{
+    const std::string path = "/tmp/dbus-cpp-message-log-test";
+    std::remove(path.c_str());
+
+    for (unsigned int round = 0; round < 2; round++)
+    {
+        dbus::MessageLog::Writer writer{path};
+        for (std::int32_t i = 0; i < 3; i++)
+        {
+            auto msg = core::dbus::Message::make_signal("/", core::dbus::DBus::name(), "Tick");
+            msg->writer().push_int32(round * 3 + i);
+            writer.append(msg, std::chrono::nanoseconds{round * 3 + i}, round);
+        }
+    }
+
+    dbus::MessageLog::Reader reader{path};
+    dbus::MessageLog::Entry entry;
+    for (std::int32_t i = 0; i < 6; i++)
+    {
+        ASSERT_TRUE(reader.next(entry));
+        EXPECT_EQ(std::chrono::nanoseconds{i}, entry.timestamp);
+        EXPECT_EQ(std::uint32_t(i / 3), entry.tag);
+        EXPECT_EQ("Tick", entry.message->member());
+        EXPECT_EQ(i, entry.message->reader().pop_int32());
+    }
+    EXPECT_FALSE(reader.next(entry));
+
+    std::remove(path.c_str());
+}
+
+TEST(MessageLog, AnEntryCutShortEndsTheLog)
+{
+    const std::string path = "/tmp/dbus-cpp-message-log-test-truncated";
+    std::remove(path.c_str());
+
+    {
+        dbus::MessageLog::Writer writer{path};
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            auto msg = core::dbus::Message::make_signal("/", core::dbus::DBus::name(), "Tick");
+            msg->ensure_serial_larger_than_zero_for_testing();
+            writer.append(msg);
+        }
+    }
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    ASSERT_EQ(0, ::truncate(path.c_str(), static_cast<off_t>(in.tellg()) - 1));
+
+    dbus::MessageLog::Reader reader{path};
+    dbus::MessageLog::Entry entry;
+    EXPECT_TRUE(reader.next(entry));
+    EXPECT_FALSE(reader.next(entry));
+
+    std::remove(path.c_str());
+}
+
+TEST(MessageLog, AppendingToALogWithAnEntryCutShortDropsThatEntry)
+{
+    const std::string path = "/tmp/dbus-cpp-message-log-test-repaired";
+    std::remove(path.c_str());
+
+    auto tick = [](std::int32_t i)
+    {
+        auto msg = core::dbus::Message::make_signal("/", core::dbus::DBus::name(), "Tick");
+        msg->writer().push_int32(i);
+        return msg;
+    };
+
+    {
+        dbus::MessageLog::Writer writer{path};
+        writer.append(tick(0), std::chrono::nanoseconds{0}, 0);
+        writer.append(tick(1), std::chrono::nanoseconds{1}, 0);
+    }
+
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        ASSERT_EQ(0, ::truncate(path.c_str(), static_cast<off_t>(in.tellg()) - 1));
+    }
+
+    {
+        dbus::MessageLog::Writer writer{path};
+        writer.append(tick(2), std::chrono::nanoseconds{2}, 0);
+    }
+
+    dbus::MessageLog::Reader reader{path};
+    dbus::MessageLog::Entry entry;
+    for (std::int32_t i : {0, 2})
+    {
+        ASSERT_TRUE(reader.next(entry));
+        EXPECT_EQ(std::chrono::nanoseconds{i}, entry.timestamp);
+        EXPECT_EQ(i, entry.message->reader().pop_int32());
+    }
+    EXPECT_FALSE(reader.next(entry));
+
+    std::remove(path.c_str());
+}
+
+TEST(MessageLog, OpeningAFileThatIsNotALogThrows)
+{
+    const std::string path = "/tmp/dbus-cpp-message-log-test-invalid";
+    {
+        std::ofstream out(path);
+        out << "definitely not a message log";
+    }
+
+    EXPECT_THROW(dbus::MessageLog::Reader{path}, dbus::MessageLog::Errors::NotAMessageLog);
+    EXPECT_THROW(dbus::MessageLog::Writer{path}, dbus::MessageLog::Errors::NotAMessageLog);
+
+    std::remove(path.c_str());
+}
+
 namespace
 {
 class MessageType : public testing::TestWithParam<std::pair<core::dbus::Message::Type, std::string>>
@@ -0,0 +1,235 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/bus.h>
+#include <core/dbus/object.h>
+#include <core/dbus/server.h>
+#include <core/dbus/service.h>
+#include <core/dbus/signal.h>
+
+#include <core/dbus/asio/executor.h>
+#include <core/dbus/types/stl/string.h>
+
+#include <boost/asio.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dbus = core::dbus;
+
+namespace
+{
+struct Peer
+{
+    static const std::string& name()
+    {
+        static const std::string s{"com.canonical.dbus.Peer"};
+        return s;
+    }
+
+    struct Ping
+    {
+        typedef Peer Interface;
+
+        static const std::string& name()
+        {
+            static const std::string s{"Ping"};
+            return s;
+        }
+
+        static const std::chrono::milliseconds default_timeout()
+        {
+            return std::chrono::seconds{1};
+        }
+    };
+
+    struct Signals
+    {
+        struct Pinged
+        {
+            inline static std::string name()
+            {
+                return "Pinged";
+            };
+            typedef Peer Interface;
+            typedef std::string ArgumentType;
+        };
+    };
+};
+
+// Accepts direct connections and exposes Peer on each of them.
+struct PeerServer
+{
+    PeerServer()
+    {
+        server = std::make_shared<dbus::Server>("unix:tmpdir=/tmp", [this](const dbus::Bus::Ptr& bus)
+        {
+            bus->install_executor(dbus::asio::make_executor(bus, io_service));
+
+            auto service = dbus::Service::add_service(bus, Peer::name());
+            auto object = service->add_object_for_path(dbus::types::ObjectPath("/peer"));
+            object->install_method_handler<Peer::Ping>([bus, object](const dbus::Message::Ptr& msg)
+            {
+                auto reply = dbus::Message::make_method_return(msg);
+                reply->writer() << std::string{"pong"};
+                bus->send(reply);
+
+                object->emit_signal<Peer::Signals::Pinged, std::string>("pinged");
+            });
+
+            std::lock_guard<std::mutex> lg(guard);
+            connections.push_back(bus);
+            objects.push_back(object);
+        });
+        server->install_executor(dbus::asio::make_executor(server, io_service));
+
+        worker = std::thread{[this](){ server->run(); }};
+    }
+
+    ~PeerServer()
+    {
+        server->stop();
+
+        if (worker.joinable())
+            worker.join();
+    }
+
+    boost::asio::io_service io_service;
+    dbus::Server::Ptr server;
+    std::mutex guard;
+    std::vector<dbus::Bus::Ptr> connections;
+    std::vector<dbus::Object::Ptr> objects;
+    std::thread worker;
+};
+}
+
+TEST(Server, ListeningOnAnInvalidAddressThrows)
+{
+    EXPECT_ANY_THROW(dbus::Server("this:is=not-an-address", [](const dbus::Bus::Ptr&){}));
+}
+
+TEST(Server, ReportsAnAddressPeersCanConnectTo)
+{
+    dbus::Server server{"unix:tmpdir=/tmp", [](const dbus::Bus::Ptr&){}};
+    EXPECT_EQ(0u, server.address().find("unix:"));
+    EXPECT_NO_THROW(dbus::Bus(server.address(), dbus::Bus::PeerToPeer{}));
+}
+
+TEST(Server, ErrorsOfTheConnectionHandlerAreReported)
+{
+    boost::asio::io_service io_service;
+
+    auto server = std::make_shared<dbus::Server>("unix:tmpdir=/tmp", [](const dbus::Bus::Ptr&)
+    {
+        throw std::runtime_error("rejected");
+    });
+
+    std::mutex guard;
+    std::condition_variable cv;
+    std::string error;
+
+    server->install_error_handler([&](std::exception_ptr e)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        try
+        {
+            std::rethrow_exception(e);
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        cv.notify_all();
+    });
+    server->install_executor(dbus::asio::make_executor(server, io_service));
+    std::thread worker{[server](){ server->run(); }};
+
+    dbus::Bus bus{server->address(), dbus::Bus::PeerToPeer{}};
+
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        EXPECT_TRUE(cv.wait_for(ul, std::chrono::seconds{5}, [&]() { return !error.empty(); }));
+        EXPECT_EQ("rejected", error);
+    }
+
+    server->stop();
+
+    if (worker.joinable())
+        worker.join();
+}
+
+TEST(Server, MethodCallsBetweenPeersBypassTheDaemon)
+{
+    PeerServer peer_server;
+
+    auto bus = std::make_shared<dbus::Bus>(peer_server.server->address(), dbus::Bus::PeerToPeer{});
+
+    auto stub = dbus::Service::use_service(bus, Peer::name());
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/peer"));
+
+    for (unsigned int i = 0; i < 3; i++)
+        EXPECT_EQ("pong", (object->invoke_method_synchronously<Peer::Ping, std::string>().value()));
+
+    std::lock_guard<std::mutex> lg(peer_server.guard);
+    EXPECT_EQ(std::size_t{1}, peer_server.connections.size());
+}
+
+TEST(Server, SignalsAreDeliveredToPeersWithoutContactingADaemon)
+{
+    PeerServer peer_server;
+
+    boost::asio::io_service io_service;
+    auto bus = std::make_shared<dbus::Bus>(peer_server.server->address(), dbus::Bus::PeerToPeer{});
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    std::thread worker{[bus](){ bus->run(); }};
+
+    auto stub = dbus::Service::use_service(bus, Peer::name());
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/peer"));
+
+    std::mutex guard;
+    std::condition_variable cv;
+    std::string received;
+
+    // Subscribing installs a match rule, which is only accounted for locally.
+    auto signal = object->get_signal<Peer::Signals::Pinged>();
+    signal->connect([&](const std::string& value)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        received = value;
+        cv.notify_all();
+    });
+
+    EXPECT_EQ("pong", (object->invoke_method_synchronously<Peer::Ping, std::string>().value()));
+
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        EXPECT_TRUE(cv.wait_for(ul, std::chrono::seconds{5}, [&]() { return !received.empty(); }));
+        EXPECT_EQ("pinged", received);
+    }
+
+    bus->stop();
+
+    if (worker.joinable())
+        worker.join();
+}
@@ -34,6 +34,8 @@
 #include <core/testing/cross_process_sync.h>
 #include <core/testing/fork_and_run.h>
 
+#include <boost/asio.hpp>
+
 #include <gtest/gtest.h>
 
 #include <system_error>
@@ -96,7 +98,9 @@ TEST_F(Service, AddingServiceAndObjectAndCallingIntoItSucceeds)
                 core::dbus::interfaces::Properties::Signals::PropertiesChanged::ArgumentType
                         args("this.is.unlikely.to.exist.Service",
                              {{test::Service::Properties::ReadOnly::name(),
-                               core::dbus::types::TypedVariant<test::Service::Properties::ReadOnly::ValueType>(expected_value)}},
+                               core::dbus::types::TypedVariant<test::Service::Properties::ReadOnly::ValueType>(expected_value)},
+                              {"NotSubscribed",
+                               core::dbus::types::Variant::encode(std::vector<std::string>{"not", "decoded"})}},
                              {});
                 skeleton->emit_signal<core::dbus::interfaces::Properties::Signals::PropertiesChanged, core::dbus::interfaces::Properties::Signals::PropertiesChanged::ArgumentType>(args);
                 changed_signal->emit(args);
@@ -175,6 +179,85 @@ TEST_F(Service, AddingServiceAndObjectAndCallingIntoItSucceeds)
         EXPECT_EQ(core::testing::ForkAndRunResult::empty, core::testing::fork_and_run(service, client));
 }
 
+TEST_F(Service, AddingASubtreeRoutesCallsForAllPathsBelowItToTheHandler)
+{
+    static const std::string subtree{"/this/is/unlikely/to/exist/Service/Records"};
+
+    core::testing::CrossProcessSync cps1;
+
+    auto service = [this, &cps1]()
+    {
+        core::testing::SigTermCatcher sc;
+
+        auto bus = session_bus();
+        bus->install_executor(core::dbus::asio::make_executor(bus));
+        auto service = dbus::Service::add_service<test::Service>(bus);
+
+        service->add_subtree_for_path(dbus::types::ObjectPath(subtree), [bus](const dbus::Message::Ptr& msg, const std::string& suffix)
+        {
+            if (msg->type() != dbus::Message::Type::method_call)
+                return dbus::Bus::MessageHandlerResult::not_yet_handled;
+
+            auto reply = dbus::Message::make_method_return(msg);
+            reply->writer() << suffix;
+            bus->send(reply);
+
+            return dbus::Bus::MessageHandlerResult::handled;
+        });
+
+        EXPECT_THROW(service->add_subtree_for_path(dbus::types::ObjectPath(subtree), dbus::Bus::SubtreeHandler{}),
+                     dbus::Bus::Errors::ObjectPathInUse);
+
+        std::thread t{[bus](){ bus->run(); }};
+        cps1.try_signal_ready_for(std::chrono::milliseconds{500});
+
+        EXPECT_TRUE(sc.wait_for_signal());
+
+        bus->stop();
+
+        if (t.joinable())
+            t.join();
+
+        return ::testing::Test::HasFailure() ? core::posix::exit::Status::failure : core::posix::exit::Status::success;
+    };
+
+    auto client = [this, &cps1]()
+    {
+        auto bus = session_bus();
+        EXPECT_EQ(std::uint32_t(1), cps1.wait_for_signal_ready_for(std::chrono::milliseconds{500}));
+
+        auto call = [bus](const std::string& path)
+        {
+            auto msg = dbus::Message::make_method_call(
+                        dbus::traits::Service<test::Service>::interface_name(),
+                        dbus::types::ObjectPath(path),
+                        dbus::traits::Service<test::Service>::interface_name(),
+                        test::Service::Method::name());
+
+            return bus->send_with_reply_and_block_for_at_most(msg, std::chrono::seconds{1});
+        };
+
+        auto reply = call(subtree);
+        EXPECT_EQ(dbus::Message::Type::method_return, reply->type());
+        EXPECT_EQ("", std::string{reply->reader().pop_string()});
+
+        reply = call(subtree + "/42");
+        EXPECT_EQ(dbus::Message::Type::method_return, reply->type());
+        EXPECT_EQ("42", std::string{reply->reader().pop_string()});
+
+        reply = call(subtree + "/42/settings");
+        EXPECT_EQ(dbus::Message::Type::method_return, reply->type());
+        EXPECT_EQ("42/settings", std::string{reply->reader().pop_string()});
+
+        // Paths sharing a prefix with the subtree are not part of it.
+        EXPECT_ANY_THROW(call(subtree + "Archive"));
+
+        return ::testing::Test::HasFailure() ? core::posix::exit::Status::failure : core::posix::exit::Status::success;
+    };
+
+    EXPECT_EQ(core::testing::ForkAndRunResult::empty, core::testing::fork_and_run(service, client));
+}
+
 TEST_F(Service, AddingANonExistingServiceDoesNotThrow)
 {
     ASSERT_NO_THROW(auto service = dbus::Service::add_service<test::Service>(session_bus()););
@@ -245,6 +328,285 @@ TEST_F(Service, AddingAnExistingServiceThrowsForSpecificFlags)
     ASSERT_ANY_THROW(auto service = dbus::Service::add_service<dbus::DBus>(session_bus(), flags););
 }
 
+TEST_F(Service, AddingServicesAsynchronouslyWorks)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+    std::thread t{[bus](){ bus->run(); }};
+
+    auto f1 = dbus::Service::add_service_asynchronously(bus, "com.canonical.dbus.first");
+    auto f2 = dbus::Service::add_service_asynchronously(bus, "com.canonical.dbus.second");
+    auto f3 = dbus::Service::add_service_asynchronously(bus, dbus::DBus::name(), dbus::Bus::RequestNameFlag::not_set);
+
+    for (auto f : {&f1, &f2, &f3})
+        EXPECT_EQ(std::future_status::ready, f->wait_for(std::chrono::seconds{1}));
+
+    EXPECT_EQ("com.canonical.dbus.first", f1.get()->get_name());
+    EXPECT_EQ("com.canonical.dbus.second", f2.get()->get_name());
+    EXPECT_ANY_THROW(f3.get());
+
+    EXPECT_TRUE(session_bus()->has_owner_for_name("com.canonical.dbus.second"));
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Service, LoopbackDispatchesCallsToObjectsOfTheSameConnectionInProcess)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    bus->enable_loopback();
+    std::thread t{[bus](){ bus->run(); }};
+
+    auto service = dbus::Service::add_service(bus, "com.canonical.dbus.loopback");
+    auto skeleton = service->add_object_for_path(dbus::types::ObjectPath("/loopback"));
+    skeleton->install_method_handler<test::Service::Method>([bus](const dbus::Message::Ptr& msg)
+    {
+        auto reply = dbus::Message::make_method_return(msg);
+        reply->writer() << std::int32_t{42};
+        bus->send(reply);
+    });
+
+    auto stub = dbus::Service::use_service(bus, "com.canonical.dbus.loopback");
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/loopback"));
+
+    EXPECT_EQ(42, (object->invoke_method_synchronously<test::Service::Method, std::int32_t>().value()));
+
+    auto future = object->invoke_method_asynchronously<test::Service::Method, std::int32_t>();
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds{1}));
+    EXPECT_EQ(42, future.get().value());
+
+    EXPECT_EQ(std::size_t{0}, bus->outstanding_calls());
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Service, LoopbackHandsACopyOfTheCallToTheObjectOnTheEventLoop)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    bus->enable_loopback();
+    std::thread t{[bus](){ bus->run(); }};
+
+    std::thread::id handler_thread;
+
+    auto service = dbus::Service::add_service(bus, "com.canonical.dbus.loopback");
+    auto skeleton = service->add_object_for_path(dbus::types::ObjectPath("/loopback"));
+    skeleton->install_method_handler<test::Service::Method>([bus, &handler_thread](const dbus::Message::Ptr& msg)
+    {
+        handler_thread = std::this_thread::get_id();
+
+        auto reply = dbus::Message::make_method_return(msg);
+        reply->writer() << std::int32_t{42};
+        bus->send(reply);
+    });
+
+    auto call = dbus::Message::make_method_call(
+                "com.canonical.dbus.loopback",
+                dbus::types::ObjectPath("/loopback"),
+                dbus::traits::Service<test::Service>::interface_name(),
+                test::Service::Method::name());
+    auto bytes = call->serialize();
+
+    auto pending_call = bus->send_with_reply_and_timeout(call, std::chrono::seconds{1});
+    std::promise<dbus::Message::Ptr> promise;
+    pending_call->then([&promise](const dbus::Message::Ptr& reply) { promise.set_value(reply); });
+
+    auto future = promise.get_future();
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds{1}));
+    EXPECT_EQ(dbus::Message::Type::method_return, future.get()->type());
+
+    EXPECT_EQ(t.get_id(), handler_thread);
+    EXPECT_EQ(bytes, call->serialize());
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Service, LoopbackThrowsForExecutorsThatCannotScheduleHandlers)
+{
+    struct Executor : public dbus::Executor
+    {
+        void run() override {}
+        void stop() override {}
+    };
+
+    auto bus = session_bus();
+    bus->install_executor(std::make_shared<Executor>());
+    bus->enable_loopback();
+
+    auto service = dbus::Service::add_service(bus, "com.canonical.dbus.loopback");
+    auto skeleton = service->add_object_for_path(dbus::types::ObjectPath("/loopback"));
+
+    auto stub = dbus::Service::use_service(bus, "com.canonical.dbus.loopback");
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/loopback"));
+
+    EXPECT_THROW((object->invoke_method_asynchronously<test::Service::Method, std::int32_t>()), std::runtime_error);
+    EXPECT_EQ(std::size_t{0}, bus->outstanding_calls());
+}
+
+TEST_F(Service, LoopbackRepliesWithAnErrorForCallsWithoutHandler)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    bus->enable_loopback();
+    std::thread t{[bus](){ bus->run(); }};
+
+    auto service = dbus::Service::add_service(bus, "com.canonical.dbus.loopback");
+    auto skeleton = service->add_object_for_path(dbus::types::ObjectPath("/loopback"));
+
+    auto stub = dbus::Service::use_service(bus, "com.canonical.dbus.loopback");
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/loopback"));
+
+    EXPECT_ANY_THROW((object->invoke_method_synchronously<test::Service::Method, std::int32_t>()));
+
+    auto result = object->invoke_method_asynchronously<test::Service::Method, std::int32_t>().get();
+    EXPECT_TRUE(result.is_error());
+    EXPECT_EQ(DBUS_ERROR_UNKNOWN_METHOD, result.error().name());
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Service, LoopbackOnlyAcceptsRepliesToCallsDispatchedInProcess)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    bus->enable_loopback();
+    std::thread t{[bus](){ bus->run(); }};
+
+    std::promise<dbus::Message::Ptr> received;
+
+    auto service = dbus::Service::add_service(bus, "com.canonical.dbus.loopback");
+    auto skeleton = service->add_object_for_path(dbus::types::ObjectPath("/loopback"));
+    skeleton->install_method_handler<test::Service::Method>([&received](const dbus::Message::Ptr& msg)
+    {
+        received.set_value(msg);
+    });
+
+    auto stub = dbus::Service::use_service(bus, "com.canonical.dbus.loopback");
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/loopback"));
+
+    auto future = object->invoke_method_asynchronously<test::Service::Method, std::int32_t>();
+
+    auto f = received.get_future();
+    ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds{1}));
+    auto call = f.get();
+
+    // A look-alike carrying the same serial and sender, as a call that went
+    // through the daemon might, does not complete the call dispatched in-process.
+    auto bytes = call->serialize();
+    auto look_alike = dbus::Message::deserialize(bytes.data(), bytes.size());
+    auto hijacker = dbus::Message::make_method_return(look_alike);
+    hijacker->writer() << std::int32_t{0};
+    bus->send(hijacker);
+
+    EXPECT_EQ(std::future_status::timeout, future.wait_for(std::chrono::seconds{0}));
+
+    auto reply = dbus::Message::make_method_return(call);
+    reply->writer() << std::int32_t{42};
+    bus->send(reply);
+
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds{0}));
+    EXPECT_EQ(42, future.get().value());
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Service, LoopbackCompletesCallsWithRepliesSentInOrder)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    bus->enable_loopback();
+    std::thread t{[bus](){ bus->run(); }};
+
+    std::promise<dbus::Message::Ptr> received;
+
+    auto service = dbus::Service::add_service(bus, "com.canonical.dbus.loopback");
+    auto skeleton = service->add_object_for_path(dbus::types::ObjectPath("/loopback"));
+    skeleton->install_method_handler<test::Service::Method>([&received](const dbus::Message::Ptr& msg)
+    {
+        received.set_value(msg);
+    });
+
+    auto stub = dbus::Service::use_service(bus, "com.canonical.dbus.loopback");
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/loopback"));
+
+    auto future = object->invoke_method_asynchronously<test::Service::Method, std::int32_t>();
+
+    auto f = received.get_future();
+    ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds{1}));
+    auto call = f.get();
+
+    auto reply = dbus::Message::make_method_return(call);
+    reply->writer() << std::int32_t{42};
+
+    {
+        // Replies to calls dispatched in-process are not held back by a cork.
+        dbus::Bus::Cork cork{bus};
+        auto serials = bus->send_in_order({reply});
+
+        ASSERT_EQ(std::size_t{1}, serials.size());
+        EXPECT_NE(0u, serials.front());
+        ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds{0}));
+        EXPECT_EQ(42, future.get().value());
+    }
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
+TEST_F(Service, LoopbackTimesOutCallsThatAreNeverAnswered)
+{
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(dbus::asio::make_executor(bus, io_service));
+    bus->enable_loopback();
+    std::thread t{[bus](){ bus->run(); }};
+
+    auto service = dbus::Service::add_service(bus, "com.canonical.dbus.loopback");
+    auto skeleton = service->add_object_for_path(dbus::types::ObjectPath("/loopback"));
+    skeleton->install_method_handler<test::Service::Method>([](const dbus::Message::Ptr&)
+    {
+    });
+
+    auto stub = dbus::Service::use_service(bus, "com.canonical.dbus.loopback");
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/loopback"));
+
+    auto future = object->invoke_method_asynchronously<test::Service::Method, std::int32_t>();
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds{1}));
+
+    auto result = future.get();
+    EXPECT_TRUE(result.is_error());
+    EXPECT_EQ(DBUS_ERROR_NO_REPLY, result.error().name());
+    EXPECT_EQ(std::size_t{0}, bus->outstanding_calls());
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
+
 TEST(VoidResult, DefaultConstructionYieldsANonErrorResult)
 {
     dbus::Result<void> result;
@@ -16,8 +16,10 @@
  * Authored by: Pete Woods <pete.woods@canonical.com>
  */
 
+#include <core/dbus/bus.h>
 #include <core/dbus/dbus.h>
 #include <core/dbus/fixture.h>
+#include <core/dbus/name_watch_registry.h>
 #include <core/dbus/object.h>
 #include <core/dbus/property.h>
 #include <core/dbus/dbus.h>
@@ -35,8 +37,11 @@
 #include <core/testing/cross_process_sync.h>
 #include <core/testing/fork_and_run.h>
 
+#include <boost/asio.hpp>
+
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <system_error>
 #include <thread>
 
@@ -209,3 +214,57 @@ TEST_F(ServiceWatcher, Unregistration)
 
     EXPECT_EQ(core::testing::ForkAndRunResult::empty, core::testing::fork_and_run(service, client));
 }
+
+TEST_F(ServiceWatcher, WatchersShareASingleSubscriptionAndOnlySeeTheirName)
+{
+    static const std::string first{"com.canonical.dbus.first"};
+    static const std::string second{"com.canonical.dbus.second"};
+
+    // The default executor shares its io_service across the process, and
+    // other tests in this binary might have already stopped it.
+    boost::asio::io_service io_service;
+    auto bus = session_bus();
+    bus->install_executor(core::dbus::asio::make_executor(bus, io_service));
+    std::thread t{[bus](){ bus->run(); }};
+
+    dbus::DBus daemon(bus);
+    auto rules_before = bus->match_rules().size();
+
+    std::vector<dbus::ServiceWatcher::Ptr> watchers
+    {
+        daemon.make_service_watcher(first),
+        daemon.make_service_watcher(first, dbus::DBus::WatchMode::registration),
+        daemon.make_service_watcher(second)
+    };
+
+    EXPECT_EQ(rules_before + 1, bus->match_rules().size());
+    EXPECT_EQ(std::size_t{3}, bus->access_name_watch_registry().size());
+
+    std::atomic<unsigned int> first_registered{0};
+    std::atomic<unsigned int> second_changed{0};
+
+    for (std::size_t i = 0; i < 2; i++)
+        watchers[i]->service_registered().connect([&first_registered]() { ++first_registered; });
+    watchers[2]->owner_changed().connect([&second_changed](const std::string&, const std::string&) { ++second_changed; });
+
+    auto other = session_bus();
+    auto name = other->request_name_on_bus(first, dbus::Bus::RequestNameFlag::do_not_queue);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+    while (first_registered < 2 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+    EXPECT_EQ(2u, first_registered.load());
+    EXPECT_EQ(0u, second_changed.load());
+
+    other->release_name_on_bus(std::move(name));
+
+    watchers.clear();
+    EXPECT_EQ(std::size_t{0}, bus->access_name_watch_registry().size());
+    EXPECT_EQ(rules_before, bus->match_rules().size());
+
+    bus->stop();
+
+    if (t.joinable())
+        t.join();
+}
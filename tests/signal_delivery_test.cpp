@@ -333,3 +333,106 @@ TEST_F(Service, SignalDeliverySameObjectSameInterfaceSameSignal)
 
     EXPECT_EQ(core::testing::ForkAndRunResult::empty, core::testing::fork_and_run(service, client));
 }
+
+TEST_F(Service, SignalDeliveryHonorsMatchArgs)
+{
+    typedef test::Service::Interfaces::Foo::Signals::Named Named;
+
+    core::testing::CrossProcessSync server_is_running;
+    core::testing::CrossProcessSync client_has_setup_signals_and_connections;
+
+    auto service = [this, &server_is_running, &client_has_setup_signals_and_connections]()
+    {
+        core::testing::SigTermCatcher sc;
+
+        auto bus = session_bus();
+        bus->install_executor(core::dbus::asio::make_executor(bus));
+        auto service = dbus::Service::add_service<test::Service>(bus);
+
+        auto foo1 = service->add_object_for_path(dbus::types::ObjectPath("/this/is/unlikely/to/exist/Service/Foo1"));
+
+        std::thread t{[bus](){ bus->run(); }};
+
+        server_is_running.try_signal_ready_for(std::chrono::milliseconds{1000});
+        EXPECT_EQ(std::uint32_t(1),
+                  client_has_setup_signals_and_connections.wait_for_signal_ready_for(
+                      std::chrono::milliseconds{500}));
+
+        foo1->emit_signal<Named, Named::ArgumentType>(Named::ArgumentType{"a", "x", 1});
+        foo1->emit_signal<Named, Named::ArgumentType>(Named::ArgumentType{"b", "x", 2});
+        foo1->emit_signal<Named, Named::ArgumentType>(Named::ArgumentType{"a", "y", 3});
+
+        sc.wait_for_signal();
+
+        bus->stop();
+
+        if (t.joinable())
+            t.join();
+
+        return ::testing::Test::HasFailure() ? core::posix::exit::Status::failure : core::posix::exit::Status::success;
+    };
+
+    auto client = [this, &server_is_running, &client_has_setup_signals_and_connections]()
+    {
+        auto bus = session_bus();
+        auto executor = core::dbus::asio::make_executor(bus);
+        bus->install_executor(executor);
+        std::thread t{[bus](){ bus->run(); }};
+
+        std::vector<int64_t> all, arg0_a, arg0_a_arg1_x, arg1_y, once;
+
+        // server ready
+        EXPECT_EQ(std::uint32_t(1),
+                  server_is_running.wait_for_signal_ready_for(std::chrono::milliseconds{500}));
+
+        auto stub_service = dbus::Service::use_service(bus, dbus::traits::Service<test::Service>::interface_name());
+        auto foo1 = stub_service->object_for_path(dbus::types::ObjectPath("/this/is/unlikely/to/exist/Service/Foo1"));
+        auto signal = foo1->get_signal<Named>();
+
+        signal->connect_with_match_args([&arg0_a](const Named::ArgumentType& value)
+        {
+            arg0_a.push_back(std::get<2>(value));
+        }, {{0, "a"}});
+
+        signal->connect_with_match_args([&arg0_a_arg1_x](const Named::ArgumentType& value)
+        {
+            arg0_a_arg1_x.push_back(std::get<2>(value));
+        }, {{0, "a"}, {1, "x"}});
+
+        signal->connect_with_match_args([&arg1_y](const Named::ArgumentType& value)
+        {
+            arg1_y.push_back(std::get<2>(value));
+        }, {{1, "y"}});
+
+        signal->connect([bus, &all](const Named::ArgumentType& value)
+        {
+            all.push_back(std::get<2>(value));
+            if (all.size() == 3)
+                bus->stop();
+        });
+
+        // Disconnecting from within a handler must not deadlock.
+        core::dbus::Signal<Named, Named::ArgumentType>::SubscriptionToken token;
+        token = signal->connect([signal, &token, &once](const Named::ArgumentType& value)
+        {
+            once.push_back(std::get<2>(value));
+            signal->disconnect(token);
+        });
+
+        // signals connected
+        client_has_setup_signals_and_connections.try_signal_ready_for(std::chrono::milliseconds{500});
+
+        if (t.joinable())
+            t.join();
+
+        EXPECT_EQ((std::vector<int64_t>{1, 2, 3}), all);
+        EXPECT_EQ((std::vector<int64_t>{1, 3}), arg0_a);
+        EXPECT_EQ((std::vector<int64_t>{1}), arg0_a_arg1_x);
+        EXPECT_EQ((std::vector<int64_t>{3}), arg1_y);
+        EXPECT_EQ((std::vector<int64_t>{1}), once);
+
+        return ::testing::Test::HasFailure() ? core::posix::exit::Status::failure : core::posix::exit::Status::success;
+    };
+
+    EXPECT_EQ(core::testing::ForkAndRunResult::empty, core::testing::fork_and_run(service, client));
+}
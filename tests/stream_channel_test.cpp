@@ -0,0 +1,205 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <core/dbus/fixture.h>
+#include <core/dbus/object.h>
+#include <core/dbus/service.h>
+#include <core/dbus/stream_channel.h>
+#include <core/dbus/types/stl/tuple.h>
+
+#include <core/dbus/asio/executor.h>
+
+#include "test_data.h"
+
+#include <boost/asio.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace dbus = core::dbus;
+
+namespace
+{
+struct StreamChannel : public core::dbus::testing::Fixture
+{
+};
+
+auto session_bus_config_file =
+        core::dbus::testing::Fixture::default_session_bus_config_file() =
+        core::testing::session_bus_configuration_file();
+
+auto system_bus_config_file =
+        core::dbus::testing::Fixture::default_system_bus_config_file() =
+        core::testing::system_bus_configuration_file();
+
+struct Sample
+{
+    std::uint64_t sequence;
+    double value;
+};
+
+struct Sensor
+{
+    static const std::string& name()
+    {
+        static const std::string s{"com.canonical.dbus.Sensor"};
+        return s;
+    }
+
+    struct OpenStream
+    {
+        typedef Sensor Interface;
+
+        static const std::string& name()
+        {
+            static const std::string s{"OpenStream"};
+            return s;
+        }
+
+        static const std::chrono::milliseconds default_timeout()
+        {
+            return std::chrono::seconds{1};
+        }
+    };
+};
+
+dbus::StreamChannel<Sample>::Ptr attach_to(const dbus::StreamChannel<Sample>::Ptr& channel)
+{
+    return dbus::StreamChannel<Sample>::attach(
+                dbus::types::UnixFd{::dup(channel->memory().to_int())},
+                dbus::types::UnixFd{::dup(channel->event().to_int())});
+}
+}
+
+TEST_F(StreamChannel, RecordsArriveInOrderAcrossTheEndOfTheRing)
+{
+    auto producer = dbus::StreamChannel<Sample>::create(5);
+    EXPECT_EQ(std::size_t{8}, producer->untyped()->capacity());
+
+    auto consumer = attach_to(producer);
+
+    std::uint64_t sequence = 0;
+    for (unsigned int i = 0; i < 5; i++, sequence++)
+        EXPECT_TRUE(producer->try_push(Sample{sequence, 0.5}));
+    EXPECT_EQ(std::size_t{5}, consumer->drain().size());
+
+    for (unsigned int i = 0; i < 8; i++, sequence++)
+        EXPECT_TRUE(producer->try_push(Sample{sequence, 0.5}));
+    EXPECT_FALSE(producer->try_push(Sample{sequence, 0.5}));
+
+    auto records = consumer->drain();
+    ASSERT_EQ(std::size_t{8}, records.size());
+    for (std::size_t i = 0; i < records.size(); i++)
+        EXPECT_EQ(5 + i, records[i].sequence);
+
+    EXPECT_TRUE(consumer->drain().empty());
+}
+
+TEST_F(StreamChannel, AttachingForRecordsOfADifferentSizeThrows)
+{
+    auto producer = dbus::StreamChannel<Sample>::create(8);
+
+    EXPECT_THROW(dbus::StreamChannel<std::uint8_t>::attach(
+                     dbus::types::UnixFd{::dup(producer->memory().to_int())},
+                     dbus::types::UnixFd{::dup(producer->event().to_int())}),
+                 dbus::RawStreamChannel::Errors::IncompatibleLayout);
+}
+
+TEST_F(StreamChannel, AttachingToAnUnsealedMemfdThrows)
+{
+    int memory = ::memfd_create("unsealed", MFD_CLOEXEC);
+    ASSERT_NE(-1, memory);
+    ASSERT_EQ(0, ::ftruncate(memory, 4096));
+
+    EXPECT_THROW(dbus::StreamChannel<Sample>::attach(
+                     dbus::types::UnixFd{memory},
+                     dbus::types::UnixFd{::eventfd(0, EFD_CLOEXEC)}),
+                 dbus::RawStreamChannel::Errors::NotSealed);
+}
+
+TEST_F(StreamChannel, IsNegotiatedOverTheBusAndConsumedOnTheEventLoop)
+{
+    static const std::uint64_t record_count = 1000;
+
+    boost::asio::io_service io_service;
+
+    auto service_bus = session_bus();
+    service_bus->install_executor(dbus::asio::make_executor(service_bus, io_service));
+    auto client_bus = session_bus();
+    client_bus->install_executor(dbus::asio::make_executor(client_bus, io_service));
+    std::thread worker{[service_bus](){ service_bus->run(); }};
+
+    auto producer = dbus::StreamChannel<Sample>::create(64);
+
+    auto skeleton = dbus::Service::add_service(service_bus, Sensor::name());
+    auto sensor = skeleton->add_object_for_path(dbus::types::ObjectPath("/sensor"));
+    sensor->install_method_handler<Sensor::OpenStream>([service_bus, producer](const dbus::Message::Ptr& msg)
+    {
+        auto reply = dbus::Message::make_method_return(msg);
+        reply->writer() << producer->memory() << producer->event();
+        service_bus->send(reply);
+    });
+
+    auto stub = dbus::Service::use_service(client_bus, Sensor::name());
+    auto object = stub->object_for_path(dbus::types::ObjectPath("/sensor"));
+    auto fds = object->invoke_method_synchronously<
+            Sensor::OpenStream,
+            std::tuple<dbus::types::UnixFd, dbus::types::UnixFd>>().value();
+
+    std::mutex guard;
+    std::condition_variable cv;
+    std::vector<Sample> received;
+    std::size_t batches = 0;
+
+    auto consumer = dbus::StreamChannel<Sample>::attach(std::get<0>(fds), std::get<1>(fds));
+    auto executor = dbus::asio::make_executor(consumer, io_service, [&](const std::vector<Sample>& batch)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        received.insert(received.end(), batch.begin(), batch.end());
+        batches++;
+        cv.notify_all();
+    });
+
+    for (std::uint64_t i = 0; i < record_count; i++)
+        while (!producer->try_push(Sample{i, 0.5}))
+            std::this_thread::yield();
+
+    {
+        std::unique_lock<std::mutex> ul(guard);
+        EXPECT_TRUE(cv.wait_for(ul, std::chrono::seconds{5}, [&]() { return received.size() == record_count; }));
+
+        for (std::size_t i = 0; i < received.size(); i++)
+            EXPECT_EQ(i, received[i].sequence);
+        EXPECT_LE(batches, record_count);
+    }
+
+    executor.reset();
+    service_bus->stop();
+
+    if (worker.joinable())
+        worker.join();
+}
@@ -113,6 +113,16 @@ struct Service
                     typedef Foo Interface;
                     typedef int64_t ArgumentType;
                 };
+
+                struct Named
+                {
+                    inline static std::string name()
+                    {
+                        return "Named";
+                    }
+                    typedef Foo Interface;
+                    typedef std::tuple<std::string, std::string, int64_t> ArgumentType;
+                };
             };
         };
     };